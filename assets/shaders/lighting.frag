@@ -3,6 +3,25 @@
 in vec2 v_tex_coord;
 out vec4 o_frag_color;
 
+struct s_light {
+    vec2 pos;
+    float radius;
+    float intensity;
+};
+
+layout (std430, binding = 0) readonly buffer b_lights {
+    s_light lights[];
+};
+
+// The lights reaching tile i are those indexed by tile_light_indexes[tile_light_begins[i]] up to but excluding tile_light_indexes[tile_light_begins[i + 1]].
+layout (std430, binding = 1) readonly buffer b_tile_light_begins {
+    int tile_light_begins[];
+};
+
+layout (std430, binding = 2) readonly buffer b_tile_light_indexes {
+    int tile_light_indexes[];
+};
+
 uniform sampler2D u_tex;
 
 uniform vec2 u_cam_topleft;
@@ -10,13 +29,33 @@ uniform vec2 u_cam_size;
 
 uniform float u_darkness;
 
-uniform vec2 u_light_pos;
-uniform float u_light_radius;
+uniform float u_light_tile_size;
+uniform ivec2 u_light_tile_cnts;
+
+uniform vec2 u_level_surface_origin;
+uniform float u_level_surface_height;
+uniform float u_res_scale;
 
 void main() {
     vec2 pos = u_cam_topleft + vec2(v_tex_coord.x * u_cam_size.x, (1.0 - v_tex_coord.y) * u_cam_size.y);
-    float light_dist = distance(pos, u_light_pos);
-    float brightness = (1.0 - (u_darkness * clamp(light_dist / u_light_radius, 0.0, 1.0)));
 
-    o_frag_color = texture(u_tex, v_tex_coord) * vec4(brightness, brightness, brightness, 1.0);
+    ivec2 tile = clamp(ivec2((pos - u_cam_topleft) / u_light_tile_size), ivec2(0), u_light_tile_cnts - 1);
+    int tile_index = (tile.y * u_light_tile_cnts.x) + tile.x;
+
+    // Overlapping lights add together, up to full brightness.
+    float light = 0.0;
+
+    for (int i = tile_light_begins[tile_index]; i < tile_light_begins[tile_index + 1] && light < 1.0; ++i) {
+        s_light l = lights[tile_light_indexes[i]];
+        float light_dist = distance(pos, l.pos);
+        light += l.intensity * (1.0 - clamp(light_dist / l.radius, 0.0, 1.0));
+    }
+
+    float brightness = 1.0 - (u_darkness * (1.0 - min(light, 1.0)));
+
+    // Find the texel of the level surface under this pixel. The surface is drawn top down into the bottom left of the target, so rows are counted back from its height.
+    vec2 texel = (pos - u_level_surface_origin) * u_res_scale;
+    vec2 tex_coord = vec2(texel.x, u_level_surface_height - texel.y) / vec2(textureSize(u_tex, 0));
+
+    o_frag_color = texture(u_tex, tex_coord) * vec4(brightness, brightness, brightness, 1.0);
 }
@@ -0,0 +1,11 @@
+#version 430 core
+
+in vec2 v_tex_coord;
+in vec4 v_blend;
+out vec4 o_frag_color;
+
+uniform sampler2D u_tex;
+
+void main() {
+    o_frag_color = texture(u_tex, v_tex_coord) * v_blend;
+}
@@ -0,0 +1,30 @@
+#version 430 core
+
+layout (location = 0) in vec2 a_pos;
+layout (location = 1) in vec2 a_scale;
+layout (location = 2) in float a_rot;
+layout (location = 3) in vec4 a_src_rect;
+layout (location = 4) in vec2 a_origin;
+layout (location = 5) in vec4 a_blend;
+
+out vec2 v_tex_coord;
+out vec4 v_blend;
+
+uniform mat4 u_proj;
+uniform mat4 u_view;
+uniform vec2 u_tex_size;
+
+void main() {
+    // The quad is drawn as a triangle strip, with its corners in the order top left, top right, bottom left, bottom right.
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+
+    vec2 offs = (corner - a_origin) * a_src_rect.zw * a_scale;
+
+    float rot_cos = cos(a_rot);
+    float rot_sin = -sin(a_rot);
+    vec2 vert = a_pos + vec2((offs.x * rot_cos) - (offs.y * rot_sin), (offs.x * rot_sin) + (offs.y * rot_cos));
+
+    gl_Position = u_proj * u_view * vec4(vert, 0.0f, 1.0f);
+    v_tex_coord = (a_src_rect.xy + (corner * a_src_rect.zw)) / u_tex_size;
+    v_blend = a_blend;
+}
@@ -0,0 +1,16 @@
+#version 430 core
+
+in vec2 v_tex_coord;
+out vec4 o_frag_color;
+
+uniform sampler2D u_tex;
+uniform vec4 u_color;
+
+void main() {
+    // The texture holds a signed distance field with the glyph edge at 0.5, so the edge is smoothed over about a screen pixel whatever the scale.
+    float dist = texture(u_tex, v_tex_coord).r;
+    float edge_width = max(0.5 * fwidth(dist), 0.0001);
+    float alpha = smoothstep(0.5 - edge_width, 0.5 + edge_width, dist);
+
+    o_frag_color = vec4(u_color.rgb, u_color.a * alpha);
+}
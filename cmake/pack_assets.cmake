@@ -0,0 +1,90 @@
+# Runs the asset packer only if the packer itself, the packing instructions or one of the files they list has changed since the last successful pack.
+# Only contents are compared, so timestamp-only changes (e.g. from switching branches) don't cause a repack, and neither do changes to files the pack doesn't read.
+# NOTE: The packer always rebuilds the whole pack, so this decides whether to pack at all rather than which assets to pack again.
+#
+# Expects ASSET_PACKER, SRC_DIR, DEST_DIR and STAMP_FILE to be defined.
+
+# The shaders the game compiles itself are read from beside the packed assets rather than packed, so are copied over whatever happens below.
+file(COPY ${SRC_DIR}/shaders DESTINATION ${DEST_DIR})
+
+set(packing_instrs_file_path ${SRC_DIR}/packing_instrs.json)
+file(READ ${packing_instrs_file_path} packing_instrs)
+
+# Gather the files the instructions list, under each asset type.
+set(packed_file_paths)
+
+# Appends the string at the given path in the instructions to the packed file paths, if there is one.
+macro(append_packed_file_path)
+    string(JSON packed_file_path ERROR_VARIABLE json_error GET ${packing_instrs} ${ARGN})
+
+    if(NOT json_error)
+        list(APPEND packed_file_paths ${packed_file_path})
+    endif()
+endmacro()
+
+foreach(asset_type IN ITEMS textures fonts shader_progs sounds music)
+    string(JSON asset_cnt ERROR_VARIABLE json_error LENGTH ${packing_instrs} ${asset_type})
+
+    if(json_error OR asset_cnt EQUAL 0)
+        continue()
+    endif()
+
+    math(EXPR last_asset_index "${asset_cnt} - 1")
+
+    foreach(asset_index RANGE ${last_asset_index})
+        string(JSON asset_instr_type TYPE ${packing_instrs} ${asset_type} ${asset_index})
+
+        if(asset_instr_type STREQUAL "STRING")
+            append_packed_file_path(${asset_type} ${asset_index})
+        else()
+            append_packed_file_path(${asset_type} ${asset_index} rel_file_path)
+            append_packed_file_path(${asset_type} ${asset_index} vs_rel_file_path)
+            append_packed_file_path(${asset_type} ${asset_index} fs_rel_file_path)
+        endif()
+    endforeach()
+endforeach()
+
+list(REMOVE_DUPLICATES packed_file_paths)
+list(SORT packed_file_paths)
+
+file(SHA256 ${ASSET_PACKER} packer_hash)
+file(SHA256 ${packing_instrs_file_path} packing_instrs_hash)
+set(content_hashes "packer:${packer_hash}\npacking_instrs.json:${packing_instrs_hash}\n")
+
+foreach(packed_file_path IN LISTS packed_file_paths)
+    if(NOT EXISTS ${SRC_DIR}/${packed_file_path})
+        # Left for the packer to report.
+        string(APPEND content_hashes "${packed_file_path}:missing\n")
+        continue()
+    endif()
+
+    file(SHA256 ${SRC_DIR}/${packed_file_path} packed_file_hash)
+    string(APPEND content_hashes "${packed_file_path}:${packed_file_hash}\n")
+endforeach()
+
+string(SHA256 content_hash "${content_hashes}")
+
+if(EXISTS ${STAMP_FILE})
+    file(READ ${STAMP_FILE} prev_content_hash)
+
+    if(prev_content_hash STREQUAL content_hash)
+        message(STATUS "Packed asset contents unchanged, skipping packing.")
+
+        # Bring the stamp up to date so the build doesn't rerun this until an asset is touched again.
+        file(TOUCH ${STAMP_FILE})
+
+        return()
+    endif()
+endif()
+
+execute_process(
+    COMMAND ${ASSET_PACKER} ${SRC_DIR} ${DEST_DIR}
+    RESULT_VARIABLE packer_result
+)
+
+if(NOT packer_result EQUAL 0)
+    file(REMOVE ${STAMP_FILE})
+    message(FATAL_ERROR "Asset packing failed!")
+endif()
+
+file(WRITE ${STAMP_FILE} ${content_hash})
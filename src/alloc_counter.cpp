@@ -0,0 +1,111 @@
+#include "alloc_counter.h"
+
+#include <cstdlib>
+#include <new>
+
+// NOTE: The global allocation and deallocation functions are replaced here, other than the over-aligned ones, which nothing in the game uses. With GC_WRAP_MALLOC defined the linker is expected to redirect "malloc", "calloc" and "realloc" to the wrappers below, and "operator new" then goes to the real "malloc" directly so that each allocation is only counted once.
+
+std::atomic<int> g_heap_alloc_cnt;
+
+#ifdef GC_WRAP_MALLOC
+extern "C" {
+    void* __real_malloc(std::size_t size);
+    void* __real_calloc(std::size_t cnt, std::size_t size);
+    void* __real_realloc(void* ptr, std::size_t size);
+
+    void* __wrap_malloc(const std::size_t size) {
+        g_heap_alloc_cnt.fetch_add(1, std::memory_order_relaxed);
+        return __real_malloc(size);
+    }
+
+    void* __wrap_calloc(const std::size_t cnt, const std::size_t size) {
+        g_heap_alloc_cnt.fetch_add(1, std::memory_order_relaxed);
+        return __real_calloc(cnt, size);
+    }
+
+    void* __wrap_realloc(void* const ptr, const std::size_t size) {
+        g_heap_alloc_cnt.fetch_add(1, std::memory_order_relaxed);
+        return __real_realloc(ptr, size);
+    }
+}
+
+static inline void* RealMalloc(const std::size_t size) {
+    return __real_malloc(size);
+}
+#else
+static inline void* RealMalloc(const std::size_t size) {
+    return std::malloc(size);
+}
+#endif
+
+static void* CountedNew(std::size_t size) {
+    g_heap_alloc_cnt.fetch_add(1, std::memory_order_relaxed);
+
+    if (size == 0) {
+        size = 1;
+    }
+
+    while (true) {
+        void* const ptr = RealMalloc(size);
+
+        if (ptr) {
+            return ptr;
+        }
+
+        const std::new_handler handler = std::get_new_handler();
+
+        if (!handler) {
+            throw std::bad_alloc();
+        }
+
+        handler();
+    }
+}
+
+void* operator new(const std::size_t size) {
+    return CountedNew(size);
+}
+
+void* operator new[](const std::size_t size) {
+    return CountedNew(size);
+}
+
+void* operator new(const std::size_t size, const std::nothrow_t&) noexcept {
+    try {
+        return CountedNew(size);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void* operator new[](const std::size_t size, const std::nothrow_t&) noexcept {
+    try {
+        return CountedNew(size);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void operator delete(void* const ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* const ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* const ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* const ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* const ptr, const std::nothrow_t&) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* const ptr, const std::nothrow_t&) noexcept {
+    std::free(ptr);
+}
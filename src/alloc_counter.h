@@ -0,0 +1,7 @@
+#pragma once
+
+#include <atomic>
+
+// The number of heap allocations made through "operator new", "malloc", "calloc" and "realloc" since the process started, so that it can be checked that ticks stop allocating once everything has grown to fit. Only counted in the headless build, which links in the replacements that keep it.
+// NOTE: "malloc" and friends are only counted where the linker can wrap them, and then only for calls from code linked statically, not from within shared libraries.
+extern std::atomic<int> g_heap_alloc_cnt;
@@ -0,0 +1,84 @@
+#include "arena.h"
+
+#include "pool.h"
+
+// Overflow blocks start with the link to the next, padded to keep what follows aligned.
+static constexpr int i_frame_arena_overflow_header_size = alignof(std::max_align_t);
+
+static inline int AlignUp(const int n, const int alignment) {
+    assert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+    return (n + alignment - 1) & ~(alignment - 1);
+}
+
+bool InitFrameArena(s_frame_arena& arena, const int cap) {
+    assert(zf4::IsStructZero(arena));
+    assert(cap > 0);
+
+    if (!ResizePoolArray(arena.buf, cap)) {
+        return false;
+    }
+
+    arena.cap = cap;
+
+    return true;
+}
+
+static void FreeFrameArenaOverflowBlocks(s_frame_arena& arena) {
+    zf4::a_byte* block = arena.overflow_blocks;
+
+    while (block) {
+        zf4::a_byte* const next = *reinterpret_cast<zf4::a_byte**>(block);
+        std::free(block);
+        block = next;
+    }
+
+    arena.overflow_blocks = nullptr;
+}
+
+void CleanFrameArena(s_frame_arena& arena) {
+    FreeFrameArenaOverflowBlocks(arena);
+    std::free(arena.buf);
+    zf4::ZeroOutStruct(arena);
+}
+
+// Frees everything handed out since the last reset. If overflow blocks were needed, the block is first grown to cover all that was used, so that the same amount fits next time. Should that fail, the block is just left as it was.
+void ResetFrameArena(s_frame_arena& arena) {
+    if (arena.overflow_blocks) {
+        FreeFrameArenaOverflowBlocks(arena);
+
+        const int cap = CalcPoolCap(arena.cap, arena.offs + arena.overflow_size, i_frame_arena_init_cap);
+
+        if (ResizePoolArray(arena.buf, cap)) {
+            arena.cap = cap;
+        }
+
+        arena.overflow_size = 0;
+    }
+
+    arena.offs = 0;
+}
+
+void* PushToFrameArena(s_frame_arena& arena, const int size, const int alignment) {
+    assert(size >= 0);
+    assert(alignment <= (int)alignof(std::max_align_t));
+
+    const int offs = AlignUp(arena.offs, alignment);
+
+    if (offs + size <= arena.cap) {
+        arena.offs = offs + size;
+        return arena.buf + offs;
+    }
+
+    // Give the allocation an overflow block of its own, sized with the alignment padding so that growing the block to the total on reset is enough.
+    zf4::a_byte* block = nullptr;
+
+    if (!ResizePoolArray(block, i_frame_arena_overflow_header_size + size)) {
+        return nullptr;
+    }
+
+    *reinterpret_cast<zf4::a_byte**>(block) = arena.overflow_blocks;
+    arena.overflow_blocks = block;
+    arena.overflow_size += size + alignment;
+
+    return block + i_frame_arena_overflow_header_size;
+}
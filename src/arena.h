@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <zf4.h>
+
+static constexpr int i_frame_arena_init_cap = 1 << 16;
+
+// Scratch memory for data that lives no longer than a tick, handed out by bumping an offset and freed all at once by resetting it.
+// NOTE: Allocations cannot move once handed out, so when the block runs out partway through a tick, further allocations come from overflow blocks instead. The next reset frees those and grows the block to the most that was used, so once sizes settle no allocations are made at all.
+struct s_frame_arena {
+    zf4::a_byte* buf;
+    int cap;
+    int offs;
+
+    zf4::a_byte* overflow_blocks; // Linked through a pointer at the start of each.
+    int overflow_size; // Bytes handed out from overflow blocks since the last reset.
+};
+
+bool InitFrameArena(s_frame_arena& arena, const int cap = i_frame_arena_init_cap);
+void CleanFrameArena(s_frame_arena& arena);
+void ResetFrameArena(s_frame_arena& arena);
+void* PushToFrameArena(s_frame_arena& arena, const int size, const int alignment);
+
+// Returns null if an overflow block was needed and could not be allocated. The memory is not zeroed.
+template<typename T>
+static inline T* PushArrayToFrameArena(s_frame_arena& arena, const int cnt) {
+    return static_cast<T*>(PushToFrameArena(arena, sizeof(T) * cnt, alignof(T)));
+}
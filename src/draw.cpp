@@ -0,0 +1,164 @@
+#include "draw.h"
+
+#include <cstdio>
+
+// Checks whether a sprite drawn with a centered origin could overlap the camera rect. Half the diagonal is used as the extent so that any rotation is covered.
+static bool IsSpriteInView(const zf4::s_vec_2d pos, const e_sprite_index sprite_index, const zf4::s_rect cam_rect) {
+    const zf4::s_rect_i src_rect = i_sprite_src_rects[sprite_index];
+    const float extent = sqrtf((float)((src_rect.width * src_rect.width) + (src_rect.height * src_rect.height))) / 2.0f;
+
+    return pos.x + extent > cam_rect.x && pos.x - extent < RectRight(cam_rect)
+        && pos.y + extent > cam_rect.y && pos.y - extent < RectBottom(cam_rect);
+}
+
+// Submits the enemies, player and projectiles in view to the batch, counting those submitted and culled. The batch is left for the caller to flush.
+void SubmitLevelSprites(s_sprite_batch& sprites, const s_game& game, const s_draw_view& view, const zf4::s_rect cam_rect, s_cull_stats& cull_stats) {
+    // Draw enemies, a type at a time.
+    for (int t = 0; t < eks_enemy_type_cnt; ++t) {
+        const s_enemy_archetype& archetype = game.enemies.archetypes[t];
+        const e_sprite_index sprite_index = i_enemy_type_sprite_indexes[t];
+
+        for (int i = 0; i < archetype.len; ++i) {
+            const s_enemy& enemy = archetype[i];
+            const zf4::s_vec_2d pos = enemy.pos - (enemy.vel * view.tick_lag);
+
+            if (!IsSpriteInView(pos, sprite_index, cam_rect)) {
+                ++cull_stats.culled_cnt;
+                continue;
+            }
+
+            SubmitSprite(sprites, i_sprite_src_rects[sprite_index], pos, {0.5f, 0.5f}, {1.0f, 1.0f}, enemy.rot);
+            ++cull_stats.submitted_cnt;
+        }
+    }
+
+    // Draw the player.
+    if (game.player_active) {
+        const float alpha = game.player.inv_cooldown > 0 ? 0.5f + (0.25f * (game.player.inv_cooldown & 1)) : 1.0f;
+        SubmitSprite(sprites, i_sprite_src_rects[ek_sprite_index_player], view.player_pos, {0.5f, 0.5f}, {1.0f, 1.0f}, view.player_rot, {1.0f, 1.0f, 1.0f, alpha});
+        ++cull_stats.submitted_cnt;
+    }
+
+    // Draw projectiles.
+    for (int i = 0; i < game.projectiles.len; ++i) {
+        const zf4::s_vec_2d pos = {game.projectiles.pos_xs[i] - (game.projectiles.vel_xs[i] * view.tick_lag), game.projectiles.pos_ys[i] - (game.projectiles.vel_ys[i] * view.tick_lag)};
+
+        if (!IsSpriteInView(pos, ek_sprite_index_bullet, cam_rect)) {
+            ++cull_stats.culled_cnt;
+            continue;
+        }
+
+        SubmitSprite(sprites, i_sprite_src_rects[ek_sprite_index_bullet], pos);
+        ++cull_stats.submitted_cnt;
+    }
+}
+
+// The rule names with the space that separates them from the time left, so that the label does not need formatting.
+static constexpr zf4::s_static_array<const char*, eks_rule_type_cnt> i_hud_rule_labels = {
+    "No Rule ",
+    "Inverted Movement ",
+    "Inverted Bullets ",
+    "Halved Movement Speed "
+};
+
+static_assert(i_hud_rule_labels.len == eks_rule_type_cnt);
+
+// Draws the HUD text through the text run cache. Anything batched that should appear beneath it must be flushed first.
+// Each line is drawn as a label and a value, each its own run, so that a value changing does not have the label laid out again with it.
+void DrawHud(s_text_run_cache& text_runs, s_hud_strs& hud_strs, const s_sdf_font& font, const s_game& game, const s_hud_info& info, const zf4::s_matrix_4x4& view_mat, const zf4::s_vec_2d_i window_size, const GLuint prog_gl_id) {
+    // The label and value together are aligned as a whole, horizontally, so the value is placed after the label by measuring the two. The widths are kept, so a line is only measured again once its text changes.
+    const auto draw_line = [&text_runs, &hud_strs, &font, &view_mat, window_size, prog_gl_id](const e_hud_line line, const char* const label, const char* const val, const float pt_size, const zf4::s_vec_2d pos, const zf4::e_str_hor_align hor_align, const zf4::e_str_ver_align ver_align) {
+        float& label_width = hud_strs.label_widths[line];
+        float& val_width = hud_strs.val_widths[line];
+
+        if (label_width == 0.0f) {
+            label_width = MeasureTextRunWidth(label, font, pt_size);
+        }
+
+        if (val_width == 0.0f) {
+            val_width = MeasureTextRunWidth(val, font, pt_size);
+        }
+
+        const float width = label_width + val_width;
+
+        const float left = hor_align == zf4::ek_str_hor_align_left ? pos.x : (hor_align == zf4::ek_str_hor_align_center ? pos.x - (width / 2.0f) : pos.x - width);
+
+        DrawTextRun(text_runs, label, font, pt_size, {left, pos.y}, zf4::colors::g_white, zf4::ek_str_hor_align_left, ver_align, view_mat, window_size, prog_gl_id);
+        DrawTextRun(text_runs, val, font, pt_size, {left + label_width, pos.y}, zf4::colors::g_white, zf4::ek_str_hor_align_left, ver_align, view_mat, window_size, prog_gl_id);
+    };
+
+    // Draw player statistics. The string is only formatted again when the HP changes.
+    if (game.player_active) {
+        if (hud_strs.hp != game.player.hp || hud_strs.hp_str[0] == '\0') {
+            std::snprintf(hud_strs.hp_str, sizeof(hud_strs.hp_str), "%d", game.player.hp);
+            hud_strs.hp = game.player.hp;
+            hud_strs.val_widths[ek_hud_line_hp] = 0.0f;
+        }
+
+        draw_line(ek_hud_line_hp, "HP: ", hud_strs.hp_str, 28.0f, {window_size.x - 10.0f, 10.0f}, zf4::ek_str_hor_align_right, zf4::ek_str_ver_align_top);
+    }
+
+    // Draw rule text. The time until the rule changes is shown in whole seconds, so it only changes once a second.
+    {
+        const int rule_secs = (game.rule_change_time + 59) / 60;
+
+        if (hud_strs.rule_type != game.rule_type || hud_strs.rule_secs_str[0] == '\0') {
+            hud_strs.rule_type = game.rule_type;
+            hud_strs.label_widths[ek_hud_line_rule] = 0.0f;
+        }
+
+        if (hud_strs.rule_secs != rule_secs || hud_strs.rule_secs_str[0] == '\0') {
+            std::snprintf(hud_strs.rule_secs_str, sizeof(hud_strs.rule_secs_str), "(%d)", rule_secs);
+            hud_strs.rule_secs = rule_secs;
+            hud_strs.val_widths[ek_hud_line_rule] = 0.0f;
+        }
+
+        const zf4::s_vec_2d pos = {
+            window_size.x / 2.0f,
+            (window_size.y / 6.0f) * 5.0f
+        };
+
+        draw_line(ek_hud_line_rule, i_hud_rule_labels[game.rule_type], hud_strs.rule_secs_str, 36.0f, pos, zf4::ek_str_hor_align_center, zf4::ek_str_ver_align_top);
+    }
+
+    // Format the readouts again only if they have been refreshed.
+    if (hud_strs.info_version != info.version || hud_strs.fps_str[0] == '\0') {
+        std::snprintf(hud_strs.fps_str, sizeof(hud_strs.fps_str), "%.2f", info.fps);
+        std::snprintf(hud_strs.cull_str, sizeof(hud_strs.cull_str), "%d (%d culled), Lights: %d", info.cull_stats.submitted_cnt, info.cull_stats.culled_cnt, info.cull_stats.light_cnt);
+
+        if (info.slowest_phase_found) {
+            std::snprintf(hud_strs.phase_str, sizeof(hud_strs.phase_str), "%s (%.2f ms)", i_profile_zone_names[info.slowest_phase], info.slowest_phase_ms);
+        }
+
+        if (info.latency_found) {
+            std::snprintf(hud_strs.latency_str, sizeof(hud_strs.latency_str), "%.2f ms (Late Latch %s)", info.latency_ms, info.late_latch ? "On" : "Off");
+        }
+
+        std::snprintf(hud_strs.res_str, sizeof(hud_strs.res_str), "%d%% (Dynamic %s)", (int)((info.level_res_scale * 100.0f) + 0.5f), info.dynamic_res ? "On" : "Off");
+
+        hud_strs.info_version = info.version;
+
+        for (int i = ek_hud_line_fps; i < eks_hud_line_cnt; ++i) {
+            hud_strs.val_widths[i] = 0.0f;
+        }
+    }
+
+    // Draw FPS.
+    draw_line(ek_hud_line_fps, "FPS: ", hud_strs.fps_str, 18.0f, {10.0f, 10.0f}, zf4::ek_str_hor_align_left, zf4::ek_str_ver_align_top);
+
+    // Draw culling statistics.
+    draw_line(ek_hud_line_cull, "Sprites: ", hud_strs.cull_str, 18.0f, {10.0f, 34.0f}, zf4::ek_str_hor_align_left, zf4::ek_str_ver_align_top);
+
+    // Draw profiling information.
+    if (info.slowest_phase_found) {
+        draw_line(ek_hud_line_phase, "Slowest Phase: ", hud_strs.phase_str, 18.0f, {10.0f, 58.0f}, zf4::ek_str_hor_align_left, zf4::ek_str_ver_align_top);
+    }
+
+    // Draw input latency.
+    if (info.latency_found) {
+        draw_line(ek_hud_line_latency, "Input Latency: ", hud_strs.latency_str, 18.0f, {10.0f, 82.0f}, zf4::ek_str_hor_align_left, zf4::ek_str_ver_align_top);
+    }
+
+    // Draw the level resolution.
+    draw_line(ek_hud_line_res, "Level Resolution: ", hud_strs.res_str, 18.0f, {10.0f, 106.0f}, zf4::ek_str_hor_align_left, zf4::ek_str_ver_align_top);
+}
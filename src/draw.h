@@ -0,0 +1,87 @@
+#pragma once
+
+#include <zf4.h>
+#include "game.h"
+#include "profiler.h"
+#include "sdf_font.h"
+#include "sprite_batch.h"
+#include "text_run.h"
+
+// Counts of world-space sprites sent to the renderer and skipped for being out of view, and of lights drawn, for the last frame drawn.
+struct s_cull_stats {
+    int submitted_cnt;
+    int culled_cnt;
+    int light_cnt;
+};
+
+// What the level is drawn from. With late latching, moving things are interpolated between their last two tick positions and the aim follows a mouse position sampled just before drawing. Otherwise this is the last tick's state as is.
+struct s_draw_view {
+    zf4::s_vec_2d cam_pos;
+    zf4::s_vec_2d player_pos;
+    float player_rot;
+    zf4::s_vec_2d mouse_pos;
+    float tick_lag; // How far back towards their previous positions things are drawn, as a fraction of their velocity.
+};
+
+// The lines of the HUD, each drawn as a label followed by a value.
+enum e_hud_line {
+    ek_hud_line_hp,
+    ek_hud_line_rule,
+    ek_hud_line_fps,
+    ek_hud_line_cull,
+    ek_hud_line_phase,
+    ek_hud_line_latency,
+    ek_hud_line_res,
+
+    eks_hud_line_cnt
+};
+
+// HUD strings kept formatted between frames, along with the values they were formatted from. Only the values are held, as the labels beside them never change.
+struct s_hud_strs {
+    int hp;
+    char hp_str[20];
+
+    e_rule_type rule_type;
+    int rule_secs;
+    char rule_secs_str[20];
+
+    int info_version;
+    char fps_str[20];
+    char cull_str[64];
+    char phase_str[64];
+    char latency_str[64];
+    char res_str[64];
+
+    // The widths of the label and value of each line at the size the line is drawn, or 0 if yet to be measured. A value is measured again only once it has been formatted again.
+    zf4::s_static_array<float, eks_hud_line_cnt> label_widths;
+    zf4::s_static_array<float, eks_hud_line_cnt> val_widths;
+};
+
+// What the HUD shows besides the game state. The window build gathers these from the profiler and latency tracker at a fixed rate, while the draw benchmark makes them up.
+// NOTE: Values that change from frame to frame would have their text laid out again every frame, so they are only refreshed now and then rather than kept current.
+struct s_hud_info {
+    int version; // Incremented whenever the values are refreshed, so that the HUD knows when to format them again.
+
+    double fps;
+    s_cull_stats cull_stats;
+
+    bool slowest_phase_found;
+    e_profile_zone slowest_phase;
+    float slowest_phase_ms;
+
+    bool latency_found;
+    float latency_ms;
+    bool late_latch;
+
+    float level_res_scale;
+    bool dynamic_res;
+};
+
+static inline zf4::s_rect LoadCameraRect(const zf4::s_vec_2d cam_pos, const zf4::s_vec_2d_i window_size) {
+    const zf4::s_vec_2d top_left = CameraTopLeft(cam_pos, window_size);
+    const zf4::s_vec_2d size = CameraSize(window_size);
+    return {top_left.x, top_left.y, size.x, size.y};
+}
+
+void SubmitLevelSprites(s_sprite_batch& sprites, const s_game& game, const s_draw_view& view, const zf4::s_rect cam_rect, s_cull_stats& cull_stats);
+void DrawHud(s_text_run_cache& text_runs, s_hud_strs& hud_strs, const s_sdf_font& font, const s_game& game, const s_hud_info& info, const zf4::s_matrix_4x4& view_mat, const zf4::s_vec_2d_i window_size, const GLuint prog_gl_id);
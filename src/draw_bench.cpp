@@ -0,0 +1,274 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <algorithm>
+#include <vector>
+#include "game.h"
+#include "draw.h"
+
+// NOTE: This builds the frame's sprite batches and HUD text as the window build does, but with the sprite batch and text run cache recording rather than drawing, so that no GL context is needed and it can run on machines without a GPU.
+// Only the CPU side of drawing is measured. The tile layer and lighting upload straight to the GPU, so they are left out.
+
+static constexpr zf4::s_vec_2d_i i_window_size = {1280, 720};
+static constexpr int i_default_frame_cnt = 100;
+static constexpr uint64_t i_bench_seed = 12345;
+
+// Stand-ins for the sprite program and texture, which are only recorded and never used.
+static constexpr GLuint i_bench_prog_gl_id = 1;
+static constexpr GLuint i_bench_tex_gl_id = 1;
+
+// Half of each count is enemies and half projectiles.
+static constexpr int i_default_entity_cnts[] = {1000, 4000, 16000, 64000};
+
+struct s_frame_stats {
+    s_cull_stats cull_stats;
+    int recorded_sprite_cnt;
+    int sprite_flush_cnt;
+    int glyph_cnt;
+    int text_draw_cnt;
+    int layout_cnt;
+};
+
+// Spreads the entities over the level as the headless stress test does, so that some fall outside the camera and are culled.
+static bool SpawnBenchEntities(s_game& game, const int entity_cnt) {
+    unsigned int seed = 54321;
+
+    const auto next_rand_perc = [&seed]() {
+        seed = (seed * 1664525u) + 1013904223u;
+        return (seed >> 8) / (float)(1 << 24);
+    };
+
+    const zf4::s_vec_2d_i level_size = LevelSize(game.tilemap);
+    const zf4::s_vec_2d spawn_area_size = {(float)(level_size.x - (i_tile_size * 4)), (float)(level_size.y - (i_tile_size * 4))};
+
+    for (int i = 0; i < entity_cnt; ++i) {
+        const zf4::s_vec_2d pos = {(i_tile_size * 2) + (next_rand_perc() * spawn_area_size.x), (i_tile_size * 2) + (next_rand_perc() * spawn_area_size.y)};
+
+        if (i % 2 == 0) {
+            const e_enemy_type type = next_rand_perc() < 0.7f ? ek_enemy_type_red : ek_enemy_type_purple;
+
+            if (SpawnEnemy(pos, type, game.enemies).slot == -1) {
+                return false;
+            }
+        } else {
+            if (SpawnProjectile(pos, 0.05f, next_rand_perc() * zf4::g_pi * 2.0f, i % 4 == 1, game.projectiles).slot == -1) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+// Gives the font metrics roughly those of the real font at its source size. Layout only reads the metrics, so their exact values do not matter here.
+static void LoadBenchFont(s_sdf_font& font) {
+    font.src_pt_size = 72.0f;
+    font.line_height = 84;
+
+    for (int i = 0; i < zf4::g_font_chr_range_len; ++i) {
+        font.chr_hor_offsets[i] = 2;
+        font.chr_ver_offsets[i] = 8;
+        font.chr_hor_advances[i] = 40;
+        font.chr_src_rects[i] = {(i % 16) * 56, (i / 16) * 88, 56, 88};
+    }
+}
+
+static constexpr int i_hud_info_refresh_frame_interval = 15; // The window build's refresh interval at 60 FPS.
+
+// Builds a frame in the same order as the window build: the level sprites, then the HUD text, then the cursor.
+static s_frame_stats BuildFrame(s_sprite_batch& sprites, s_text_run_cache& text_runs, s_hud_strs& hud_strs, const s_sdf_font& font, const s_game& game, const s_draw_view& view, const int frame_index) {
+    s_frame_stats stats = {};
+
+    ClearSpriteCmdStream(sprites);
+
+    zf4::s_matrix_4x4 view_mat = {};
+    zf4::InitIdentityMatrix4x4(view_mat);
+
+    const zf4::s_rect cam_rect = LoadCameraRect(view.cam_pos, i_window_size);
+
+    BeginSpriteBatch(sprites, i_bench_prog_gl_id, i_bench_tex_gl_id, {64, 64}, view_mat, i_window_size);
+    SubmitLevelSprites(sprites, game, view, cam_rect, stats.cull_stats);
+    FlushSpriteBatch(sprites);
+
+    BeginSpriteBatch(sprites, i_bench_prog_gl_id, i_bench_tex_gl_id, {64, 64}, view_mat, i_window_size);
+
+    BeginTextRunFrame(text_runs);
+
+    // The readouts are refreshed every so many frames, as they are in the window build, with the FPS changing on each refresh.
+    const int refresh_index = frame_index / i_hud_info_refresh_frame_interval;
+
+    const s_hud_info hud_info = {
+        .version = refresh_index + 1,
+        .fps = 60.0 + (refresh_index * 0.01),
+        .cull_stats = stats.cull_stats,
+        .slowest_phase_found = true,
+        .slowest_phase = ek_profile_zone_collision_processing,
+        .slowest_phase_ms = 0.25f,
+        .latency_found = true,
+        .latency_ms = 12.5f,
+        .level_res_scale = 1.0f
+    };
+
+    DrawHud(text_runs, hud_strs, font, game, hud_info, view_mat, i_window_size, i_bench_prog_gl_id);
+
+    SubmitSprite(sprites, i_sprite_src_rects[ek_sprite_index_cursor], view.mouse_pos, {0.5f, 0.5f}, {2.0f, 2.0f});
+    FlushSpriteBatch(sprites);
+
+    stats.recorded_sprite_cnt = sprites.cmd_stream.inst_cnt;
+    stats.sprite_flush_cnt = sprites.cmd_stream.cmd_cnt;
+    stats.glyph_cnt = text_runs.drawn_glyph_cnt;
+    stats.text_draw_cnt = text_runs.draw_cnt;
+    stats.layout_cnt = text_runs.layout_cnt;
+
+    return stats;
+}
+
+static double Percentile(const std::vector<double>& sorted_vals, const double perc) {
+    assert(!sorted_vals.empty());
+    const size_t index = std::min(sorted_vals.size() - 1, (size_t)(perc * (sorted_vals.size() - 1) + 0.5));
+    return sorted_vals[index];
+}
+
+// Runs the frames for one entity count and prints the results. Returns false if the recording did not match what was submitted, or if the time per submission was over the given limit (if there is one).
+static bool RunDrawBenchmark(const int entity_cnt, const int frame_cnt, const double ns_per_submission_limit) {
+    // NOTE: These are heap-allocated since they are large.
+    const auto game = static_cast<s_game*>(std::calloc(1, sizeof(s_game)));
+    const auto sprites = static_cast<s_sprite_batch*>(std::calloc(1, sizeof(s_sprite_batch)));
+    const auto text_runs = static_cast<s_text_run_cache*>(std::calloc(1, sizeof(s_text_run_cache)));
+    const auto font = static_cast<s_sdf_font*>(std::calloc(1, sizeof(s_sdf_font)));
+
+    bool success = game && sprites && text_runs && font;
+
+    if (!success) {
+        std::fprintf(stderr, "Failed to allocate benchmark state!\n");
+    }
+
+    bool game_initted = false;
+    bool sprites_initted = false;
+
+    if (success) {
+        game_initted = InitGameState(*game, i_bench_seed);
+        sprites_initted = game_initted && InitSpriteBatch(*sprites, true);
+
+        if (!sprites_initted || !SpawnBenchEntities(*game, entity_cnt)) {
+            std::fprintf(stderr, "Failed to set up the game state and sprite batch!\n");
+            success = false;
+        }
+    }
+
+    if (success) {
+        InitTextRunCache(*text_runs, true);
+        LoadBenchFont(*font);
+
+        // Moving things are drawn partway back along their velocity, as with late latching.
+        const s_draw_view view = {
+            .cam_pos = game->cam_pos,
+            .player_pos = game->player.pos,
+            .player_rot = game->player.rot,
+            .mouse_pos = {i_window_size.x / 2.0f, i_window_size.y / 2.0f},
+            .tick_lag = 0.5f
+        };
+
+        s_hud_strs hud_strs = {};
+
+        // Warm up, so that the command stream and text runs are sized and laid out before timing.
+        s_frame_stats stats = BuildFrame(*sprites, *text_runs, hud_strs, *font, *game, view, 0);
+
+        std::vector<double> frame_times_ns(frame_cnt);
+
+        for (int i = 0; i < frame_cnt; ++i) {
+            const auto frame_begin = std::chrono::steady_clock::now();
+            stats = BuildFrame(*sprites, *text_runs, hud_strs, *font, *game, view, i + 1);
+            frame_times_ns[i] = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - frame_begin).count();
+        }
+
+        std::sort(frame_times_ns.begin(), frame_times_ns.end());
+
+        const int submitted_sprite_cnt = stats.cull_stats.submitted_cnt + 1; // Including the cursor.
+        const int submission_cnt = submitted_sprite_cnt + stats.glyph_cnt;
+        const double frame_ns = Percentile(frame_times_ns, 0.5);
+
+        std::printf("%d entities: %d sprites (%d culled), %d glyphs, %d flushes (%d sprite, %d text), %d layouts\n", entity_cnt, submitted_sprite_cnt, stats.cull_stats.culled_cnt, stats.glyph_cnt, stats.sprite_flush_cnt + stats.text_draw_cnt, stats.sprite_flush_cnt, stats.text_draw_cnt, stats.layout_cnt);
+        std::printf("  frame ns p50: %.0f, p90: %.0f, ns/submission: %.2f\n", frame_ns, Percentile(frame_times_ns, 0.9), frame_ns / submission_cnt);
+
+        if (sprites->cmd_stream.overflowed || stats.recorded_sprite_cnt != submitted_sprite_cnt) {
+            std::fprintf(stderr, "Recorded %d sprites but %d were submitted!\n", stats.recorded_sprite_cnt, submitted_sprite_cnt);
+            success = false;
+        }
+
+        if (ns_per_submission_limit > 0.0 && frame_ns / submission_cnt > ns_per_submission_limit) {
+            std::fprintf(stderr, "Time per submission is over the limit of %.2f ns!\n", ns_per_submission_limit);
+            success = false;
+        }
+
+        CleanTextRunCache(*text_runs);
+    }
+
+    if (sprites_initted) {
+        CleanSpriteBatch(*sprites);
+    }
+
+    if (game_initted) {
+        CleanGameState(*game);
+    }
+
+    std::free(font);
+    std::free(text_runs);
+    std::free(sprites);
+    std::free(game);
+
+    return success;
+}
+
+static void PrintUsage(const char* const exe_name) {
+    std::fprintf(stderr, "Usage: %s [--entities <cnt>] [--frames <cnt>] [--max-ns-per-submission <ns>]\n", exe_name);
+}
+
+int main(const int arg_cnt, const char* const* const args) {
+    int entity_cnt = 0; // 0 to run each of the default counts.
+    int frame_cnt = i_default_frame_cnt;
+    double ns_per_submission_limit = 0.0; // 0 for no limit.
+
+    for (int i = 1; i < arg_cnt; ++i) {
+        if (std::strcmp(args[i], "--entities") == 0 && i + 1 < arg_cnt) {
+            entity_cnt = std::atoi(args[++i]);
+
+            if (entity_cnt <= 0) {
+                PrintUsage(args[0]);
+                return EXIT_FAILURE;
+            }
+        } else if (std::strcmp(args[i], "--frames") == 0 && i + 1 < arg_cnt) {
+            frame_cnt = std::atoi(args[++i]);
+
+            if (frame_cnt <= 0) {
+                PrintUsage(args[0]);
+                return EXIT_FAILURE;
+            }
+        } else if (std::strcmp(args[i], "--max-ns-per-submission") == 0 && i + 1 < arg_cnt) {
+            ns_per_submission_limit = std::atof(args[++i]);
+
+            if (ns_per_submission_limit <= 0.0) {
+                PrintUsage(args[0]);
+                return EXIT_FAILURE;
+            }
+        } else {
+            PrintUsage(args[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    bool success = true;
+
+    if (entity_cnt > 0) {
+        success = RunDrawBenchmark(entity_cnt, frame_cnt, ns_per_submission_limit);
+    } else {
+        for (const int cnt : i_default_entity_cnts) {
+            if (!RunDrawBenchmark(cnt, frame_cnt, ns_per_submission_limit)) {
+                success = false;
+            }
+        }
+    }
+
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
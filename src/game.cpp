@@ -0,0 +1,1133 @@
+#include "game.h"
+
+#include <cstring>
+#include "jobs.h"
+#include "profiler.h"
+
+// NOTE: These are the fewest items a parallel phase hands to one job. Below them the phase runs on the ticking thread alone.
+static constexpr int i_enemy_job_range_len = 64;
+static constexpr int i_projectile_movement_job_range_len = 4096;
+static constexpr int i_projectile_collision_job_range_len = 512;
+
+static zf4::s_rect LoadColliderFromSprite(const zf4::s_vec_2d pos, const e_sprite_index sprite_index) {
+    assert(sprite_index >= 0 && sprite_index < eks_sprite_cnt);
+
+    zf4::s_rect collider = {
+        .width = (float)i_sprite_src_rects[sprite_index].width,
+        .height = (float)i_sprite_src_rects[sprite_index].height
+    };
+
+    // NOTE: At the moment we assume a centered origin.
+    collider.x = pos.x - (collider.width / 2.0f);
+    collider.y = pos.y - (collider.height / 2.0f);
+
+    return collider;
+}
+
+static zf4::s_vec_2d CalcKnockback(const zf4::s_vec_2d pos, const zf4::s_vec_2d inflictor_pos, const float strength) {
+    // TODO: Handle different knockback types.
+
+    if (pos == inflictor_pos) {
+        return {};
+    }
+
+    const zf4::s_vec_2d kb_dir = Normal(pos - inflictor_pos);
+    return kb_dir * strength;
+}
+
+static void HurtPlayer(s_player& player, const int dmg, const zf4::s_vec_2d knockback) {
+    assert(player.inv_cooldown == 0);
+    assert(dmg > 0);
+
+    player.vel += knockback;
+    player.hp -= dmg;
+    player.inv_cooldown = 20;
+}
+
+static zf4::s_rect GenEnemyCollider(const zf4::s_vec_2d pos, const e_enemy_type type) {
+    assert(type >= 0 && type < eks_enemy_type_cnt);
+    return LoadColliderFromSprite(pos, i_enemy_type_sprite_indexes[type]);
+}
+
+template<e_enemy_type tp_type>
+static void LoadEnemyColliders(zf4::s_rect* const colliders, const s_enemy_archetype& archetype) {
+    for (int i = 0; i < archetype.len; ++i) {
+        colliders[i] = LoadColliderFromSprite(archetype[i].pos, i_enemy_type_sprite_indexes[tp_type]);
+    }
+}
+
+struct s_enemy_grid_cell_range {
+    int x_begin;
+    int y_begin;
+    int x_end;
+    int y_end;
+};
+
+// NOTE: The range is in unwrapped cell positions, so it can lie partly or fully outside the level; the positions are only wrapped when turned into cell indexes.
+static s_enemy_grid_cell_range LoadEnemyGridCellRange(const zf4::s_rect rect) {
+    return {
+        .x_begin = (int)floorf(rect.x / i_enemy_grid_cell_size),
+        .y_begin = (int)floorf(rect.y / i_enemy_grid_cell_size),
+        .x_end = (int)floorf(RectRight(rect) / i_enemy_grid_cell_size) + 1,
+        .y_end = (int)floorf(RectBottom(rect) / i_enemy_grid_cell_size) + 1
+    };
+}
+
+static inline int EnemyGridCellIndex(const int x, const int y) {
+    return ((y & (i_enemy_grid_size.y - 1)) * i_enemy_grid_size.x) + (x & (i_enemy_grid_size.x - 1));
+}
+
+// Loads the enemy colliders and buckets them into the grid, taking the arrays from the frame arena. The query count is how many rects are to be tested against the enemies, which decides whether bucketing is worth it. Returns false if the arena could not fit the arrays.
+static bool BuildEnemyGrid(s_enemy_grid& grid, const s_enemies& enemies, const int query_cnt, s_frame_arena& arena) {
+    const int enemy_cnt = CountEnemies(enemies);
+
+    grid.colliders = PushArrayToFrameArena<zf4::s_rect>(arena, enemy_cnt);
+
+    if (!grid.colliders) {
+        return false;
+    }
+
+    grid.type_enemy_begins[0] = 0;
+
+    ForEachEnemyType([&grid, &enemies](const auto type) {
+        const int begin = grid.type_enemy_begins[type];
+        LoadEnemyColliders<type>(grid.colliders + begin, enemies.archetypes[type]);
+        grid.type_enemy_begins[type + 1] = begin + enemies.archetypes[type].len;
+    });
+
+    grid.brute_force = (int64_t)enemy_cnt * query_cnt <= i_enemy_grid_brute_force_pair_limit;
+
+    if (grid.brute_force) {
+        return true;
+    }
+
+    // Start the cells afresh. Should the stamp wrap around, every cell is cleared so that none is mistaken for being touched in this build.
+    ++grid.stamp;
+
+    if (grid.stamp == 0) {
+        for (int i = 0; i < grid.cell_stamps.len; ++i) {
+            grid.cell_stamps[i] = 0;
+        }
+
+        grid.stamp = 1;
+    }
+
+    const auto touched_cell_indexes = PushArrayToFrameArena<int>(arena, enemy_cnt * i_enemy_grid_cell_span_limit);
+
+    if (!touched_cell_indexes) {
+        return false;
+    }
+
+    int touched_cell_cnt = 0;
+
+    // Count the entries for each cell the enemies touch, noting each cell the first time it is touched.
+    for (int i = 0; i < enemy_cnt; ++i) {
+        const s_enemy_grid_cell_range range = LoadEnemyGridCellRange(grid.colliders[i]);
+
+        for (int y = range.y_begin; y < range.y_end; ++y) {
+            for (int x = range.x_begin; x < range.x_end; ++x) {
+                const int cell_index = EnemyGridCellIndex(x, y);
+
+                if (grid.cell_stamps[cell_index] != grid.stamp) {
+                    grid.cell_stamps[cell_index] = grid.stamp;
+                    grid.cell_lens[cell_index] = 0;
+                    touched_cell_indexes[touched_cell_cnt] = cell_index;
+                    ++touched_cell_cnt;
+                }
+
+                ++grid.cell_lens[cell_index];
+            }
+        }
+    }
+
+    // Lay the touched cells' entries out one after another. The lengths are zeroed to be counted back up as the entries are filled in.
+    int entry_cnt = 0;
+
+    for (int i = 0; i < touched_cell_cnt; ++i) {
+        const int cell_index = touched_cell_indexes[i];
+        grid.cell_begins[cell_index] = entry_cnt;
+        entry_cnt += grid.cell_lens[cell_index];
+        grid.cell_lens[cell_index] = 0;
+    }
+
+    // The entries are sized to the actual count rather than the most every enemy could span.
+    grid.enemy_indexes = PushArrayToFrameArena<int>(arena, entry_cnt);
+
+    if (!grid.enemy_indexes) {
+        return false;
+    }
+
+    // Each cell's entries come out in ascending enemy index order.
+    for (int i = 0; i < enemy_cnt; ++i) {
+        const s_enemy_grid_cell_range range = LoadEnemyGridCellRange(grid.colliders[i]);
+
+        for (int y = range.y_begin; y < range.y_end; ++y) {
+            for (int x = range.x_begin; x < range.x_end; ++x) {
+                const int cell_index = EnemyGridCellIndex(x, y);
+                grid.enemy_indexes[grid.cell_begins[cell_index] + grid.cell_lens[cell_index]] = i;
+                ++grid.cell_lens[cell_index];
+            }
+        }
+    }
+
+    return true;
+}
+
+// Returns the lowest index of an enemy whose collider intersects the given rect, or -1 if there is none. Picking the lowest index gives the same result as testing every enemy in order.
+static int FindEnemyCollision(const zf4::s_rect rect, const s_enemy_grid& grid) {
+    if (grid.brute_force) {
+        for (int i = 0; i < grid.type_enemy_begins[eks_enemy_type_cnt]; ++i) {
+            if (zf4::DoRectsIntersect(rect, grid.colliders[i])) {
+                return i;
+            }
+        }
+
+        return -1;
+    }
+
+    int enemy_index = -1;
+
+    const s_enemy_grid_cell_range range = LoadEnemyGridCellRange(rect);
+
+    for (int y = range.y_begin; y < range.y_end; ++y) {
+        for (int x = range.x_begin; x < range.x_end; ++x) {
+            const int cell_index = EnemyGridCellIndex(x, y);
+
+            if (grid.cell_stamps[cell_index] != grid.stamp) {
+                continue;
+            }
+
+            const int cell_end = grid.cell_begins[cell_index] + grid.cell_lens[cell_index];
+
+            for (int i = grid.cell_begins[cell_index]; i < cell_end; ++i) {
+                const int candidate_index = grid.enemy_indexes[i];
+
+                if (enemy_index != -1 && candidate_index >= enemy_index) {
+                    continue;
+                }
+
+                if (zf4::DoRectsIntersect(rect, grid.colliders[candidate_index])) {
+                    enemy_index = candidate_index;
+                }
+            }
+        }
+    }
+
+    return enemy_index;
+}
+
+// Gives the type of the enemy at an index from the grid, turning the index into one within the type's archetype.
+static e_enemy_type LoadEnemyGridIndexType(const s_enemy_grid& grid, int& index) {
+    int type = 0;
+
+    while (index >= grid.type_enemy_begins[type + 1]) {
+        ++type;
+    }
+
+    assert(type < eks_enemy_type_cnt);
+
+    index -= grid.type_enemy_begins[type];
+
+    return (e_enemy_type)type;
+}
+
+bool ReserveEnemies(s_enemies& enemies, const e_enemy_type type, const int min_cap) {
+    assert(type >= 0 && type < eks_enemy_type_cnt);
+
+    s_enemy_archetype& archetype = enemies.archetypes[type];
+
+    if (min_cap <= archetype.cap) {
+        return true;
+    }
+
+    const int cap = CalcPoolCap(archetype.cap, min_cap, i_enemy_pool_chunk_size);
+
+    if (!ResizePoolArray(archetype.buf, cap) || !ResizePoolArray(archetype.type_data_buf, cap * i_enemy_type_data_sizes[type]) || !ReserveHandleTable(archetype.handles, cap)) {
+        return false;
+    }
+
+    archetype.cap = cap;
+
+    return true;
+}
+
+// Returns a null handle if the enemy pool could not grow.
+s_entity_handle SpawnEnemy(const zf4::s_vec_2d pos, const e_enemy_type type, s_enemies& enemies) {
+    assert(type >= 0 && type < eks_enemy_type_cnt);
+
+    if (!ReserveEnemies(enemies, type, enemies.archetypes[type].len + 1)) {
+        return i_null_entity_handle;
+    }
+
+    s_enemy_archetype& archetype = enemies.archetypes[type];
+
+    const int index = archetype.len;
+    ++archetype.len;
+
+    s_enemy& enemy = archetype[index];
+    zf4::ZeroOutStruct(enemy);
+    enemy.pos = pos;
+    enemy.hp = i_enemy_type_hps[type];
+
+    std::memset(archetype.type_data_buf + (index * i_enemy_type_data_sizes[type]), 0, i_enemy_type_data_sizes[type]);
+
+    return AddHandle(archetype.handles, index);
+}
+
+// Swaps the last enemy of the archetype into the slot being removed.
+static void RemoveEnemy(const int index, s_enemy_archetype& archetype, const e_enemy_type type) {
+    assert(index >= 0 && index < archetype.len);
+
+    const int end_index = archetype.len - 1;
+
+    RemoveHandle(archetype.handles, index, end_index);
+    archetype[index] = archetype[end_index];
+
+    const int data_size = i_enemy_type_data_sizes[type];
+    std::memcpy(archetype.type_data_buf + (index * data_size), archetype.type_data_buf + (end_index * data_size), data_size);
+
+    --archetype.len;
+}
+
+bool ReserveProjectiles(s_projectiles& projectiles, const int min_cap) {
+    if (min_cap <= projectiles.cap) {
+        return true;
+    }
+
+    const int cap = CalcPoolCap(projectiles.cap, min_cap, i_projectile_pool_chunk_size);
+
+    if (!ResizePoolArray(projectiles.pos_xs, cap)
+        || !ResizePoolArray(projectiles.pos_ys, cap)
+        || !ResizePoolArray(projectiles.vel_xs, cap)
+        || !ResizePoolArray(projectiles.vel_ys, cap)
+        || !ResizePoolArray(projectiles.dir_xs, cap)
+        || !ResizePoolArray(projectiles.dir_ys, cap)
+        || !ResizePoolArray(projectiles.spds, cap)
+        || !ResizePoolArray(projectiles.enemy_flags, cap)
+        || !ReserveHandleTable(projectiles.handles, cap)) {
+        return false;
+    }
+
+    projectiles.cap = cap;
+
+    return true;
+}
+
+// Returns a null handle if the projectile pool could not grow.
+s_entity_handle SpawnProjectile(const zf4::s_vec_2d pos, const float spd, const float dir, const bool enemy, s_projectiles& projectiles) {
+    if (!ReserveProjectiles(projectiles, projectiles.len + 1)) {
+        return i_null_entity_handle;
+    }
+
+    const int index = projectiles.len;
+    ++projectiles.len;
+
+    const zf4::s_vec_2d dir_vec = zf4::LenDir(1.0f, dir);
+
+    projectiles.pos_xs[index] = pos.x;
+    projectiles.pos_ys[index] = pos.y;
+    projectiles.vel_xs[index] = dir_vec.x * spd;
+    projectiles.vel_ys[index] = dir_vec.y * spd;
+    projectiles.dir_xs[index] = dir_vec.x;
+    projectiles.dir_ys[index] = dir_vec.y;
+    projectiles.spds[index] = spd;
+    projectiles.enemy_flags[index] = enemy;
+
+    return AddHandle(projectiles.handles, index);
+}
+
+// Swaps the last projectile into the slot being removed.
+static void RemoveProjectile(const int index, s_projectiles& projectiles) {
+    assert(index >= 0 && index < projectiles.len);
+
+    const int end_index = projectiles.len - 1;
+
+    RemoveHandle(projectiles.handles, index, end_index);
+
+    projectiles.pos_xs[index] = projectiles.pos_xs[end_index];
+    projectiles.pos_ys[index] = projectiles.pos_ys[end_index];
+    projectiles.vel_xs[index] = projectiles.vel_xs[end_index];
+    projectiles.vel_ys[index] = projectiles.vel_ys[end_index];
+    projectiles.dir_xs[index] = projectiles.dir_xs[end_index];
+    projectiles.dir_ys[index] = projectiles.dir_ys[end_index];
+    projectiles.spds[index] = projectiles.spds[end_index];
+    projectiles.enemy_flags[index] = projectiles.enemy_flags[end_index];
+
+    --projectiles.len;
+}
+
+static zf4::s_rect LoadTileCollider(const int tx, const int ty) {
+    const zf4::s_vec_2d level_pos = TileToLevelPos(tx, ty);
+    return {level_pos.x, level_pos.y, level_pos.x + i_tile_size, level_pos.y + i_tile_size};
+}
+
+bool TileCollisionCheck(const zf4::s_rect collider, const s_tilemap& tilemap) {
+    const int tx_begin = zf4::Clamp((int)floorf(collider.x / i_tile_size), 0, tilemap.size.x - 1);
+    const int ty_begin = zf4::Clamp((int)floorf(collider.y / i_tile_size), 0, tilemap.size.y - 1);
+
+    const int tx_end = zf4::Clamp((int)ceilf(RectRight(collider) / i_tile_size), 0, tilemap.size.x);
+    const int ty_end = zf4::Clamp((int)ceilf(RectBottom(collider) / i_tile_size), 0, tilemap.size.y);
+
+    for (int ty = ty_begin; ty < ty_end; ++ty) {
+        if (IsTileSpanActive(tx_begin, tx_end, ty, tilemap)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static bool ProcTileCollisions(zf4::s_vec_2d& vel, const zf4::s_rect collider, const s_tilemap& tilemap) {
+    const zf4::s_rect hor_collider = RectTranslated(collider, {vel.x, 0.0f});
+
+    if (TileCollisionCheck(hor_collider, tilemap)) {
+        vel.x = 0.0f;
+    }
+
+    const zf4::s_rect ver_collider = RectTranslated(collider, {0.0f, vel.y});
+
+    if (TileCollisionCheck(ver_collider, tilemap)) {
+        vel.y = 0.0f;
+    }
+
+    // TODO: Handle diagonal collisions.
+
+    return true;
+}
+
+// Loads the map from the given file, or starts a walled arena of the default size if no file is given. Returns false if the map could not be opened or started, or the frame arena could not be allocated.
+bool InitGameState(s_game& game, const uint64_t seed, const char* const map_file_path) {
+    if (map_file_path) {
+        if (!OpenTilemapFile(game.tilemap, map_file_path)) {
+            return false;
+        }
+    } else {
+        if (!InitTilemap(game.tilemap, i_default_tilemap_size)) {
+            return false;
+        }
+
+        for (int x = 0; x < game.tilemap.size.x; ++x) {
+            ActivateTile(x, 0, game.tilemap);
+            ActivateTile(x, game.tilemap.size.y - 1, game.tilemap);
+        }
+
+        for (int y = 0; y < game.tilemap.size.y; ++y) {
+            ActivateTile(0, y, game.tilemap);
+            ActivateTile(game.tilemap.size.x - 1, y, game.tilemap);
+        }
+    }
+
+    // Run the seed through a SplitMix64 step, so that similar seeds give unrelated streams and a seed of 0 does not leave the generator stuck at 0.
+    {
+        uint64_t z = seed + 0x9E3779B97F4A7C15ULL;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        game.rng.state = (z ^ (z >> 31)) | 1;
+    }
+
+    game.player.pos = LevelSize(game.tilemap) / 2.0f;
+    game.player.hp = i_player_hp_limit;
+    game.player_active = true;
+
+    game.cam_pos = game.player.pos;
+
+    game.rule_change_time = i_rule_change_interval;
+
+    if (!InitFrameArena(game.frame_arena)) {
+        CleanTilemap(game.tilemap);
+        return false;
+    }
+
+    return true;
+}
+
+// Frees the memory of the entity pools, the frame arena and the tilemap, leaving the state zeroed.
+void CleanGameState(s_game& game) {
+    for (int i = 0; i < eks_enemy_type_cnt; ++i) {
+        s_enemy_archetype& archetype = game.enemies.archetypes[i];
+        std::free(archetype.buf);
+        std::free(archetype.type_data_buf);
+        CleanHandleTable(archetype.handles);
+    }
+
+    s_projectiles& projs = game.projectiles;
+    std::free(projs.pos_xs);
+    std::free(projs.pos_ys);
+    std::free(projs.vel_xs);
+    std::free(projs.vel_ys);
+    std::free(projs.dir_xs);
+    std::free(projs.dir_ys);
+    std::free(projs.spds);
+    std::free(projs.enemy_flags);
+    CleanHandleTable(projs.handles);
+
+    CleanFrameArena(game.frame_arena);
+
+    CleanTilemap(game.tilemap);
+
+    zf4::ZeroOutStruct(game);
+}
+
+static void HashBytes(uint64_t& hash, const void* const data, const size_t size) {
+    const auto bytes = static_cast<const zf4::a_byte*>(data);
+
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 0x100000001B3ULL;
+    }
+}
+
+// Returns an FNV-1a hash of everything that carries over between ticks. Only live entities are included, and fields are hashed one by one so that padding does not matter.
+uint64_t HashGameState(const s_game& game) {
+    uint64_t hash = 0xCBF29CE484222325ULL;
+
+    HashBytes(hash, &game.player.pos, sizeof(game.player.pos));
+    HashBytes(hash, &game.player.vel, sizeof(game.player.vel));
+    HashBytes(hash, &game.player.rot, sizeof(game.player.rot));
+    HashBytes(hash, &game.player.hp, sizeof(game.player.hp));
+    HashBytes(hash, &game.player.inv_cooldown, sizeof(game.player.inv_cooldown));
+    HashBytes(hash, &game.player.shoot_cooldown, sizeof(game.player.shoot_cooldown));
+    HashBytes(hash, &game.player_active, sizeof(game.player_active));
+
+    ForEachEnemyType([&hash, &game](const auto type) {
+        const s_enemy_archetype& archetype = game.enemies.archetypes[type];
+
+        HashBytes(hash, &archetype.len, sizeof(archetype.len));
+
+        for (int i = 0; i < archetype.len; ++i) {
+            const s_enemy& enemy = archetype[i];
+            HashBytes(hash, &enemy.pos, sizeof(enemy.pos));
+            HashBytes(hash, &enemy.vel, sizeof(enemy.vel));
+            HashBytes(hash, &enemy.rot, sizeof(enemy.rot));
+            HashBytes(hash, &enemy.hp, sizeof(enemy.hp));
+        }
+
+        if constexpr (type == ek_enemy_type_red) {
+            const auto reds = reinterpret_cast<const s_red_enemy*>(archetype.type_data_buf);
+
+            for (int i = 0; i < archetype.len; ++i) {
+                HashBytes(hash, &reds[i].shoot_cooldown, sizeof(reds[i].shoot_cooldown));
+            }
+        }
+    });
+
+    HashBytes(hash, &game.enemy_spawn_time, sizeof(game.enemy_spawn_time));
+
+    const s_projectiles& projs = game.projectiles;
+    HashBytes(hash, &projs.len, sizeof(projs.len));
+    HashBytes(hash, projs.pos_xs, sizeof(*projs.pos_xs) * projs.len);
+    HashBytes(hash, projs.pos_ys, sizeof(*projs.pos_ys) * projs.len);
+    HashBytes(hash, projs.vel_xs, sizeof(*projs.vel_xs) * projs.len);
+    HashBytes(hash, projs.vel_ys, sizeof(*projs.vel_ys) * projs.len);
+    HashBytes(hash, projs.spds, sizeof(*projs.spds) * projs.len);
+    HashBytes(hash, projs.enemy_flags, sizeof(*projs.enemy_flags) * projs.len);
+
+    HashBytes(hash, &game.cam_pos, sizeof(game.cam_pos));
+
+    // The map file is identified by its content hash rather than hashed in full, since only its edited chunks can differ between sessions on the same map.
+    const s_tilemap& tilemap = game.tilemap;
+    HashBytes(hash, &tilemap.size, sizeof(tilemap.size));
+    HashBytes(hash, &tilemap.file_content_hash, sizeof(tilemap.file_content_hash));
+    HashBytes(hash, &tilemap.edited_chunk_cnt, sizeof(tilemap.edited_chunk_cnt));
+    HashBytes(hash, tilemap.edited_chunk_indexes, sizeof(*tilemap.edited_chunk_indexes) * tilemap.edited_chunk_cnt);
+    HashBytes(hash, tilemap.edited_chunks, sizeof(*tilemap.edited_chunks) * tilemap.edited_chunk_cnt);
+
+    HashBytes(hash, &game.rule_type, sizeof(game.rule_type));
+    HashBytes(hash, &game.rule_change_time, sizeof(game.rule_change_time));
+
+    HashBytes(hash, &game.rng.state, sizeof(game.rng.state));
+
+    return hash;
+}
+
+static constexpr zf4::s_static_array<zf4::s_vec_2d_i, i_flow_field_dir_cnt> i_flow_field_dir_offsets = {
+    .elems_raw = {
+        {1, 0},
+        {-1, 0},
+        {0, 1},
+        {0, -1},
+        {1, 1},
+        {-1, 1},
+        {1, -1},
+        {-1, -1}
+    }
+};
+
+static inline zf4::s_vec_2d_i LevelToTilePos(const zf4::s_vec_2d pos, const s_tilemap& tilemap) {
+    return {
+        zf4::Clamp((int)floorf(pos.x / i_tile_size), 0, tilemap.size.x - 1),
+        zf4::Clamp((int)floorf(pos.y / i_tile_size), 0, tilemap.size.y - 1)
+    };
+}
+
+// NOTE: Rows are strided by the full window width whatever the window's actual size, so that positions come back out of indexes with a mask and a shift.
+static inline int FlowFieldIndex(const int x, const int y) {
+    return (y * i_flow_field_size.x) + x;
+}
+
+static inline bool IsFlowFieldPosWithinWindow(const int x, const int y, const s_flow_field& field) {
+    return x >= 0 && y >= 0 && x < field.window_size.x && y < field.window_size.y;
+}
+
+// Rebuilds the flow field if the goal has moved into another tile or the tilemap has changed since the field was last built. Otherwise this costs nothing, so most ticks do no pathfinding at all. Returns false if the scratch for building could not be taken from the frame arena.
+static bool RefreshFlowField(s_flow_field& field, const s_tilemap& tilemap, const zf4::s_vec_2d goal_pos, s_frame_arena& arena) {
+    const zf4::s_vec_2d_i goal_tile_pos = LevelToTilePos(goal_pos, tilemap);
+
+    if (field.window_size.x > 0 && field.goal_tile_pos.x == goal_tile_pos.x && field.goal_tile_pos.y == goal_tile_pos.y && field.tilemap_version == tilemap.version) {
+        return true;
+    }
+
+    field.goal_tile_pos = goal_tile_pos;
+    field.tilemap_version = tilemap.version;
+
+    // Centre the window on the goal, shifting it back inside the tilemap where it would cross an edge.
+    field.window_size = {zf4::Min(i_flow_field_size.x, tilemap.size.x), zf4::Min(i_flow_field_size.y, tilemap.size.y)};
+    field.window_pos = {
+        zf4::Clamp(goal_tile_pos.x - (field.window_size.x / 2), 0, tilemap.size.x - field.window_size.x),
+        zf4::Clamp(goal_tile_pos.y - (field.window_size.y / 2), 0, tilemap.size.y - field.window_size.y)
+    };
+
+    for (int i = 0; i < i_flow_field_tile_cnt; ++i) {
+        field.dists[i] = i_flow_field_dist_unreached;
+        field.dirs[i] = i_flow_field_dir_none;
+    }
+
+    // NOTE: Rows keep the stride of the full window, so only the row count shrinks with the tilemap.
+    const int scratch_len = field.window_size.y * i_flow_field_size.x;
+    bool* const tile_activity = PushArrayToFrameArena<bool>(arena, scratch_len); // Copied out of the tilemap a row word at a time, so that the search does not look up a chunk per tile.
+    int* const search_queue = PushArrayToFrameArena<int>(arena, scratch_len);
+
+    if (!tile_activity || !search_queue) {
+        field.window_size = {}; // Leave the field to be rebuilt next tick.
+        return false;
+    }
+
+    for (int y = 0; y < field.window_size.y; ++y) {
+        const int ty = field.window_pos.y + y;
+
+        for (int x = 0; x < field.window_size.x; ) {
+            const int tx = field.window_pos.x + x;
+            const a_tile_row_word row = TileChunkRows(tilemap, TileChunkIndex(tx / i_tile_chunk_size, ty / i_tile_chunk_size, tilemap))[ty % i_tile_chunk_size];
+            const int chunk_x_end = zf4::Min(x + (i_tile_chunk_size - (tx % i_tile_chunk_size)), field.window_size.x);
+
+            for (; x < chunk_x_end; ++x) {
+                tile_activity[FlowFieldIndex(x, y)] = row & TileRowWordBit(field.window_pos.x + x);
+            }
+        }
+    }
+
+    // Search breadth-first out from the goal over open tiles.
+    int queue_begin = 0;
+    int queue_end = 0;
+
+    const int goal_index = FlowFieldIndex(goal_tile_pos.x - field.window_pos.x, goal_tile_pos.y - field.window_pos.y);
+    field.dists[goal_index] = 0;
+    search_queue[queue_end++] = goal_index;
+
+    while (queue_begin < queue_end) {
+        const int index = search_queue[queue_begin++];
+        const int x = index % i_flow_field_size.x;
+        const int y = index / i_flow_field_size.x;
+
+        for (int d = 0; d < 4; ++d) {
+            const int nx = x + i_flow_field_dir_offsets[d].x;
+            const int ny = y + i_flow_field_dir_offsets[d].y;
+
+            if (!IsFlowFieldPosWithinWindow(nx, ny, field) || tile_activity[FlowFieldIndex(nx, ny)]) {
+                continue;
+            }
+
+            const int neighbour_index = FlowFieldIndex(nx, ny);
+
+            if (field.dists[neighbour_index] != i_flow_field_dist_unreached) {
+                continue;
+            }
+
+            field.dists[neighbour_index] = field.dists[index] + 1;
+            search_queue[queue_end++] = neighbour_index;
+        }
+    }
+
+    // Point each reached tile at the neighbour nearest the goal. A diagonal step is only taken if the tiles either side of it are open too, so that enemies do not try to cut corners.
+    for (int i = 0; i < queue_end; ++i) {
+        const int index = search_queue[i];
+        const int x = index % i_flow_field_size.x;
+        const int y = index / i_flow_field_size.x;
+
+        int nearest_dist = field.dists[index];
+
+        for (int d = 0; d < i_flow_field_dir_cnt; ++d) {
+            const zf4::s_vec_2d_i offs = i_flow_field_dir_offsets[d];
+
+            if (!IsFlowFieldPosWithinWindow(x + offs.x, y + offs.y, field)) {
+                continue;
+            }
+
+            const int dist = field.dists[FlowFieldIndex(x + offs.x, y + offs.y)];
+
+            if (dist >= nearest_dist) {
+                continue;
+            }
+
+            if (d >= 4 && (field.dists[FlowFieldIndex(x + offs.x, y)] == i_flow_field_dist_unreached || field.dists[FlowFieldIndex(x, y + offs.y)] == i_flow_field_dist_unreached)) {
+                continue;
+            }
+
+            nearest_dist = dist;
+            field.dirs[index] = (zf4::a_byte)d;
+        }
+    }
+
+    return true;
+}
+
+// Gives the unit direction to move in from the given position to reach the goal, or zero if the goal cannot be reached from there.
+static zf4::s_vec_2d SampleFlowField(const s_flow_field& field, const s_tilemap& tilemap, const zf4::s_vec_2d pos, const zf4::s_vec_2d goal_pos) {
+    const zf4::s_vec_2d_i tile_pos = LevelToTilePos(pos, tilemap);
+    const int x = tile_pos.x - field.window_pos.x;
+    const int y = tile_pos.y - field.window_pos.y;
+
+    // Within the goal tile, or outside the window, head straight for the goal.
+    if ((tile_pos.x == field.goal_tile_pos.x && tile_pos.y == field.goal_tile_pos.y) || !IsFlowFieldPosWithinWindow(x, y, field)) {
+        const zf4::s_vec_2d diff = goal_pos - pos;
+        const float dist = sqrtf((diff.x * diff.x) + (diff.y * diff.y));
+        return dist > 1.0f ? diff / dist : zf4::s_vec_2d {};
+    }
+
+    const zf4::a_byte dir = field.dirs[FlowFieldIndex(x, y)];
+
+    if (dir == i_flow_field_dir_none) {
+        return {};
+    }
+
+    const zf4::s_vec_2d_i offs = i_flow_field_dir_offsets[dir];
+    const float len_inv = dir >= 4 ? 0.70710678f : 1.0f;
+    return {offs.x * len_inv, offs.y * len_inv};
+}
+
+template<e_enemy_type tp_type>
+static void MoveEnemies(s_game& game, s_enemy_archetype& archetype, const int begin, const int end) {
+    for (int i = begin; i < end; ++i) {
+        s_enemy& enemy = archetype[i];
+
+        zf4::s_vec_2d vel_lerp_targ = {};
+
+        if (game.player_active) {
+            vel_lerp_targ = SampleFlowField(game.flow_field, game.tilemap, enemy.pos, game.player.pos) * i_enemy_type_move_spds[tp_type];
+        }
+
+        enemy.vel = zf4::Lerp(enemy.vel, vel_lerp_targ, i_vel_lerp);
+        ProcTileCollisions(enemy.vel, LoadColliderFromSprite(enemy.pos, i_enemy_type_sprite_indexes[tp_type]), game.tilemap);
+        enemy.pos += enemy.vel;
+    }
+}
+
+// The range is over all enemies in type order, so it is split at the archetype boundaries it crosses.
+static void MoveEnemiesJob(const int begin, const int end, void* const data) {
+    s_game& game = *static_cast<s_game*>(data);
+
+    int type_begin = 0;
+
+    ForEachEnemyType([&game, begin, end, &type_begin](const auto type) {
+        s_enemy_archetype& archetype = game.enemies.archetypes[type];
+
+        const int archetype_begin = zf4::Max(begin - type_begin, 0);
+        const int archetype_end = zf4::Min(end - type_begin, archetype.len);
+
+        if (archetype_begin < archetype_end) {
+            MoveEnemies<type>(game, archetype, archetype_begin, archetype_end);
+        }
+
+        type_begin += archetype.len;
+    });
+}
+
+// Returns false if a projectile could not be spawned.
+template<e_enemy_type tp_type>
+static bool TickEnemyArchetype(s_game& game, s_enemy_archetype& archetype) {
+    if constexpr (tp_type == ek_enemy_type_red) {
+        const auto reds = reinterpret_cast<s_red_enemy*>(archetype.type_data_buf);
+
+        for (int i = 0; i < archetype.len; ++i) {
+            if (reds[i].shoot_cooldown > 0) {
+                --reds[i].shoot_cooldown;
+            } else {
+                if (SpawnProjectile(archetype[i].pos, 8.0f, RandFloat(game.rng, 0.0f, zf4::g_pi * 2.0f), true, game.projectiles).slot == -1) {
+                    return false;
+                }
+
+                reds[i].shoot_cooldown = 40;
+            }
+        }
+    }
+
+    return true;
+}
+
+template<int tp_rule_flags>
+static void MoveProjectilesJob(const int begin, const int end, void* const data) {
+    s_game& game = *static_cast<s_game*>(data);
+    s_projectiles& projs = game.projectiles;
+
+    for (int i = begin; i < end; ++i) {
+        projs.pos_xs[i] += projs.vel_xs[i];
+        projs.pos_ys[i] += projs.vel_ys[i];
+
+        // NOTE: The slow-down is applied after moving so that this tick still uses the old speed, as it did when the velocity was derived from the speed each tick.
+        if constexpr (tp_rule_flags & ek_rule_flags_inverted_bullets) {
+            projs.spds[i] -= 0.25f;
+            projs.vel_xs[i] = projs.dir_xs[i] * projs.spds[i];
+            projs.vel_ys[i] = projs.dir_ys[i] * projs.spds[i];
+        }
+    }
+}
+
+template<int tp_rule_flags>
+static void MovePlayer(s_game& game, const s_tick_input& input) {
+    zf4::s_vec_2d move_axis = {
+        static_cast<float>(((input.flags & ek_tick_input_flags_move_right) != 0) - ((input.flags & ek_tick_input_flags_move_left) != 0)),
+        static_cast<float>(((input.flags & ek_tick_input_flags_move_down) != 0) - ((input.flags & ek_tick_input_flags_move_up) != 0))
+    };
+
+    if constexpr (tp_rule_flags & ek_rule_flags_inverted_movement) {
+        move_axis = -move_axis;
+    }
+
+    constexpr float spd = i_player_move_spd * (tp_rule_flags & ek_rule_flags_halved_movement_spd ? 0.5f : 1.0f);
+
+    const zf4::s_vec_2d vel_lerp_targ = move_axis * spd;
+    game.player.vel = zf4::Lerp(game.player.vel, vel_lerp_targ, i_vel_lerp);
+
+    ProcTileCollisions(game.player.vel, LoadColliderFromSprite(game.player.pos, ek_sprite_index_player), game.tilemap);
+
+    game.player.pos += game.player.vel;
+}
+
+struct s_projectile_collision_query_data {
+    s_game* game;
+    zf4::s_rect player_collider;
+};
+
+static void QueryProjectileCollisionsJob(const int begin, const int end, void* const data) {
+    const auto query_data = static_cast<s_projectile_collision_query_data*>(data);
+    s_game& game = *query_data->game;
+    const s_projectiles& projs = game.projectiles;
+    s_projectile_hits& hits = game.projectile_hits;
+
+    for (int i = begin; i < end; ++i) {
+        const zf4::s_rect proj_collider = LoadColliderFromSprite({projs.pos_xs[i], projs.pos_ys[i]}, ek_sprite_index_bullet);
+
+        int flags = 0;
+
+        if (projs.enemy_flags[i]) {
+            hits.enemy_indexes[i] = -1;
+
+            if (zf4::DoRectsIntersect(proj_collider, query_data->player_collider)) {
+                flags |= ek_projectile_hit_flags_player;
+            }
+        } else {
+            hits.enemy_indexes[i] = FindEnemyCollision(proj_collider, game.enemy_grid);
+        }
+
+        if (TileCollisionCheck(proj_collider, game.tilemap)) {
+            flags |= ek_projectile_hit_flags_tile;
+        }
+
+        hits.flags[i] = (zf4::a_byte)flags;
+    }
+}
+
+// Returns false if the tick could not complete, which only happens if memory for scratch data could not be allocated or an entity pool could not grow.
+bool TickGame(s_game& game, const s_tick_input& input, s_job_system* const job_system) {
+    s_profile_scope tick_scope(ek_profile_zone_tick);
+    s_profile_scope phase_scope(ek_profile_zone_rule_updating);
+
+    // Everything taken from the arena last tick is done with.
+    ResetFrameArena(game.frame_arena);
+
+    //
+    // Rule Updating
+    //
+    if (game.rule_change_time > 0) {
+        --game.rule_change_time;
+    } else {
+        game.rule_type = (e_rule_type)((game.rule_type + 1) % eks_rule_type_cnt);
+        game.rule_change_time = i_rule_change_interval;
+    }
+
+    // NOTE: Phases affected by the rules are compiled for every combination of rule flags, and the one for the active rules is picked here, so that their loops never test a rule.
+    const int rule_flags = i_rule_type_flags[game.rule_type];
+
+    //
+    // Player Movement and Invincibility
+    //
+    SwitchProfileScope(phase_scope, ek_profile_zone_player_movement);
+
+    if (game.player_active) {
+        WithRuleFlags(rule_flags, [&game, &input](const auto flags) {
+            MovePlayer<flags>(game, input);
+        });
+
+        const zf4::s_vec_2d mouse_cam_pos = ScreenToCameraPos(input.mouse_pos, game.cam_pos, input.window_size);
+        game.player.rot = zf4::Dir(game.player.pos, mouse_cam_pos);
+
+        if (game.player.inv_cooldown > 0) {
+            --game.player.inv_cooldown; // NOTE: A cooldown timer of 1 actually corresponds to 0 frames of invincibility - fix?
+        }
+    }
+
+    //
+    // Enemy Pathfinding
+    //
+    SwitchProfileScope(phase_scope, ek_profile_zone_enemy_pathfinding);
+
+    if (game.player_active) {
+        if (!RefreshFlowField(game.flow_field, game.tilemap, game.player.pos, game.frame_arena)) {
+            return false;
+        }
+    }
+
+    //
+    // Enemy Movement
+    //
+    SwitchProfileScope(phase_scope, ek_profile_zone_enemy_movement);
+
+    ParallelFor(job_system, CountEnemies(game.enemies), i_enemy_job_range_len, MoveEnemiesJob, &game);
+
+    //
+    // Projectile Movement
+    //
+    SwitchProfileScope(phase_scope, ek_profile_zone_projectile_movement);
+
+    WithRuleFlags(rule_flags, [job_system, &game](const auto flags) {
+        ParallelFor(job_system, game.projectiles.len, i_projectile_movement_job_range_len, MoveProjectilesJob<flags>, &game);
+    });
+
+    //
+    // Player Shooting
+    //
+    SwitchProfileScope(phase_scope, ek_profile_zone_player_shooting);
+
+    if (game.player_active) {
+        if (game.player.shoot_cooldown > 0) {
+            --game.player.shoot_cooldown;
+        } else {
+            if (input.flags & ek_tick_input_flags_shoot) {
+                if (SpawnProjectile(game.player.pos, 12.0f, game.player.rot, false, game.projectiles).slot == -1) {
+                    return false;
+                }
+
+                game.player.shoot_cooldown = i_player_shoot_interval;
+            }
+        }
+    }
+
+    //
+    // Enemy Spawning
+    //
+    SwitchProfileScope(phase_scope, ek_profile_zone_enemy_spawning);
+
+    if (game.enemy_spawn_time < i_enemy_spawn_interval) {
+        ++game.enemy_spawn_time;
+    } else {
+        if (CountEnemies(game.enemies) < i_enemy_spawn_limit) {
+            const e_enemy_type type = RandPerc(game.rng) < 0.7f ? ek_enemy_type_red : ek_enemy_type_purple;
+
+            const zf4::s_vec_2d_i level_size = LevelSize(game.tilemap);
+
+            const float x_min = zf4::Max(game.player.pos.x - i_enemy_spawn_range, 0.0f);
+            const float y_min = zf4::Max(game.player.pos.y - i_enemy_spawn_range, 0.0f);
+            const float x_max = zf4::Min(game.player.pos.x + i_enemy_spawn_range, (float)level_size.x);
+            const float y_max = zf4::Min(game.player.pos.y + i_enemy_spawn_range, (float)level_size.y);
+
+            // Try random positions until one is clear of tiles. If none is found, the spawn is skipped until the next interval.
+            for (int i = 0; i < i_enemy_spawn_attempt_limit; ++i) {
+                const zf4::s_vec_2d pos = {
+                    RandFloat(game.rng, x_min, x_max),
+                    RandFloat(game.rng, y_min, y_max)
+                };
+
+                if (!TileCollisionCheck(GenEnemyCollider(pos, type), game.tilemap)) {
+                    if (SpawnEnemy(pos, type, game.enemies).slot == -1) {
+                        return false;
+                    }
+
+                    break;
+                }
+            }
+        }
+
+        game.enemy_spawn_time = 0;
+    }
+
+    //
+    // Enemy Type Ticks
+    //
+    SwitchProfileScope(phase_scope, ek_profile_zone_enemy_type_ticks);
+
+    {
+        bool enemy_types_ticked = true;
+
+        ForEachEnemyType([&game, &enemy_types_ticked](const auto type) {
+            enemy_types_ticked = enemy_types_ticked && TickEnemyArchetype<type>(game, game.enemies.archetypes[type]);
+        });
+
+        if (!enemy_types_ticked) {
+            return false;
+        }
+    }
+
+    //
+    // Collision Processing
+    //
+    SwitchProfileScope(phase_scope, ek_profile_zone_collision_processing);
+
+    {
+        const zf4::s_rect player_collider = LoadColliderFromSprite(game.player.pos, ek_sprite_index_player);
+
+        // The player is tested against the enemies along with every projectile.
+        if (!BuildEnemyGrid(game.enemy_grid, game.enemies, game.projectiles.len + 1, game.frame_arena)) {
+            return false;
+        }
+
+        // Handle the player colliding with enemies.
+        if (game.player.inv_cooldown == 0) {
+            int enemy_index = FindEnemyCollision(player_collider, game.enemy_grid);
+
+            if (enemy_index != -1) {
+                const e_enemy_type enemy_type = LoadEnemyGridIndexType(game.enemy_grid, enemy_index);
+                const zf4::s_vec_2d kb = CalcKnockback(game.player.pos, game.enemies.archetypes[enemy_type][enemy_index].pos, 8.0f);
+                HurtPlayer(game.player, 1, kb);
+            }
+        }
+
+        // Handle projectiles colliding with the player or enemies. The queries are run first, possibly in parallel, and then applied in projectile order so that damage, knockback and removals come out the same regardless of how the queries were split.
+        {
+            s_projectile_hits& hits = game.projectile_hits;
+            hits.enemy_indexes = PushArrayToFrameArena<int>(game.frame_arena, game.projectiles.len);
+            hits.flags = PushArrayToFrameArena<zf4::a_byte>(game.frame_arena, game.projectiles.len);
+
+            if (!hits.enemy_indexes || !hits.flags) {
+                return false;
+            }
+
+            s_projectile_collision_query_data query_data = {
+                .game = &game,
+                .player_collider = player_collider
+            };
+
+            ParallelFor(job_system, game.projectiles.len, i_projectile_collision_job_range_len, QueryProjectileCollisionsJob, &query_data);
+
+            int proj_index = 0;
+
+            while (proj_index < game.projectiles.len) {
+                const s_projectiles& projs = game.projectiles;
+                const zf4::s_vec_2d proj_knockback = zf4::s_vec_2d {projs.vel_xs[proj_index], projs.vel_ys[proj_index]} * 0.6f;
+
+                bool destroy = false;
+
+                if (projs.enemy_flags[proj_index]) {
+                    if (game.player.inv_cooldown == 0 && (hits.flags[proj_index] & ek_projectile_hit_flags_player)) {
+                        HurtPlayer(game.player, 1, proj_knockback);
+                        destroy = true;
+                    }
+                } else {
+                    int enemy_index = hits.enemy_indexes[proj_index];
+
+                    if (enemy_index != -1) {
+                        const e_enemy_type enemy_type = LoadEnemyGridIndexType(game.enemy_grid, enemy_index);
+                        s_enemy& enemy = game.enemies.archetypes[enemy_type][enemy_index];
+                        enemy.vel += proj_knockback;
+                        --enemy.hp;
+
+                        destroy = true;
+                    }
+                }
+
+                if (hits.flags[proj_index] & ek_projectile_hit_flags_tile) {
+                    destroy = true;
+                }
+
+                if (destroy) {
+                    // The results move along with the projectile that gets swapped in.
+                    const int end_index = game.projectiles.len - 1;
+                    hits.enemy_indexes[proj_index] = hits.enemy_indexes[end_index];
+                    hits.flags[proj_index] = hits.flags[end_index];
+
+                    RemoveProjectile(proj_index, game.projectiles);
+                } else {
+                    ++proj_index;
+                }
+            }
+        }
+    }
+
+    //
+    // Process Player Death
+    //
+    SwitchProfileScope(phase_scope, ek_profile_zone_player_death);
+
+    if (game.player.hp <= 0) {
+        game.player_active = false;
+    }
+
+    //
+    // Processing Enemy Deaths
+    //
+    SwitchProfileScope(phase_scope, ek_profile_zone_enemy_deaths);
+
+    for (int i = 0; i < eks_enemy_type_cnt; ++i) {
+        s_enemy_archetype& archetype = game.enemies.archetypes[i];
+
+        int enemy_index = 0;
+
+        while (enemy_index < archetype.len) {
+            if (archetype[enemy_index].hp <= 0) {
+                RemoveEnemy(enemy_index, archetype, (e_enemy_type)i);
+            } else {
+                ++enemy_index;
+            }
+        }
+    }
+
+    //
+    // Camera
+    //
+    SwitchProfileScope(phase_scope, ek_profile_zone_camera);
+
+    {
+        const zf4::s_vec_2d dest = game.player.pos; // We do this even if the player is inactive.
+        game.cam_pos = Lerp(game.cam_pos, dest, i_camera_pos_lerp);
+    }
+
+    //
+    // Tile Streaming
+    //
+    SwitchProfileScope(phase_scope, ek_profile_zone_tile_streaming);
+
+    // Keep the chunks around the view and every entity that can touch tiles paged in, and let the rest go. Enemies are gathered individually rather than as one bounding box, since they can be spread across the level.
+    // NOTE: The enemy colliders are reused from collision processing. Enemies have not moved since, and those removed for dying only keep a few extra chunks in for a tick.
+    if (game.tilemap.stream_time > 0) {
+        --game.tilemap.stream_time;
+    } else {
+        BeginTilemapStreaming(game.tilemap);
+
+        const zf4::s_vec_2d cam_size = CameraSize(input.window_size);
+        const zf4::s_vec_2d cam_top_left = CameraTopLeft(game.cam_pos, input.window_size);
+        WantTilemapRegion(game.tilemap, {cam_top_left.x, cam_top_left.y, cam_size.x, cam_size.y});
+
+        WantTilemapRegion(game.tilemap, LoadColliderFromSprite(game.player.pos, ek_sprite_index_player));
+
+        const s_enemy_grid& grid = game.enemy_grid;
+
+        for (int i = 0; i < grid.type_enemy_begins[eks_enemy_type_cnt]; ++i) {
+            WantTilemapRegion(game.tilemap, grid.colliders[i]);
+        }
+
+        EndTilemapStreaming(game.tilemap);
+
+        game.tilemap.stream_time = i_tilemap_stream_interval;
+    }
+
+    return true;
+}
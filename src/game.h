@@ -0,0 +1,404 @@
+#pragma once
+
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <zf4.h>
+#include "arena.h"
+#include "pool.h"
+#include "tilemap.h"
+
+static constexpr float i_vel_lerp = 0.2f;
+
+static constexpr float i_player_move_spd = 3.0f;
+static constexpr int i_player_hp_limit = 10;
+static constexpr int i_player_shoot_interval = 10;
+
+// NOTE: Entity pools grow by these amounts as needed, rather than being sized for the worst case up front.
+static constexpr int i_enemy_pool_chunk_size = 64;
+static constexpr int i_projectile_pool_chunk_size = 1024;
+
+static constexpr int i_enemy_spawn_interval = 90;
+static constexpr int i_enemy_spawn_limit = 8;
+static constexpr float i_enemy_spawn_range = 640.0f; // How far from the player on either axis enemies can spawn, so that they appear near the action however large the level.
+static constexpr int i_enemy_spawn_attempt_limit = 32; // How many positions are tried before the spawn is given up, so that a spawn range with no open space cannot hang the tick.
+
+static constexpr float i_camera_scale = 2.0f;
+static constexpr float i_camera_pos_lerp = 0.25f;
+
+static constexpr int i_rule_change_interval = 480;
+
+enum e_sprite_index {
+    ek_sprite_index_pixel,
+    ek_sprite_index_player,
+    ek_sprite_index_red_enemy,
+    ek_sprite_index_purple_enemy,
+    ek_sprite_index_bullet,
+    ek_sprite_index_tile,
+    ek_sprite_index_cursor,
+
+    eks_sprite_cnt
+};
+
+static constexpr zf4::s_static_array<zf4::s_rect_i, eks_sprite_cnt> i_sprite_src_rects = {
+    .elems_raw = {
+        {0, 0, 1, 1},
+    {10, 2, 28, 28},
+    {0, 40, 24, 24},
+    {24, 40, 16, 16},
+    {42, 10, 4, 4},
+    {40, 16, 16, 16},
+    {0, 8, 8, 8}
+}
+};
+
+struct s_player {
+    zf4::s_vec_2d pos;
+    zf4::s_vec_2d vel;
+
+    float rot;
+
+    int hp;
+    int inv_cooldown;
+
+    int shoot_cooldown;
+};
+
+enum e_enemy_type {
+    ek_enemy_type_red,
+    ek_enemy_type_purple,
+
+    eks_enemy_type_cnt
+};
+
+static constexpr zf4::s_static_array<e_sprite_index, eks_enemy_type_cnt> i_enemy_type_sprite_indexes = {
+    ek_sprite_index_red_enemy,
+    ek_sprite_index_purple_enemy
+};
+
+static constexpr zf4::s_static_array<int, eks_enemy_type_cnt> i_enemy_type_hps = {
+    8,
+    5
+};
+
+static constexpr zf4::s_static_array<float, eks_enemy_type_cnt> i_enemy_type_move_spds = {
+    0.75f,
+    1.5f
+};
+
+// The fields every enemy has. Those particular to a type are kept in the type's own struct below, alongside in its archetype.
+struct s_enemy {
+    zf4::s_vec_2d pos;
+    zf4::s_vec_2d vel;
+
+    float rot;
+
+    int hp;
+};
+
+struct s_red_enemy {
+    int shoot_cooldown;
+};
+
+struct s_purple_enemy {
+};
+
+static constexpr zf4::s_static_array<int, eks_enemy_type_cnt> i_enemy_type_data_sizes = {
+    sizeof(s_red_enemy),
+    sizeof(s_purple_enemy)
+};
+
+// NOTE: Projectiles are stored as a structure of arrays so the per-tick loops over them touch only the fields they need and can be vectorised.
+struct s_projectiles {
+    float* pos_xs;
+    float* pos_ys;
+
+    // The velocity is cached so that it only needs recalculating when the speed changes.
+    float* vel_xs;
+    float* vel_ys;
+
+    // The unit vector of the direction, which the velocity is rebuilt from.
+    float* dir_xs;
+    float* dir_ys;
+
+    float* spds;
+
+    bool* enemy_flags;
+
+    int len;
+    int cap;
+
+    s_handle_table handles;
+};
+
+// The enemies of a single type. They are packed at the front of the buffers and swap-removed, so iterating them touches only live ones.
+struct s_enemy_archetype {
+    s_enemy* buf;
+    zf4::a_byte* type_data_buf; // The type's own struct for each enemy, in step with "buf".
+
+    int len;
+    int cap;
+
+    s_handle_table handles; // Handles are only unique within the archetype.
+
+    s_enemy& operator[](const int index) {
+        assert(index >= 0 && index < len);
+        return buf[index];
+    }
+
+    const s_enemy& operator[](const int index) const {
+        assert(index >= 0 && index < len);
+        return buf[index];
+    }
+};
+
+// NOTE: Enemies are split by type so that each type's update runs as its own loop, with everything about the type known at compile time and nothing to branch on per enemy. Where enemies need a single order across types, as for collisions, it is the archetypes in type order with each one's enemies in index order.
+struct s_enemies {
+    zf4::s_static_array<s_enemy_archetype, eks_enemy_type_cnt> archetypes;
+};
+
+// Calls the function once for each enemy type in order, passing the type as a compile-time constant so that whatever the function does with it is specialised to the type.
+template<typename tp_func>
+static inline void ForEachEnemyType(tp_func&& func) {
+    [&func]<int... tp_types>(std::integer_sequence<int, tp_types...>) {
+        (func(std::integral_constant<e_enemy_type, (e_enemy_type)tp_types>()), ...);
+    }(std::make_integer_sequence<int, eks_enemy_type_cnt>());
+}
+
+static inline int CountEnemies(const s_enemies& enemies) {
+    int cnt = 0;
+
+    for (int i = 0; i < eks_enemy_type_cnt; ++i) {
+        cnt += enemies.archetypes[i].len;
+    }
+
+    return cnt;
+}
+
+// NOTE: The cell size is the tile size so the grid lines up with the tilemap, and enemies always lie within a few cells. The grid wraps rather than covering the level, so its size does not depend on the level's; enemies far apart can share a cell, but every candidate is tested against its collider anyway.
+static constexpr int i_enemy_grid_cell_size = i_tile_size;
+static constexpr zf4::s_vec_2d_i i_enemy_grid_size = {64, 64};
+static_assert((i_enemy_grid_size.x & (i_enemy_grid_size.x - 1)) == 0 && (i_enemy_grid_size.y & (i_enemy_grid_size.y - 1)) == 0, "The enemy grid size must be a power of two on both axes so that cell positions can be wrapped with a mask!");
+static constexpr int i_enemy_grid_cell_cnt = i_enemy_grid_size.x * i_enemy_grid_size.y;
+
+static constexpr int CalcEnemyGridCellSpanLimit() {
+    int span = 0;
+
+    for (int i = 0; i < eks_enemy_type_cnt; ++i) {
+        const zf4::s_rect_i src_rect = i_sprite_src_rects[i_enemy_type_sprite_indexes[i]];
+        const int width_span = (src_rect.width / i_enemy_grid_cell_size) + 2;
+        const int height_span = (src_rect.height / i_enemy_grid_cell_size) + 2;
+        span = width_span * height_span > span ? width_span * height_span : span;
+    }
+
+    return span;
+}
+
+// The most cells a single enemy collider can be inserted into.
+static constexpr int i_enemy_grid_cell_span_limit = CalcEnemyGridCellSpanLimit();
+
+static constexpr int i_enemy_grid_brute_force_pair_limit = 256; // The most enemy and query pairs for which the cells are not built and every enemy is tested instead.
+
+// A uniform grid over the level bucketing enemy indexes by the cells their colliders touch. It is rebuilt every tick before collisions are processed.
+// NOTE: A cell only holds entries if its stamp matches that of the current build, so a build only has to visit the cells the enemies touch rather than clear the whole grid.
+struct s_enemy_grid {
+    zf4::s_rect* colliders; // The collider of each enemy, by enemy index.
+
+    bool brute_force; // Whether the cells were left unbuilt, as testing every enemy costs less with so few of them to test against.
+
+    uint32_t stamp; // Incremented with every build.
+    zf4::s_static_array<uint32_t, i_enemy_grid_cell_cnt> cell_stamps;
+    zf4::s_static_array<int, i_enemy_grid_cell_cnt> cell_begins; // Index into "enemy_indexes" at which each cell's entries start.
+    zf4::s_static_array<int, i_enemy_grid_cell_cnt> cell_lens;
+
+    int* enemy_indexes; // Indexes are across all archetypes, in type order.
+
+    zf4::s_static_array<int, eks_enemy_type_cnt + 1> type_enemy_begins; // The index at which each archetype's enemies start.
+};
+
+enum e_projectile_hit_flags {
+    ek_projectile_hit_flags_player = 1 << 0, // Overlapping the player, whether or not they are invincible.
+    ek_projectile_hit_flags_tile = 1 << 1
+};
+
+// Per-projectile results of the collision queries. The queries only read state, so they can run in parallel before the results are applied in order.
+struct s_projectile_hits {
+    int* enemy_indexes; // The enemy each player projectile hits, or -1.
+    zf4::a_byte* flags;
+};
+
+static constexpr int i_flow_field_dir_cnt = 8; // The four orthogonal directions come first, then the four diagonals.
+static constexpr zf4::a_byte i_flow_field_dir_none = 0xFF;
+static constexpr uint16_t i_flow_field_dist_unreached = 0xFFFF;
+
+// The size of the window of tiles around the goal that the flow field covers. Outside it, enemies head straight for the goal until they enter it.
+static constexpr zf4::s_vec_2d_i i_flow_field_size = {64, 64};
+static constexpr int i_flow_field_tile_cnt = i_flow_field_size.x * i_flow_field_size.y;
+
+// For every open tile in a window around the tile the player is in, the step to take towards that tile. All enemies share it, so pathfinding costs the same however many of them there are.
+struct s_flow_field {
+    zf4::s_static_array<uint16_t, i_flow_field_tile_cnt> dists; // Orthogonal steps to the goal tile, indexed by position within the window.
+    zf4::s_static_array<zf4::a_byte, i_flow_field_tile_cnt> dirs;
+
+    zf4::s_vec_2d_i window_pos; // In tiles.
+    zf4::s_vec_2d_i window_size; // Smaller than the full window only if the tilemap is, and zero if the field has not been built.
+
+    zf4::s_vec_2d_i goal_tile_pos;
+    int tilemap_version; // The version of the tilemap the field was built from.
+};
+
+// NOTE: These are not things the player should be able to break. These are rules which alter the game's mechanics, regardless of player choice.
+enum e_rule_type {
+    ek_rule_type_none,
+    ek_rule_type_inverted_movement,
+    ek_rule_type_inverted_bullets,
+    ek_rule_type_halved_movement_spd,
+
+    eks_rule_type_cnt
+};
+
+static constexpr zf4::s_static_array<const char*, eks_rule_type_cnt> i_rule_type_strs = {
+    "No Rule",
+    "Inverted Movement",
+    "Inverted Bullets",
+    "Halved Movement Speed"
+};
+
+static_assert(i_rule_type_strs.len == eks_rule_type_cnt);
+
+// The effects a rule can have. A rule can have any combination of them.
+enum e_rule_flags {
+    ek_rule_flags_inverted_movement = 1 << 0,
+    ek_rule_flags_inverted_bullets = 1 << 1,
+    ek_rule_flags_halved_movement_spd = 1 << 2,
+
+    eks_rule_flags_mask = (1 << 3) - 1
+};
+
+static constexpr zf4::s_static_array<int, eks_rule_type_cnt> i_rule_type_flags = {
+    0,
+    ek_rule_flags_inverted_movement,
+    ek_rule_flags_inverted_bullets,
+    ek_rule_flags_halved_movement_spd
+};
+
+// Calls the function with the given rule flags as a compile-time constant, so that whatever the function does with them is specialised to that combination. Every combination is compiled, but only one is picked per call.
+template<typename tp_func>
+static inline void WithRuleFlags(const int rule_flags, tp_func&& func) {
+    assert((rule_flags & ~eks_rule_flags_mask) == 0);
+
+    [rule_flags, &func]<int... tp_rule_flags>(std::integer_sequence<int, tp_rule_flags...>) {
+        ((rule_flags == tp_rule_flags ? (func(std::integral_constant<int, tp_rule_flags>()), true) : false) || ...);
+    }(std::make_integer_sequence<int, eks_rule_flags_mask + 1>());
+}
+
+// NOTE: The simulation draws from its own random number stream rather than the global one, so that a session can be reproduced from its seed and inputs.
+struct s_rng {
+    uint64_t state;
+};
+
+static inline uint64_t NextRandU64(s_rng& rng) {
+    // xorshift64*
+    rng.state ^= rng.state >> 12;
+    rng.state ^= rng.state << 25;
+    rng.state ^= rng.state >> 27;
+    return rng.state * 0x2545F4914F6CDD1DULL;
+}
+
+static inline float RandPerc(s_rng& rng) {
+    return (float)(NextRandU64(rng) >> 40) / (float)(1 << 24);
+}
+
+static inline float RandFloat(s_rng& rng, const float min, const float max) {
+    return min + (RandPerc(rng) * (max - min));
+}
+
+struct s_game {
+    s_player player;
+    bool player_active;
+
+    s_enemies enemies;
+    int enemy_spawn_time;
+
+    s_projectiles projectiles;
+
+    zf4::s_vec_2d cam_pos;
+
+    s_tilemap tilemap;
+
+    // NOTE: This is derived from the tilemap and the player's position, so it is kept out of snapshots and the state hash and is rebuilt whenever either could have changed.
+    s_flow_field flow_field;
+
+    // Scratch, only valid from collision processing to the end of the tick. The arrays are in the frame arena.
+    s_enemy_grid enemy_grid;
+    s_projectile_hits projectile_hits;
+
+    s_frame_arena frame_arena; // Reset at the start of each tick.
+
+    e_rule_type rule_type;
+    int rule_change_time;
+
+    s_rng rng;
+};
+
+struct s_job_system;
+
+enum e_tick_input_flags {
+    ek_tick_input_flags_move_left = 1 << 0,
+    ek_tick_input_flags_move_right = 1 << 1,
+    ek_tick_input_flags_move_up = 1 << 2,
+    ek_tick_input_flags_move_down = 1 << 3,
+    ek_tick_input_flags_shoot = 1 << 4,
+
+    eks_tick_input_flags_mask = (1 << 5) - 1
+};
+
+// NOTE: This is everything a tick reads from the outside world. The window build fills it from the GLFW input state, the headless build from a script.
+struct s_tick_input {
+    e_tick_input_flags flags;
+    zf4::s_vec_2d mouse_pos; // In screen space.
+    zf4::s_vec_2d_i window_size;
+};
+
+static inline zf4::s_vec_2d CameraSize(const zf4::s_vec_2d_i window_size) {
+    return {(float)window_size.x / i_camera_scale, (float)window_size.y / i_camera_scale};
+}
+
+static inline zf4::s_vec_2d CameraTopLeft(const zf4::s_vec_2d cam_pos, const zf4::s_vec_2d_i window_size) {
+    const zf4::s_vec_2d size = CameraSize(window_size);
+    return cam_pos - (size / 2.0f);
+}
+
+static inline zf4::s_vec_2d CameraToScreenPos(const zf4::s_vec_2d pos, const zf4::s_vec_2d cam_pos, const zf4::s_vec_2d_i window_size) {
+    const zf4::s_vec_2d top_left = CameraTopLeft(cam_pos, window_size);
+    return (pos - top_left) * i_camera_scale;
+}
+
+static inline zf4::s_vec_2d ScreenToCameraPos(const zf4::s_vec_2d pos, const zf4::s_vec_2d cam_pos, const zf4::s_vec_2d_i window_size) {
+    const zf4::s_vec_2d top_left = CameraTopLeft(cam_pos, window_size);
+    return top_left + (pos * (1.0f / i_camera_scale));
+}
+
+// NOTE: This matches the pixel-space projection used for the texture batch, with the origin at the top left.
+static inline zf4::s_matrix_4x4 LoadPixelProjMatrix4x4(const zf4::s_vec_2d_i window_size) {
+    zf4::s_matrix_4x4 mat = {};
+    mat.elems[0][0] = 2.0f / window_size.x;
+    mat.elems[1][1] = -2.0f / window_size.y;
+    mat.elems[2][2] = -1.0f;
+    mat.elems[3][0] = -1.0f;
+    mat.elems[3][1] = 1.0f;
+    mat.elems[3][3] = 1.0f;
+    return mat;
+}
+
+bool TileCollisionCheck(const zf4::s_rect collider, const s_tilemap& tilemap);
+
+bool ReserveEnemies(s_enemies& enemies, const e_enemy_type type, const int min_cap);
+[[nodiscard]] s_entity_handle SpawnEnemy(const zf4::s_vec_2d pos, const e_enemy_type type, s_enemies& enemies);
+bool ReserveProjectiles(s_projectiles& projectiles, const int min_cap);
+[[nodiscard]] s_entity_handle SpawnProjectile(const zf4::s_vec_2d pos, const float spd, const float dir, const bool enemy, s_projectiles& projectiles);
+
+bool InitGameState(s_game& game, const uint64_t seed, const char* const map_file_path = nullptr);
+void CleanGameState(s_game& game);
+bool TickGame(s_game& game, const s_tick_input& input, s_job_system* const job_system = nullptr);
+uint64_t HashGameState(const s_game& game);
@@ -1,670 +1,576 @@
 #include <cstdio>
-#include <zf4.h>
+#include <cstring>
+#include <ctime>
+#include "game.h"
+#include "draw.h"
+#include "tile_layer.h"
+#include "sprite_batch.h"
+#include "lighting.h"
+#include "text_run.h"
+#include "latency.h"
+#include "jobs.h"
+#include "replay.h"
+#include "profiler.h"
+#include "shader_cache.h"
+#include <GLFW/glfw3.h>
 
 static constexpr zf4::s_vec_4d i_bg_color = {0.63f, 0.63f, 0.49f, 1.0f};
 
-static constexpr float i_vel_lerp = 0.2f;
-
-static constexpr float i_player_move_spd = 3.0f;
-static constexpr int i_player_hp_limit = 10;
-
-static constexpr int i_enemy_limit = 256;
-static constexpr int i_enemy_spawn_interval = 90;
-static constexpr int i_enemy_spawn_limit = 8;
-static_assert(i_enemy_spawn_limit <= i_enemy_limit);
-
-static constexpr int i_projectile_limit = 1024;
-
-static constexpr float i_camera_scale = 2.0f;
-static constexpr float i_camera_pos_lerp = 0.25f;
-
-static constexpr int i_tile_size = 16;
-static constexpr zf4::s_vec_2d_i i_tilemap_size = {40, 40};
-static constexpr int i_tilemap_tile_cnt = i_tilemap_size.x * i_tilemap_size.y;
-
-static constexpr zf4::s_vec_2d_i i_level_size = i_tilemap_size * i_tile_size;
-
-static constexpr int i_rule_change_interval = 480;
+static constexpr float i_level_darkness = 0.6f;
+static constexpr float i_player_light_radius = 160.0f;
+static constexpr float i_muzzle_flash_light_radius = 48.0f;
+static constexpr int i_muzzle_flash_duration = 2; // In ticks.
+static constexpr float i_projectile_light_radius = 20.0f;
 
+// NOTE: Only one size is packed, from which the signed distance field font used for all text is built.
 enum e_font {
-    ek_font_eb_garamond_18,
-    ek_font_eb_garamond_28,
-    ek_font_eb_garamond_36,
     ek_font_eb_garamond_72
 };
 
+static constexpr float i_sdf_font_src_pt_size = 72.0f;
+
+// NOTE: These are compiled by the game rather than packed, so that their binaries can be cached between launches. They are read from beside the packed assets.
 enum e_shader_prog {
-    ek_shader_prog_blend,
-    ek_shader_prog_lighting
+    ek_shader_prog_lighting,
+    ek_shader_prog_tile_layer,
+    ek_shader_prog_text_run,
+    ek_shader_prog_sprite,
+
+    eks_shader_prog_cnt
+};
+
+static constexpr zf4::s_static_array<const char*, eks_shader_prog_cnt> i_shader_prog_names = {
+    "lighting",
+    "tile_layer",
+    "text_run",
+    "sprite"
 };
 
+static constexpr const char* i_shader_dir = "shaders";
+static constexpr const char* i_shader_cache_dir = "shader_cache";
+
+// NOTE: There is no surface for the level, which is drawn into the lighting's own reduced-resolution target instead.
 enum e_render_surface {
-    ek_render_surface_level,
     ek_render_surface_blend,
 
     eks_render_surface_cnt
 };
 
-enum e_sprite_index {
-    ek_sprite_index_pixel,
-    ek_sprite_index_player,
-    ek_sprite_index_red_enemy,
-    ek_sprite_index_purple_enemy,
-    ek_sprite_index_bullet,
-    ek_sprite_index_tile,
-    ek_sprite_index_cursor,
-
-    eks_sprite_cnt
-};
+// NOTE: The window build's custom data. Rendering state lives beside the simulation state rather than inside it, so that the headless build can use the latter alone.
+static constexpr int i_frame_time_history_len = 240;
+static constexpr float i_frame_time_budget_ms = 1000.0f / 60.0f;
 
-static constexpr zf4::s_static_array<zf4::s_rect_i, eks_sprite_cnt> i_sprite_src_rects = {
-    .elems_raw = {
-        {0, 0, 1, 1},
-    {10, 2, 28, 28},
-    {0, 40, 24, 24},
-    {24, 40, 16, 16},
-    {42, 10, 4, 4},
-    {40, 16, 16, 16},
-    {0, 8, 8, 8}
-}
+// The intervals between the last so many frames, in a ring.
+struct s_frame_times {
+    zf4::s_static_array<float, i_frame_time_history_len> ms;
+    int next_index;
+    int64_t last_draw_begin_ns;
 };
 
-struct s_player {
-    zf4::s_vec_2d pos;
-    zf4::s_vec_2d vel;
+static constexpr int64_t i_tick_interval_ns = 1000000000 / 60; // NOTE: zf4 ticks at a fixed 60 Hz.
 
-    float rot;
+static constexpr float i_level_res_scale_limit = 0.5f;
+static constexpr float i_level_res_scale_step = 0.125f;
+static constexpr float i_dynamic_res_budget_ms = i_frame_time_budget_ms * 1.1f; // Some leeway, so that frame pacing jitter alone does not lower the resolution.
+static constexpr int i_dynamic_res_sample_cnt = 8; // How many recent frames are averaged when deciding to lower the resolution, and how long to wait after changing it before doing so again.
+static constexpr int i_dynamic_res_raise_delay = 120; // How many frames in a row need to be within budget before the resolution is raised again.
 
-    int hp;
-    int inv_cooldown;
+static constexpr int64_t i_hud_info_refresh_interval_ns = 250000000; // How often the HUD readouts are refreshed. Refreshing them every frame would have their strings laid out again every frame, and would make them too jittery to read anyway.
 
-    int shoot_cooldown;
+// The resolution the level is drawn at, in texels per level unit. With dynamic resolution on, this is lowered while frames run over budget and raised again once they have stayed within it for a while.
+struct s_dynamic_res {
+    float level_res_scale;
+    int frames_since_change;
+    int frames_within_budget;
 };
 
-enum e_enemy_type {
-    ek_enemy_type_red,
-    ek_enemy_type_purple,
-
-    eks_enemy_type_cnt
+// Where the camera and player were before the last tick, and how far the frame being drawn is into the next tick, for interpolating between the two.
+struct s_tick_interp {
+    zf4::s_vec_2d prev_cam_pos;
+    zf4::s_vec_2d prev_player_pos;
+    int64_t time_accum_ns; // Mirrors the game loop's accumulation of frame time into fixed ticks.
 };
 
-static constexpr zf4::s_static_array<e_sprite_index, eks_enemy_type_cnt> i_enemy_type_sprite_indexes = {
-    ek_sprite_index_red_enemy,
-    ek_sprite_index_purple_enemy
+struct s_app {
+    s_game game;
+    s_sprite_batch sprites;
+    s_tile_layer tile_layer;
+    s_lighting lighting;
+    s_sdf_font font;
+    s_text_run_cache text_runs;
+    s_hud_strs hud_strs;
+    s_hud_info hud_info;
+    int64_t hud_info_refresh_ns; // When the HUD readouts were last refreshed.
+    s_cull_stats cull_stats;
+    s_frame_times frame_times;
+    s_tick_interp tick_interp;
+    s_latency_tracker latency;
+    s_dynamic_res dynamic_res;
+    zf4::s_static_array<GLuint, eks_shader_prog_cnt> shader_progs;
 };
 
-static constexpr zf4::s_static_array<int, eks_enemy_type_cnt> i_enemy_type_hps = {
-    8,
-    5
+// NOTE: Input recording has to outlive the game's custom data, since the recording can only be finished once the game loop has exited.
+struct s_input_recording {
+    const char* file_path; // Null if not recording.
+    uint64_t seed;
+    s_input_recorder recorder;
+    uint64_t last_state_hash;
 };
 
-struct s_red_enemy {
-    int shoot_cooldown;
-};
+static s_input_recording g_input_recording;
 
-struct s_purple_enemy {
-};
+// NOTE: The job system is owned by "main" for the same reason, so that its workers are always joined once the game loop has exited, however it exited.
+static s_job_system* g_job_system;
 
-struct s_enemy {
-    zf4::s_vec_2d pos;
-    zf4::s_vec_2d vel;
+// NOTE: zf4 makes no call on shutdown, and both the custom data and the GL context are gone once "RunGame" returns, so on a normal exit the app's memory and GL objects are reclaimed with the process and the context. The app is released explicitly only when the loop exits on a failure, while the context is still current.
 
-    float rot;
+static const char* g_trace_file_path; // Null if no trace is to be written on exit.
 
-    int hp;
+static bool g_late_latch;
 
-    e_enemy_type type;
+static const char* g_map_file_path; // Null to play the default arena.
 
-    union {
-        s_red_enemy red;
-        s_purple_enemy purple;
-    };
-};
+static bool g_dynamic_res;
 
-struct s_projectile {
-    zf4::s_vec_2d pos;
-    float spd;
-    float dir;
-    bool enemy;
-};
+static inline GLuint TextureGLID(const int tex_index, const zf4::s_renderer& renderer) {
+    return renderer.pers_render_data.textures.gl_ids[tex_index];
+}
 
-struct s_tilemap {
-    zf4::s_static_array<zf4::a_byte, zf4::BitsToBytes(i_tilemap_tile_cnt)> activity;
-};
+static inline zf4::s_vec_2d_i TextureSize(const int tex_index, const zf4::s_renderer& renderer) {
+    return renderer.pers_render_data.textures.sizes[tex_index];
+}
 
-// NOTE: These are not things the player should be able to break. These are rules which alter the game's mechanics, regardless of player choice.
-enum e_rule_type {
-    ek_rule_type_none,
-    ek_rule_type_inverted_movement,
-    ek_rule_type_inverted_bullets,
-    ek_rule_type_halved_movement_spd,
+// Finds the phase that took longest in the most recent tick, returning false if no tick is in the profiler's buffer.
+static bool FindSlowestTickPhase(e_profile_zone& zone, float& ms) {
+    static constexpr int i_event_cap = eks_profile_zone_cnt * 8;
 
-    eks_rule_type_cnt
-};
+    s_profile_event events[i_event_cap];
+    const int event_cnt = LoadRecentProfileEvents(events, i_event_cap);
 
-static constexpr zf4::s_static_array<const char*, eks_rule_type_cnt> i_rule_type_strs = {
-    "No Rule",
-    "Inverted Movement",
-    "Inverted Bullets",
-    "Halved Movement Speed"
-};
+    // The tick zone ends after all of its phases, so the phases of the last tick are those before the last tick event.
+    int tick_event_index = -1;
 
-static_assert(i_rule_type_strs.len == eks_rule_type_cnt);
+    for (int i = event_cnt - 1; i >= 0; --i) {
+        if (events[i].zone == ek_profile_zone_tick && events[i].thread_index == 0) {
+            tick_event_index = i;
+            break;
+        }
+    }
 
-struct s_game {
-    s_player player;
-    bool player_active;
+    if (tick_event_index == -1) {
+        return false;
+    }
 
-    zf4::s_static_list<s_enemy, i_enemy_limit> enemies;
-    int enemy_spawn_time;
+    const s_profile_event& tick_event = events[tick_event_index];
+    int64_t slowest_ns = -1;
 
-    zf4::s_static_list<s_projectile, i_projectile_limit> projectiles;
+    for (int i = 0; i < tick_event_index; ++i) {
+        const s_profile_event& event = events[i];
 
-    zf4::s_vec_2d cam_pos;
+        if (event.thread_index != 0 || event.zone <= ek_profile_zone_tick || event.zone > ek_profile_zone_tile_streaming || event.begin_ns < tick_event.begin_ns) {
+            continue;
+        }
 
-    s_tilemap tilemap;
+        if (event.end_ns - event.begin_ns > slowest_ns) {
+            slowest_ns = event.end_ns - event.begin_ns;
+            zone = event.zone;
+        }
+    }
 
-    e_rule_type rule_type;
-    int rule_change_time;
-};
+    if (slowest_ns == -1) {
+        return false;
+    }
 
-static zf4::s_rect LoadColliderFromSprite(const zf4::s_vec_2d pos, const e_sprite_index sprite_index) {
-    assert(sprite_index >= 0 && sprite_index < eks_sprite_cnt);
+    ms = slowest_ns / 1000000.0f;
 
-    zf4::s_rect collider = {
-        .width = (float)i_sprite_src_rects[sprite_index].width,
-        .height = (float)i_sprite_src_rects[sprite_index].height
-    };
+    return true;
+}
 
-    // NOTE: At the moment we assume a centered origin.
-    collider.x = pos.x - (collider.width / 2.0f);
-    collider.y = pos.y - (collider.height / 2.0f);
+// Draws the recent frame times as bars, oldest on the left, with a line marking the 60 FPS budget. Bars over budget are drawn red.
+static void DrawFrameTimeHistogram(const s_frame_times& frame_times, const zf4::s_vec_2d bottom_left, s_sprite_batch& sprites) {
+    static constexpr float i_bar_width = 2.0f;
+    static constexpr float i_height_per_ms = 3.0f;
+    static constexpr float i_height_limit = i_height_per_ms * 50.0f;
 
-    return collider;
-}
+    const zf4::s_rect_i pixel_src_rect = i_sprite_src_rects[ek_sprite_index_pixel];
 
-static zf4::s_vec_2d CalcKnockback(const zf4::s_vec_2d pos, const zf4::s_vec_2d inflictor_pos, const float strength) {
-    // TODO: Handle different knockback types.
+    for (int i = 0; i < i_frame_time_history_len; ++i) {
+        const float ms = frame_times.ms[(frame_times.next_index + i) % i_frame_time_history_len];
 
-    if (pos == inflictor_pos) {
-        return {};
-    }
+        if (ms <= 0.0f) {
+            continue;
+        }
 
-    const zf4::s_vec_2d kb_dir = Normal(pos - inflictor_pos);
-    return kb_dir * strength;
-}
+        const zf4::s_vec_2d pos = {bottom_left.x + (i * i_bar_width), bottom_left.y};
+        const float height = zf4::Min(ms * i_height_per_ms, i_height_limit);
+        const zf4::s_vec_4d color = ms > i_frame_time_budget_ms ? zf4::s_vec_4d {1.0f, 0.3f, 0.3f, 1.0f} : zf4::s_vec_4d {1.0f, 1.0f, 1.0f, 0.75f};
 
-static void HurtPlayer(s_player& player, const int dmg, const zf4::s_vec_2d knockback) {
-    assert(player.inv_cooldown == 0);
-    assert(dmg > 0);
+        SubmitSprite(sprites, pixel_src_rect, pos, {0.0f, 1.0f}, {i_bar_width, height}, 0.0f, color);
+    }
 
-    player.vel += knockback;
-    player.hp -= dmg;
-    player.inv_cooldown = 20;
+    const zf4::s_vec_2d budget_line_pos = {bottom_left.x, bottom_left.y - (i_frame_time_budget_ms * i_height_per_ms)};
+    SubmitSprite(sprites, pixel_src_rect, budget_line_pos, {0.0f, 0.5f}, {i_bar_width * i_frame_time_history_len, 1.0f}, 0.0f, {0.3f, 1.0f, 0.3f, 1.0f});
 }
 
-static zf4::s_rect GenEnemyCollider(const zf4::s_vec_2d pos, const e_enemy_type type) {
-    assert(type >= 0 && type < eks_enemy_type_cnt);
-    return LoadColliderFromSprite(pos, i_enemy_type_sprite_indexes[type]);
-}
+// Steps the level resolution down if the last few frames ran over budget on average, or up if frames have been within budget for long enough.
+static void UpdateDynamicRes(s_dynamic_res& dynamic_res, const s_frame_times& frame_times) {
+    ++dynamic_res.frames_since_change;
 
-static zf4::s_static_list<zf4::s_rect, i_enemy_limit> LoadEnemyColliders(const zf4::s_static_list<s_enemy, i_enemy_limit>& enemies) {
-    zf4::s_static_list<zf4::s_rect, i_enemy_limit> colliders = {
-        .len = enemies.len
-    };
+    const float last_ms = frame_times.ms[(frame_times.next_index + i_frame_time_history_len - 1) % i_frame_time_history_len];
+    dynamic_res.frames_within_budget = last_ms <= i_dynamic_res_budget_ms ? dynamic_res.frames_within_budget + 1 : 0;
 
-    for (int i = 0; i < enemies.len; ++i) {
-        colliders[i] = LoadColliderFromSprite(enemies[i].pos, i_enemy_type_sprite_indexes[enemies[i].type]);
+    if (dynamic_res.frames_since_change < i_dynamic_res_sample_cnt) {
+        return;
     }
 
-    return colliders;
-}
+    float mean_ms = 0.0f;
 
-static s_projectile* SpawnProjectile(const zf4::s_vec_2d pos, const float spd, const float dir, const bool enemy, zf4::s_static_list<s_projectile, i_projectile_limit>& projectiles) {
-    if (projectiles.len == i_projectile_limit) {
-        return nullptr;
+    for (int i = 1; i <= i_dynamic_res_sample_cnt; ++i) {
+        mean_ms += frame_times.ms[(frame_times.next_index + i_frame_time_history_len - i) % i_frame_time_history_len];
     }
 
-    const int index = projectiles.len;
-    ++projectiles.len;
-
-    s_projectile& proj = projectiles[index];
-    assert(zf4::IsStructZero(proj));
-    proj.pos = pos;
-    proj.spd = spd;
-    proj.dir = dir;
-    proj.enemy = enemy;
+    mean_ms /= i_dynamic_res_sample_cnt;
 
-    return &proj;
+    if (mean_ms > i_dynamic_res_budget_ms && dynamic_res.level_res_scale > i_level_res_scale_limit) {
+        dynamic_res.level_res_scale = zf4::Max(dynamic_res.level_res_scale - i_level_res_scale_step, i_level_res_scale_limit);
+        dynamic_res.frames_since_change = 0;
+        dynamic_res.frames_within_budget = 0;
+    } else if (dynamic_res.frames_within_budget >= i_dynamic_res_raise_delay && dynamic_res.level_res_scale < 1.0f) {
+        dynamic_res.level_res_scale = zf4::Min(dynamic_res.level_res_scale + i_level_res_scale_step, 1.0f);
+        dynamic_res.frames_since_change = 0;
+        dynamic_res.frames_within_budget = 0;
+    }
 }
 
-static inline zf4::s_vec_2d CameraSize(const zf4::s_vec_2d_i window_size) {
-    return {(float)window_size.x / i_camera_scale, (float)window_size.y / i_camera_scale};
-}
+static s_draw_view LoadDrawView(s_app& app, const zf4::s_game_ptrs& game_ptrs) {
+    const s_game& game = app.game;
 
-static inline zf4::s_vec_2d CameraTopLeft(const zf4::s_vec_2d cam_pos, const zf4::s_vec_2d_i window_size) {
-    const zf4::s_vec_2d size = CameraSize(window_size);
-    return cam_pos - (size / 2.0f);
-}
+    if (!g_late_latch) {
+        return {
+            .cam_pos = game.cam_pos,
+            .player_pos = game.player.pos,
+            .player_rot = game.player.rot,
+            .mouse_pos = game_ptrs.window.input_state.mouse_pos
+        };
+    }
 
-static inline zf4::s_vec_2d CameraToScreenPos(const zf4::s_vec_2d pos, const zf4::s_vec_2d cam_pos, const zf4::s_vec_2d_i window_size) {
-    const zf4::s_vec_2d top_left = CameraTopLeft(cam_pos, window_size);
-    return (pos - top_left) * i_camera_scale;
-}
+    // NOTE: The cursor position is queried from the window system here rather than taken from the input state, which is only as new as the last event poll.
+    double mouse_x, mouse_y;
+    glfwGetCursorPos(glfwGetCurrentContext(), &mouse_x, &mouse_y);
+    MarkInputSampled(app.latency);
 
-static inline zf4::s_vec_2d ScreenToCameraPos(const zf4::s_vec_2d pos, const zf4::s_vec_2d cam_pos, const zf4::s_vec_2d_i window_size) {
-    const zf4::s_vec_2d top_left = CameraTopLeft(cam_pos, window_size);
-    return top_left + (pos * (1.0f / i_camera_scale));
-}
+    const float tick_progress = zf4::Clamp(app.tick_interp.time_accum_ns / (float)i_tick_interval_ns, 0.0f, 1.0f);
 
-static zf4::s_matrix_4x4 LoadCameraViewMatrix4x4(const zf4::s_vec_2d cam_pos, const zf4::s_vec_2d_i window_size) {
-    zf4::s_matrix_4x4 mat = {};
+    s_draw_view view = {
+        .cam_pos = zf4::Lerp(app.tick_interp.prev_cam_pos, game.cam_pos, tick_progress),
+        .player_pos = zf4::Lerp(app.tick_interp.prev_player_pos, game.player.pos, tick_progress),
+        .mouse_pos = {(float)mouse_x, (float)mouse_y},
+        .tick_lag = 1.0f - tick_progress
+    };
 
-    mat.elems[0][0] = i_camera_scale;
-    mat.elems[1][1] = i_camera_scale;
-    mat.elems[3][3] = 1.0f;
-    mat.elems[3][0] = (-cam_pos.x * i_camera_scale) + (window_size.x / 2.0f);
-    mat.elems[3][1] = (-cam_pos.y * i_camera_scale) + (window_size.y / 2.0f);
+    // The aim drawn is only a preview; shots still go the way the player was aiming as of the tick.
+    view.player_rot = zf4::Dir(view.player_pos, ScreenToCameraPos(view.mouse_pos, view.cam_pos, game_ptrs.window.size_cache));
 
-    return mat;
+    return view;
 }
 
-static inline bool IsTilePosWithinBounds(const int x, const int y) {
-    return x >= 0 && y >= 0 && x < i_tilemap_size.x && y < i_tilemap_size.y;
-}
+static s_tick_input LoadTickInput(const zf4::s_game_ptrs& game_ptrs) {
+    int flags = 0;
 
-static inline zf4::s_vec_2d TileToLevelPos(const int tx, const int ty) {
-    assert(IsTilePosWithinBounds(tx, ty));
-    return {(float)(tx * i_tile_size), (float)(ty * i_tile_size)};
-}
+    if (zf4::KeyDown(zf4::ek_key_code_a, game_ptrs.window.input_state)) {
+        flags |= ek_tick_input_flags_move_left;
+    }
 
-static inline int TileIndex(const int x, const int y) {
-    return (y * i_tilemap_size.x) + x;
-}
+    if (zf4::KeyDown(zf4::ek_key_code_d, game_ptrs.window.input_state)) {
+        flags |= ek_tick_input_flags_move_right;
+    }
 
-static inline void ActivateTile(const int x, const int y, s_tilemap& tilemap) {
-    assert(IsTilePosWithinBounds(x, y));
-    zf4::ActivateBit(TileIndex(x, y), zf4::StaticArrayToArray(tilemap.activity), i_tilemap_tile_cnt);
-}
+    if (zf4::KeyDown(zf4::ek_key_code_w, game_ptrs.window.input_state)) {
+        flags |= ek_tick_input_flags_move_up;
+    }
 
-static inline bool IsTileActive(const int x, const int y, const s_tilemap& tilemap) {
-    assert(IsTilePosWithinBounds(x, y));
-    return zf4::IsBitActive(TileIndex(x, y), zf4::StaticArrayToArray(tilemap.activity), i_tilemap_tile_cnt);
-}
+    if (zf4::KeyDown(zf4::ek_key_code_s, game_ptrs.window.input_state)) {
+        flags |= ek_tick_input_flags_move_down;
+    }
+
+    if (zf4::MouseButtonDown(zf4::ek_mouse_button_code_left, game_ptrs.window.input_state)) {
+        flags |= ek_tick_input_flags_shoot;
+    }
 
-static zf4::s_rect LoadTileCollider(const int tx, const int ty) {
-    const zf4::s_vec_2d level_pos = TileToLevelPos(tx, ty);
-    return {level_pos.x, level_pos.y, level_pos.x + i_tile_size, level_pos.y + i_tile_size};
+    return {
+        .flags = (e_tick_input_flags)flags,
+        .mouse_pos = game_ptrs.window.input_state.mouse_pos,
+        .window_size = game_ptrs.window.size_cache
+    };
 }
 
-static bool TileCollisionCheck(const zf4::s_rect collider, const s_tilemap& tilemap) {
-    const int tx_begin = zf4::Clamp((int)floorf(collider.x / i_tile_size), 0, i_tilemap_size.x - 1);
-    const int ty_begin = zf4::Clamp((int)floorf(collider.y / i_tile_size), 0, i_tilemap_size.y - 1);
+// Sets up everything but the shader programs. Anything set up before a failure is left for "CleanApp" to release.
+static bool InitAppState(s_app& app, const zf4::s_game_ptrs& game_ptrs) {
+    if (!InitGameState(app.game, g_input_recording.seed, g_map_file_path)) {
+        return false;
+    }
 
-    const int tx_end = zf4::Clamp((int)ceilf(RectRight(collider) / i_tile_size), 0, i_tilemap_size.x);
-    const int ty_end = zf4::Clamp((int)ceilf(RectBottom(collider) / i_tile_size), 0, i_tilemap_size.y);
+    app.tick_interp.prev_cam_pos = app.game.cam_pos;
+    app.tick_interp.prev_player_pos = app.game.player.pos;
 
-    for (int ty = ty_begin; ty < ty_end; ++ty) {
-        for (int tx = tx_begin; tx < tx_end; ++tx) {
-            if (IsTileActive(tx, ty, tilemap)) {
-                return true;
-            }
+    if (g_input_recording.file_path) {
+        if (!BeginInputRecording(g_input_recording.recorder, g_input_recording.file_path, g_input_recording.seed, game_ptrs.window.size_cache)) {
+            return false;
         }
     }
 
-    return false;
-}
-
-static bool ProcTileCollisions(zf4::s_vec_2d& vel, const zf4::s_rect collider, const s_tilemap& tilemap) {
-    const zf4::s_rect hor_collider = RectTranslated(collider, {vel.x, 0.0f});
-
-    if (TileCollisionCheck(hor_collider, tilemap)) {
-        vel.x = 0.0f;
+    if (!InitSpriteBatch(app.sprites)) {
+        return false;
     }
 
-    const zf4::s_rect ver_collider = RectTranslated(collider, {0.0f, vel.y});
+    InitTileLayer(app.tile_layer);
+    InitLighting(app.lighting);
 
-    if (TileCollisionCheck(ver_collider, tilemap)) {
-        vel.y = 0.0f;
+    if (!InitSDFFont(app.font, game_ptrs.renderer.pers_render_data.fonts, ek_font_eb_garamond_72, i_sdf_font_src_pt_size)) {
+        return false;
     }
 
-    // TODO: Handle diagonal collisions.
+    InitTextRunCache(app.text_runs);
+    InitLatencyTracker(app.latency);
+
+    app.dynamic_res.level_res_scale = 1.0f;
 
     return true;
 }
 
+// Releases everything the app holds. Safe on an app that was only partly set up, and on one already cleaned.
+static void CleanApp(s_app& app) {
+    for (int i = 0; i < eks_shader_prog_cnt; ++i) {
+        glDeleteProgram(app.shader_progs[i]);
+        app.shader_progs[i] = 0;
+    }
+
+    CleanLatencyTracker(app.latency);
+    CleanTextRunCache(app.text_runs);
+    CleanSDFFont(app.font);
+    CleanLighting(app.lighting);
+    CleanTileLayer(app.tile_layer);
+    CleanSpriteBatch(app.sprites);
+    CleanGameState(app.game);
+}
+
 static bool InitGame(const zf4::s_game_ptrs& game_ptrs) {
-    const auto game = static_cast<s_game*>(game_ptrs.custom_data);
+    const auto app = static_cast<s_app*>(game_ptrs.custom_data);
 
     if (!InitRenderSurfaces(eks_render_surface_cnt, game_ptrs.renderer.surfs, game_ptrs.window.size_cache)) {
         return false;
     }
 
-    game->player.pos = i_level_size / 2.0f;
-    game->player.hp = i_player_hp_limit;
-    game->player_active = true;
+    // Start loading the shader programs first, so that any which need compiling can do so while everything else is set up.
+    s_shader_prog_loader shader_prog_loader = {};
 
-    game->cam_pos = game->player.pos;
+    {
+        zf4::s_static_array<s_shader_prog_src, eks_shader_prog_cnt> shader_prog_srcs = {};
 
-    for (int x = 0; x < i_tilemap_size.x; ++x) {
-        ActivateTile(x, 0, game->tilemap);
-        ActivateTile(x, i_tilemap_size.y - 1, game->tilemap);
-    }
+        bool srcs_loaded = true;
+
+        for (int i = 0; i < eks_shader_prog_cnt && srcs_loaded; ++i) {
+            srcs_loaded = LoadShaderProgSrc(shader_prog_srcs[i], i_shader_dir, i_shader_prog_names[i]);
+        }
+
+        if (srcs_loaded) {
+            BeginLoadingShaderProgs(shader_prog_loader, shader_prog_srcs.elems_raw, eks_shader_prog_cnt, i_shader_cache_dir);
+        }
+
+        for (int i = 0; i < eks_shader_prog_cnt; ++i) {
+            CleanShaderProgSrc(shader_prog_srcs[i]);
+        }
 
-    for (int y = 0; y < i_tilemap_size.y; ++y) {
-        ActivateTile(0, y, game->tilemap);
-        ActivateTile(i_tilemap_size.x - 1, y, game->tilemap);
+        if (!srcs_loaded) {
+            return false;
+        }
     }
 
-    game->rule_change_time = i_rule_change_interval;
+    const bool state_initted = InitAppState(*app, game_ptrs);
+
+    // The programs are waited on even if something else failed, so that none is left mid-compile.
+    if (!EndLoadingShaderProgs(shader_prog_loader, app->shader_progs.elems_raw) || !state_initted) {
+        CleanApp(*app);
+        return false;
+    }
 
     return true;
 }
 
-static bool GameTick(const zf4::s_game_ptrs& game_ptrs, const double fps) {
-    const auto game = static_cast<s_game*>(game_ptrs.custom_data);
+static bool TickApp(s_app* const app, const zf4::s_game_ptrs& game_ptrs) {
+    const s_tick_input input = LoadTickInput(game_ptrs);
 
-    //
-    // Rule Updating
-    //
-    if (game->rule_change_time > 0) {
-        --game->rule_change_time;
-    } else {
-        game->rule_type = (e_rule_type)((game->rule_type + 1) % eks_rule_type_cnt);
-        game->rule_change_time = i_rule_change_interval;
+    if (!g_late_latch) {
+        MarkInputSampled(app->latency);
     }
 
-    //
-    // Player Movement and Invincibility
-    //
-    if (game->player_active) {
-        zf4::s_vec_2d move_axis = {
-            static_cast<float>(zf4::KeyDown(zf4::ek_key_code_d, game_ptrs.window.input_state) - zf4::KeyDown(zf4::ek_key_code_a, game_ptrs.window.input_state)),
-            static_cast<float>(zf4::KeyDown(zf4::ek_key_code_s, game_ptrs.window.input_state) - zf4::KeyDown(zf4::ek_key_code_w, game_ptrs.window.input_state))
-        };
-
-        if (game->rule_type == ek_rule_type_inverted_movement) {
-            move_axis = -move_axis;
+    if (g_input_recording.recorder.fs) {
+        if (!RecordTickInput(g_input_recording.recorder, input)) {
+            return false;
         }
+    }
 
-        const zf4::s_vec_2d vel_lerp_targ = move_axis * i_player_move_spd * (game->rule_type == ek_rule_type_halved_movement_spd ? 0.5f : 1.0f);
-        game->player.vel = zf4::Lerp(game->player.vel, vel_lerp_targ, i_vel_lerp);
-
-        ProcTileCollisions(game->player.vel, LoadColliderFromSprite(game->player.pos, ek_sprite_index_player), game->tilemap);
+    app->tick_interp.prev_cam_pos = app->game.cam_pos;
+    app->tick_interp.prev_player_pos = app->game.player.pos;
 
-        game->player.pos += game->player.vel;
+    if (!TickGame(app->game, input, g_job_system)) {
+        return false;
+    }
 
-        const zf4::s_vec_2d mouse_cam_pos = ScreenToCameraPos(game_ptrs.window.input_state.mouse_pos, game->cam_pos, game_ptrs.window.size_cache);
-        game->player.rot = zf4::Dir(game->player.pos, mouse_cam_pos);
+    app->tick_interp.time_accum_ns -= i_tick_interval_ns;
 
-        if (game->player.inv_cooldown > 0) {
-            --game->player.inv_cooldown; // NOTE: A cooldown timer of 1 actually corresponds to 0 frames of invincibility - fix?
-        }
+    if (g_input_recording.recorder.fs) {
+        g_input_recording.last_state_hash = HashGameState(app->game);
     }
 
-    //
-    // Enemy Movement
-    //
-    for (int i = 0; i < game->enemies.len; ++i) {
-        s_enemy& enemy = game->enemies[i];
-        enemy.vel = zf4::Lerp(enemy.vel, {}, i_vel_lerp);
-        ProcTileCollisions(enemy.vel, LoadColliderFromSprite(enemy.pos, i_enemy_type_sprite_indexes[enemy.type]), game->tilemap);
-        enemy.pos += enemy.vel;
-    }
+    return true;
+}
 
-    //
-    // Projectile Movement
-    //
-    for (int i = 0; i < game->projectiles.len; ++i) {
-        s_projectile& projectile = game->projectiles[i];
+static bool DrawApp(s_app* const app, zf4::s_draw_phase_state& draw_phase_state, const zf4::s_game_ptrs& game_ptrs, const double fps) {
+    const s_game* const game = &app->game;
+
+    s_profile_scope draw_scope(ek_profile_zone_draw);
+
+    // Record the interval since the last frame began, and add it to the time to be ticked through.
+    {
+        s_frame_times& frame_times = app->frame_times;
 
-        const zf4::s_vec_2d vel = zf4::LenDir(projectile.spd, projectile.dir); // NOTE: Obviously having to calculate this every tick is not ideal.
+        if (frame_times.last_draw_begin_ns != 0) {
+            frame_times.ms[frame_times.next_index] = (draw_scope.begin_ns - frame_times.last_draw_begin_ns) / 1000000.0f;
+            frame_times.next_index = (frame_times.next_index + 1) % i_frame_time_history_len;
 
-        if (game->rule_type == ek_rule_type_inverted_bullets) {
-            projectile.spd -= 0.25f;
+            app->tick_interp.time_accum_ns = zf4::Clamp(app->tick_interp.time_accum_ns + (draw_scope.begin_ns - frame_times.last_draw_begin_ns), (int64_t)0, i_tick_interval_ns);
         }
 
-        projectile.pos += vel;
+        frame_times.last_draw_begin_ns = draw_scope.begin_ns;
     }
 
-    //
-    // Player Shooting
-    //
-    if (game->player_active) {
-        if (game->player.shoot_cooldown > 0) {
-            --game->player.shoot_cooldown;
-        } else {
-            if (zf4::MouseButtonDown(zf4::ek_mouse_button_code_left, game_ptrs.window.input_state)) {
-                SpawnProjectile(game->player.pos, 12.0f, game->player.rot, false, game->projectiles);
-                game->player.shoot_cooldown = 10;
-            }
-        }
+    if (g_dynamic_res) {
+        UpdateDynamicRes(app->dynamic_res, app->frame_times);
     }
 
     //
-    // Enemy Spawning
+    // Level
     //
-    if (game->enemy_spawn_time < i_enemy_spawn_interval) {
-        ++game->enemy_spawn_time;
-    } else {
-        if (game->enemies.len < i_enemy_spawn_limit) {
-            const int enemy_index = game->enemies.len;
-            ++game->enemies.len;
-
-            s_enemy& enemy = game->enemies[enemy_index];
-            assert(zf4::IsStructZero(enemy));
-
-            enemy.type = zf4::RandPerc() < 0.7f ? ek_enemy_type_red : ek_enemy_type_purple;
-
-            do {
-                enemy.pos = {
-                    zf4::RandFloat(0.0f, i_level_size.x),
-                    zf4::RandFloat(0.0f, i_level_size.y)
-                };
-            } while (TileCollisionCheck(GenEnemyCollider(enemy.pos, enemy.type), game->tilemap));
-
-            enemy.hp = i_enemy_type_hps[enemy.type];
-        }
+    s_profile_scope pass_scope(ek_profile_zone_draw_level);
 
-        game->enemy_spawn_time = 0;
-    }
+    const s_draw_view view = LoadDrawView(*app, game_ptrs);
 
-    //
-    // Enemy Type Ticks
-    //
-    for (int i = 0; i < game->enemies.len; ++i) {
-        s_enemy& enemy = game->enemies[i];
-
-        switch (enemy.type) {
-            case ek_enemy_type_red:
-                if (enemy.red.shoot_cooldown > 0) {
-                    --enemy.red.shoot_cooldown;
-                } else {
-                    SpawnProjectile(enemy.pos, 8.0f, zf4::RandFloat(0.0f, zf4::g_pi * 2.0f), true, game->projectiles);
-                    enemy.red.shoot_cooldown = 40;
-                }
-
-                break;
-        }
+    const zf4::s_rect cam_rect = LoadCameraRect(view.cam_pos, game_ptrs.window.size_cache);
+
+    // The level is drawn offscreen at a reduced resolution, so that it can be lit and scaled up as a whole once done.
+    if (!BeginLitLevel(app->lighting, game_ptrs.window.size_cache, cam_rect, app->dynamic_res.level_res_scale)) {
+        return false;
     }
 
-    //
-    // Collision Processing
-    //
+    zf4::RenderClear(i_bg_color);
+
+    zf4::ZeroOutStruct(draw_phase_state.view_mat);
+    draw_phase_state.view_mat = LoadLitLevelViewMatrix4x4(app->lighting);
+
+    s_cull_stats& cull_stats = app->cull_stats;
+    zf4::ZeroOutStruct(cull_stats);
+
+    BeginSpriteBatch(app->sprites, app->shader_progs[ek_shader_prog_sprite], TextureGLID(0, game_ptrs.renderer), TextureSize(0, game_ptrs.renderer), draw_phase_state.view_mat, app->lighting.level_surface_size);
+
+    SubmitLevelSprites(app->sprites, *game, view, cam_rect, cull_stats);
+    FlushSpriteBatch(app->sprites);
+
+    // Draw tiles. These go over everything else in the level, so the batch is flushed first. Only the rows overlapping the camera are drawn.
     {
-        const zf4::s_rect player_collider = LoadColliderFromSprite(game->player.pos, ek_sprite_index_player);
-        const auto enemy_colliders = LoadEnemyColliders(game->enemies);
-
-        // Handle the player colliding with enemies.
-        if (game->player.inv_cooldown == 0) {
-            for (int i = 0; i < enemy_colliders.len; ++i) {
-                if (zf4::DoRectsIntersect(player_collider, enemy_colliders[i])) {
-                    const zf4::s_vec_2d kb = CalcKnockback(game->player.pos, game->enemies[i].pos, 8.0f);
-                    HurtPlayer(game->player, 1, kb);
-                    break;
-                }
-            }
-        }
+        RefreshTileLayer(app->tile_layer, game->tilemap, view.cam_pos, TextureSize(0, game_ptrs.renderer));
 
-        // Handle projectiles colliding with the player or enemies.
-        {
-            int proj_index = 0;
-
-            while (proj_index < game->projectiles.len) {
-                s_projectile& proj = game->projectiles[proj_index];
-                const zf4::s_rect proj_collider = LoadColliderFromSprite(proj.pos, ek_sprite_index_bullet);
-                const zf4::s_vec_2d proj_knockback = zf4::LenDir(proj.spd, proj.dir) * 0.6f;
-
-                bool destroy = false;
-
-                if (proj.enemy) {
-                    if (game->player.inv_cooldown == 0 && zf4::DoRectsIntersect(proj_collider, player_collider)) {
-                        HurtPlayer(game->player, 1, proj_knockback);
-                        destroy = true;
-                    }
-                } else {
-                    for (int i = 0; i < enemy_colliders.len; ++i) {
-                        if (zf4::DoRectsIntersect(proj_collider, enemy_colliders[i])) {
-                            s_enemy& enemy = game->enemies[i];
-                            enemy.vel += proj_knockback;
-                            --enemy.hp;
-
-                            destroy = true;
-
-                            break;
-                        }
-                    }
-                }
-
-                if (TileCollisionCheck(proj_collider, game->tilemap)) {
-                    destroy = true;
-                }
-
-                if (destroy) {
-                    s_projectile& end_proj = game->projectiles[game->projectiles.len - 1];
-                    proj = end_proj;
-                    zf4::ZeroOutStruct(end_proj);
-                    --game->projectiles.len;
-                } else {
-                    ++proj_index;
-                }
-            }
-        }
-    }
+        const int row_begin = zf4::Clamp((int)floorf(cam_rect.y / i_tile_size), 0, game->tilemap.size.y);
+        const int row_end = zf4::Clamp((int)ceilf(RectBottom(cam_rect) / i_tile_size), row_begin, game->tilemap.size.y);
 
-    //
-    // Process Player Death
-    //
-    if (game->player.hp <= 0) {
-        game->player_active = false;
+        const int drawn_tile_cnt = DrawTileLayer(app->tile_layer, row_begin, row_end, app->shader_progs[ek_shader_prog_tile_layer], TextureGLID(0, game_ptrs.renderer), draw_phase_state.view_mat, app->lighting.level_surface_size);
+
+        cull_stats.submitted_cnt += drawn_tile_cnt;
+        cull_stats.culled_cnt += app->tile_layer.tile_cnt - drawn_tile_cnt;
     }
 
-    //
-    // Processing Enemy Deaths
-    //
+    // Light the level. The player's lights are submitted first, so that they are kept over projectile glows if there are too many lights.
     {
-        int enemy_index = 0;
-
-        while (enemy_index < game->enemies.len) {
-            const s_enemy& enemy = game->enemies[enemy_index];
-
-            if (enemy.hp <= 0) {
-                s_enemy& end_enemy = game->enemies[game->enemies.len - 1];
-                game->enemies[enemy_index] = end_enemy;
-                zf4::ZeroOutStruct(end_enemy);
-                --game->enemies.len;
-            } else {
-                ++enemy_index;
+        if (game->player_active) {
+            SubmitLight(app->lighting, view.player_pos, i_player_light_radius, 1.0f);
+
+            if (game->player.shoot_cooldown > i_player_shoot_interval - i_muzzle_flash_duration) {
+                SubmitLight(app->lighting, view.player_pos + zf4::LenDir(8.0f, view.player_rot), i_muzzle_flash_light_radius, 0.8f);
             }
         }
+
+        for (int i = 0; i < game->projectiles.len; ++i) {
+            const zf4::s_vec_2d pos = {game->projectiles.pos_xs[i] - (game->projectiles.vel_xs[i] * view.tick_lag), game->projectiles.pos_ys[i] - (game->projectiles.vel_ys[i] * view.tick_lag)};
+            SubmitLight(app->lighting, pos, i_projectile_light_radius, game->projectiles.enemy_flags[i] ? 0.3f : 0.5f);
+        }
+
+        cull_stats.light_cnt = EndLitLevel(app->lighting, app->shader_progs[ek_shader_prog_lighting], i_level_darkness);
     }
 
     //
-    // Camera
+    // UI
     //
-    {
-        const zf4::s_vec_2d dest = game->player.pos; // We do this even if the player is inactive.
-        game->cam_pos = Lerp(game->cam_pos, dest, i_camera_pos_lerp);
-    }
+    SwitchProfileScope(pass_scope, ek_profile_zone_draw_ui);
 
-    return true;
-}
+    zf4::ZeroOutStruct(draw_phase_state.view_mat);
+    zf4::InitIdentityMatrix4x4(draw_phase_state.view_mat);
 
-static bool DrawGame(zf4::s_draw_phase_state& draw_phase_state, const zf4::s_game_ptrs& game_ptrs, const double fps) {
-    const auto game = static_cast<s_game*>(game_ptrs.custom_data);
+    BeginSpriteBatch(app->sprites, app->shader_progs[ek_shader_prog_sprite], TextureGLID(0, game_ptrs.renderer), TextureSize(0, game_ptrs.renderer), draw_phase_state.view_mat, game_ptrs.window.size_cache);
 
-    zf4::RenderClear(i_bg_color);
+    // Draw the frame time histogram. This is batched, so it is flushed before any text is drawn over it.
+    DrawFrameTimeHistogram(app->frame_times, {10.0f, game_ptrs.window.size_cache.y - 10.0f}, app->sprites);
+    FlushSpriteBatch(app->sprites);
 
-    //
-    // Level
-    //
-    zf4::ZeroOutStruct(draw_phase_state.view_mat);
-    draw_phase_state.view_mat = LoadCameraViewMatrix4x4(game->cam_pos, game_ptrs.window.size_cache);
+    // NOTE: Text is drawn through the text run cache rather than the batch, so that strings which have not changed since they were last drawn are not laid out again.
+    BeginTextRunFrame(app->text_runs);
 
-    // Draw enemies.
-    for (int i = 0; i < game->enemies.len; ++i) {
-        const s_enemy& enemy = game->enemies[i];
-        zf4::SubmitTextureToRenderBatch(0, i_sprite_src_rects[i_enemy_type_sprite_indexes[enemy.type]], enemy.pos, draw_phase_state, game_ptrs.renderer, {0.5f, 0.5f}, {1.0f, 1.0f}, enemy.rot);
-    }
+    // Refresh the HUD readouts at a fixed rate.
+    if (app->hud_info.version == 0 || draw_scope.begin_ns - app->hud_info_refresh_ns >= i_hud_info_refresh_interval_ns) {
+        s_hud_info& hud_info = app->hud_info;
 
-    // Draw the player.
-    if (game->player_active) {
-        const float alpha = game->player.inv_cooldown > 0 ? 0.5f + (0.25f * (game->player.inv_cooldown & 1)) : 1.0f;
-        zf4::SubmitTextureToRenderBatch(0, i_sprite_src_rects[ek_sprite_index_player], game->player.pos, draw_phase_state, game_ptrs.renderer, {0.5f, 0.5f}, {1.0f, 1.0f}, game->player.rot, {1.0f, 1.0f, 1.0f, alpha});
-    }
+        hud_info.fps = fps;
+        hud_info.cull_stats = cull_stats;
+        hud_info.slowest_phase_found = FindSlowestTickPhase(hud_info.slowest_phase, hud_info.slowest_phase_ms);
+        hud_info.latency_found = CalcMeanLatency(app->latency, hud_info.latency_ms);
+        hud_info.late_latch = g_late_latch;
+        hud_info.level_res_scale = app->dynamic_res.level_res_scale;
+        hud_info.dynamic_res = g_dynamic_res;
 
-    // Draw projectiles.
-    for (int i = 0; i < game->projectiles.len; ++i) {
-        const s_projectile& proj = game->projectiles[i];
-        zf4::SubmitTextureToRenderBatch(0, i_sprite_src_rects[ek_sprite_index_bullet], proj.pos, draw_phase_state, game_ptrs.renderer);
-    }
+        ++hud_info.version;
 
-    // Draw tiles.
-    for (int y = 0; y < i_tilemap_size.y; ++y) {
-        for (int x = 0; x < i_tilemap_size.x; ++x) {
-            if (IsTileActive(x, y, game->tilemap)) {
-                const zf4::s_vec_2d pos = TileToLevelPos(x, y);
-                zf4::SubmitTextureToRenderBatch(0, i_sprite_src_rects[ek_sprite_index_tile], pos, draw_phase_state, game_ptrs.renderer, {});
-            }
-        }
+        app->hud_info_refresh_ns = draw_scope.begin_ns;
     }
 
-    zf4::FlushTextureBatch(draw_phase_state, game_ptrs.renderer);
+    DrawHud(app->text_runs, app->hud_strs, app->font, *game, app->hud_info, draw_phase_state.view_mat, game_ptrs.window.size_cache, app->shader_progs[ek_shader_prog_text_run]);
 
-    //
-    // UI
-    //
-    zf4::ZeroOutStruct(draw_phase_state.view_mat);
-    zf4::InitIdentityMatrix4x4(draw_phase_state.view_mat);
+    SubmitSprite(app->sprites, i_sprite_src_rects[ek_sprite_index_cursor], view.mouse_pos, {0.5f, 0.5f}, {2.0f, 2.0f});
 
-    // Draw player statistics.
-    if (game->player_active) {
-        char hp_str[20] = {};
-        std::snprintf(hp_str, sizeof(hp_str), "HP: %d", game->player.hp);
-        zf4::SubmitStrToRenderBatch(hp_str, ek_font_eb_garamond_28, {game_ptrs.window.size_cache.x - 10.0f, 10.0f}, zf4::colors::g_white, zf4::ek_str_hor_align_right, zf4::ek_str_ver_align_top, draw_phase_state, game_ptrs.renderer);
-    }
+    FlushSpriteBatch(app->sprites);
 
-    // Draw rule text.
-    {
-        char str[32] = {};
-        std::snprintf(str, sizeof(str), "%s (%.2f)", i_rule_type_strs[game->rule_type], game->rule_change_time / 60.0f);
+    EndLatencyFrame(app->latency);
 
-        const zf4::s_vec_2d pos = {
-            game_ptrs.window.size_cache.x / 2.0f,
-            (game_ptrs.window.size_cache.y / 6.0f) * 5.0f
-        };
+    return true;
+}
+
+// The game loop exits on failure, so the app is released first.
+static bool GameTick(const zf4::s_game_ptrs& game_ptrs, const double fps) {
+    const auto app = static_cast<s_app*>(game_ptrs.custom_data);
 
-        zf4::SubmitStrToRenderBatch(str, ek_font_eb_garamond_36, pos, zf4::colors::g_white, zf4::ek_str_hor_align_center, zf4::ek_str_ver_align_top, draw_phase_state, game_ptrs.renderer);
+    if (!TickApp(app, game_ptrs)) {
+        CleanApp(*app);
+        return false;
     }
 
-    // Draw FPS.
-    char fps_str[20] = {};
-    std::snprintf(fps_str, sizeof(fps_str), "FPS: %.2f", fps);
-    SubmitStrToRenderBatch(fps_str, 0, {10.0f, 10.0f}, zf4::colors::g_white, zf4::ek_str_hor_align_left, zf4::ek_str_ver_align_top, draw_phase_state, game_ptrs.renderer);
+    return true;
+}
 
-    zf4::SubmitTextureToRenderBatch(0, i_sprite_src_rects[ek_sprite_index_cursor], game_ptrs.window.input_state.mouse_pos, draw_phase_state, game_ptrs.renderer, {0.5f, 0.5f}, {2.0f, 2.0f});
+static bool DrawGame(zf4::s_draw_phase_state& draw_phase_state, const zf4::s_game_ptrs& game_ptrs, const double fps) {
+    const auto app = static_cast<s_app*>(game_ptrs.custom_data);
 
-    zf4::FlushTextureBatch(draw_phase_state, game_ptrs.renderer);
+    if (!DrawApp(app, draw_phase_state, game_ptrs, fps)) {
+        CleanApp(*app);
+        return false;
+    }
 
     return true;
 }
@@ -677,10 +583,57 @@ static void LoadGameInfo(zf4::s_game_info* const info) {
     info->window_title = "God Complex";
     info->window_flags = (zf4::e_window_flags)(zf4::ek_window_flags_hide_cursor | zf4::ek_window_flags_resizable);
 
-    info->custom_data_size = sizeof(s_game);
-    info->custom_data_alignment = alignof(s_game);
+    info->custom_data_size = sizeof(s_app);
+    info->custom_data_alignment = alignof(s_app);
 }
 
-int main(void) {
-    return RunGame(LoadGameInfo) ? EXIT_SUCCESS : EXIT_FAILURE;
+int main(const int arg_cnt, const char* const* const args) {
+    g_input_recording.seed = (uint64_t)std::time(nullptr);
+
+    for (int i = 1; i < arg_cnt; ++i) {
+        if (std::strcmp(args[i], "--record") == 0 && i + 1 < arg_cnt) {
+            g_input_recording.file_path = args[++i];
+        } else if (std::strcmp(args[i], "--trace") == 0 && i + 1 < arg_cnt) {
+            g_trace_file_path = args[++i];
+        } else if (std::strcmp(args[i], "--seed") == 0 && i + 1 < arg_cnt) {
+            g_input_recording.seed = std::strtoull(args[++i], nullptr, 10);
+        } else if (std::strcmp(args[i], "--late-latch") == 0) {
+            g_late_latch = true;
+        } else if (std::strcmp(args[i], "--map") == 0 && i + 1 < arg_cnt) {
+            g_map_file_path = args[++i];
+        } else if (std::strcmp(args[i], "--dynamic-res") == 0) {
+            g_dynamic_res = true;
+        } else {
+            std::fprintf(stderr, "Usage: %s [--seed <seed>] [--record <path>] [--trace <path>] [--late-latch] [--map <path>] [--dynamic-res]\n", args[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    s_job_system job_system;
+
+    // NOTE: The main thread takes part in parallel phases too, hence one fewer worker than there are hardware threads.
+    if (!InitJobSystem(job_system, zf4::Max((int)std::thread::hardware_concurrency() - 1, 0))) {
+        return EXIT_FAILURE;
+    }
+
+    g_job_system = &job_system;
+
+    bool success = RunGame(LoadGameInfo);
+
+    CleanJobSystem(job_system);
+    g_job_system = nullptr;
+
+    // The recording is finished with the state as of the last completed tick, which a replay of its inputs should reproduce.
+    if (g_input_recording.recorder.fs) {
+        if (!EndInputRecording(g_input_recording.recorder, g_input_recording.last_state_hash)) {
+            std::fprintf(stderr, "Failed to finish input recording \"%s\"!\n", g_input_recording.file_path);
+            success = false;
+        }
+    }
+
+    if (g_trace_file_path && !WriteChromeTrace(g_trace_file_path)) {
+        success = false;
+    }
+
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
 }
@@ -0,0 +1,619 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <chrono>
+#include <algorithm>
+#include <vector>
+#include "alloc_counter.h"
+#include "game.h"
+#include "jobs.h"
+#include "replay.h"
+#include "snapshot.h"
+#include "profiler.h"
+
+// NOTE: This runs the simulation without a window or GL context, so that tick cost can be measured and regressed on machines without a display.
+
+static constexpr int i_default_tick_cnt = 60 * 60 * 5;
+static constexpr zf4::s_vec_2d_i i_headless_window_size = {1280, 720};
+static constexpr uint64_t i_default_seed = 1;
+
+// Produces a deterministic stream of input that keeps the player moving around and shooting, which is roughly what a real session looks like.
+static s_tick_input LoadScriptedTickInput(const int tick) {
+    int flags = ek_tick_input_flags_shoot;
+
+    switch ((tick / 45) % 4) {
+        case 0: flags |= ek_tick_input_flags_move_right; break;
+        case 1: flags |= ek_tick_input_flags_move_down; break;
+        case 2: flags |= ek_tick_input_flags_move_left; break;
+        case 3: flags |= ek_tick_input_flags_move_up; break;
+    }
+
+    const float aim_dir = tick * 0.05f;
+    const zf4::s_vec_2d window_center = {i_headless_window_size.x / 2.0f, i_headless_window_size.y / 2.0f};
+
+    return {
+        .flags = (e_tick_input_flags)flags,
+        .mouse_pos = window_center + zf4::s_vec_2d {cosf(aim_dir), sinf(aim_dir)} * 200.0f,
+        .window_size = i_headless_window_size
+    };
+}
+
+// The bit-at-a-time tile query over a flat bitset, as used before tilemap rows were word-aligned, kept as a baseline for the tile query benchmark.
+static bool TileCollisionCheckPerBit(const zf4::s_rect collider, const std::vector<zf4::a_byte>& activity, const zf4::s_vec_2d_i tilemap_size) {
+    const int tx_begin = zf4::Clamp((int)floorf(collider.x / i_tile_size), 0, tilemap_size.x - 1);
+    const int ty_begin = zf4::Clamp((int)floorf(collider.y / i_tile_size), 0, tilemap_size.y - 1);
+
+    const int tx_end = zf4::Clamp((int)ceilf(RectRight(collider) / i_tile_size), 0, tilemap_size.x);
+    const int ty_end = zf4::Clamp((int)ceilf(RectBottom(collider) / i_tile_size), 0, tilemap_size.y);
+
+    for (int ty = ty_begin; ty < ty_end; ++ty) {
+        for (int tx = tx_begin; tx < tx_end; ++tx) {
+            const int64_t tile_index = ((int64_t)ty * tilemap_size.x) + tx;
+
+            if (activity[tile_index / 8] & (1 << (tile_index % 8))) {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+// Times the chunked tile query against the per-bit one over the same set of rects, and checks that they agree.
+static bool RunTileQueryBenchmark(const s_tilemap& tilemap) {
+    static constexpr int i_rect_cnt = 1 << 16;
+    static constexpr int i_pass_cnt = 32;
+
+    std::vector<zf4::a_byte> activity((((int64_t)tilemap.size.x * tilemap.size.y) + 7) / 8);
+
+    for (int y = 0; y < tilemap.size.y; ++y) {
+        for (int x = 0; x < tilemap.size.x; ++x) {
+            if (IsTileActive(x, y, tilemap)) {
+                const int64_t tile_index = ((int64_t)y * tilemap.size.x) + x;
+                activity[tile_index / 8] |= (zf4::a_byte)(1 << (tile_index % 8));
+            }
+        }
+    }
+
+    const zf4::s_vec_2d_i level_size = LevelSize(tilemap);
+
+    // Use a spread of rect sizes covering bullets up to the largest enemies, positioned all over the level and slightly beyond it.
+    std::vector<zf4::s_rect> rects(i_rect_cnt);
+
+    unsigned int seed = 12345;
+
+    const auto next_rand_perc = [&seed]() {
+        seed = (seed * 1664525u) + 1013904223u;
+        return (seed >> 8) / (float)(1 << 24);
+    };
+
+    for (zf4::s_rect& rect : rects) {
+        rect.width = 4.0f + (next_rand_perc() * 28.0f);
+        rect.height = 4.0f + (next_rand_perc() * 28.0f);
+        rect.x = (next_rand_perc() * (level_size.x + 64.0f)) - 32.0f;
+        rect.y = (next_rand_perc() * (level_size.y + 64.0f)) - 32.0f;
+    }
+
+    int hit_cnt_per_bit = 0;
+    int hit_cnt_chunked = 0;
+
+    const auto per_bit_begin = std::chrono::steady_clock::now();
+
+    for (int p = 0; p < i_pass_cnt; ++p) {
+        for (const zf4::s_rect& rect : rects) {
+            hit_cnt_per_bit += TileCollisionCheckPerBit(rect, activity, tilemap.size);
+        }
+    }
+
+    const auto chunked_begin = std::chrono::steady_clock::now();
+
+    for (int p = 0; p < i_pass_cnt; ++p) {
+        for (const zf4::s_rect& rect : rects) {
+            hit_cnt_chunked += TileCollisionCheck(rect, tilemap);
+        }
+    }
+
+    const auto chunked_end = std::chrono::steady_clock::now();
+
+    const double query_cnt = (double)i_rect_cnt * i_pass_cnt;
+    const double per_bit_ns = std::chrono::duration<double, std::nano>(chunked_begin - per_bit_begin).count() / query_cnt;
+    const double chunked_ns = std::chrono::duration<double, std::nano>(chunked_end - chunked_begin).count() / query_cnt;
+
+    std::printf("tile query ns (per-bit): %.2f\n", per_bit_ns);
+    std::printf("tile query ns (chunked): %.2f\n", chunked_ns);
+    std::printf("tile query speedup: %.2fx\n", per_bit_ns / chunked_ns);
+
+    if (hit_cnt_per_bit != hit_cnt_chunked) {
+        std::fprintf(stderr, "Tile query results differ! Per-bit hits: %d, chunked hits: %d\n", hit_cnt_per_bit, hit_cnt_chunked);
+        return false;
+    }
+
+    return true;
+}
+
+static constexpr int i_gen_map_block_size = 4; // In tiles.
+static constexpr int i_gen_map_open_radius = 16; // In tiles, around the centre of the map where the player spawns.
+
+// A walled map scattered with blocks, a quarter of which are solid, giving open ground broken up by pillars and short walls.
+static bool IsGenMapTileActive(const int x, const int y, void* const data) {
+    const zf4::s_vec_2d_i size = *static_cast<const zf4::s_vec_2d_i*>(data);
+
+    if (x == 0 || y == 0 || x == size.x - 1 || y == size.y - 1) {
+        return true;
+    }
+
+    if (abs(x - (size.x / 2)) < i_gen_map_open_radius && abs(y - (size.y / 2)) < i_gen_map_open_radius) {
+        return false;
+    }
+
+    uint32_t hash = ((uint32_t)(x / i_gen_map_block_size) * 0x8DA6B343u) ^ ((uint32_t)(y / i_gen_map_block_size) * 0xD8163841u);
+    hash ^= hash >> 15;
+    hash *= 0x2C1B3C6Du;
+    hash ^= hash >> 12;
+
+    return (hash & 3) == 0;
+}
+
+static double Percentile(const std::vector<double>& sorted_vals, const double perc) {
+    assert(!sorted_vals.empty());
+    const size_t index = std::min(sorted_vals.size() - 1, (size_t)(perc * (sorted_vals.size() - 1) + 0.5));
+    return sorted_vals[index];
+}
+
+// Fills the level with extra enemies and slow-moving enemy projectiles, to measure how the tick scales with entity counts well past what normal play produces.
+static bool SpawnStressEntities(s_game& game, const int enemy_cnt, const int projectile_cnt) {
+    unsigned int seed = 54321;
+
+    const auto next_rand_perc = [&seed]() {
+        seed = (seed * 1664525u) + 1013904223u;
+        return (seed >> 8) / (float)(1 << 24);
+    };
+
+    const zf4::s_vec_2d_i level_size = LevelSize(game.tilemap);
+    const zf4::s_vec_2d spawn_area_size = {(float)(level_size.x - (i_tile_size * 4)), (float)(level_size.y - (i_tile_size * 4))};
+
+    for (int i = 0; i < enemy_cnt; ++i) {
+        const zf4::s_vec_2d pos = {(i_tile_size * 2) + (next_rand_perc() * spawn_area_size.x), (i_tile_size * 2) + (next_rand_perc() * spawn_area_size.y)};
+        const e_enemy_type type = next_rand_perc() < 0.7f ? ek_enemy_type_red : ek_enemy_type_purple;
+
+        if (SpawnEnemy(pos, type, game.enemies).slot == -1) {
+            return false;
+        }
+    }
+
+    for (int i = 0; i < projectile_cnt; ++i) {
+        const zf4::s_vec_2d pos = {(i_tile_size * 2) + (next_rand_perc() * spawn_area_size.x), (i_tile_size * 2) + (next_rand_perc() * spawn_area_size.y)};
+
+        if (SpawnProjectile(pos, 0.05f, next_rand_perc() * zf4::g_pi * 2.0f, true, game.projectiles).slot == -1) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static double Mean(const std::vector<double>& vals) {
+    assert(!vals.empty());
+
+    double sum = 0.0;
+
+    for (const double val : vals) {
+        sum += val;
+    }
+
+    return sum / vals.size();
+}
+
+// Restores every snapshot still held, newest first since restoring drops the snapshots after the one restored, and checks each against the state hash taken when it was captured.
+static bool RunSnapshotRestoreBenchmark(s_game& game, s_snapshot_history& history, const std::vector<uint64_t>& state_hashes, const std::vector<double>& capture_times_ns) {
+    int keyframe_cnt = 0;
+    int keyframe_bytes = 0;
+    int delta_cnt = 0;
+    int delta_bytes = 0;
+
+    for (int i = 0; i < history.snapshots.len; ++i) {
+        const s_snapshot& snapshot = history.snapshots[i];
+
+        if (!CanRestoreSnapshot(history, snapshot.index)) {
+            continue;
+        }
+
+        if (snapshot.index % i_snapshot_keyframe_interval == 0) {
+            ++keyframe_cnt;
+            keyframe_bytes += snapshot.size;
+        } else {
+            ++delta_cnt;
+            delta_bytes += snapshot.size;
+        }
+    }
+
+    const int held_cnt = keyframe_cnt + delta_cnt;
+    const double held_secs = held_cnt / 60.0;
+
+    std::vector<double> restore_times_ns;
+    restore_times_ns.reserve(held_cnt);
+
+    for (int index = history.snapshot_cnt - 1; CanRestoreSnapshot(history, index); --index) {
+        const auto restore_begin = std::chrono::steady_clock::now();
+
+        if (!RestoreSnapshot(game, history, index)) {
+            std::fprintf(stderr, "Failed to restore snapshot %d!\n", index);
+            return false;
+        }
+
+        restore_times_ns.push_back(std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - restore_begin).count());
+
+        if (HashGameState(game) != state_hashes[index]) {
+            std::fprintf(stderr, "Snapshot %d restored to a different state than was captured!\n", index);
+            return false;
+        }
+    }
+
+    std::vector<double> sorted_capture_times_ns = capture_times_ns;
+    std::sort(sorted_capture_times_ns.begin(), sorted_capture_times_ns.end());
+
+    std::printf("snapshots held: %d (%.1f secs)\n", held_cnt, held_secs);
+    std::printf("snapshot avg bytes (keyframe): %.0f\n", keyframe_cnt > 0 ? (double)keyframe_bytes / keyframe_cnt : 0.0);
+    std::printf("snapshot avg bytes (delta): %.0f\n", delta_cnt > 0 ? (double)delta_bytes / delta_cnt : 0.0);
+    std::printf("snapshot history bytes/sec (encoded): %.0f\n", (keyframe_bytes + delta_bytes) / held_secs);
+    std::printf("snapshot history bytes/sec (allocated): %.0f\n", CalcSnapshotHistorySize(history) / held_secs);
+    std::printf("snapshot capture ns avg: %.0f, p99: %.0f\n", Mean(sorted_capture_times_ns), Percentile(sorted_capture_times_ns, 0.99));
+    std::printf("snapshot restore ns avg: %.0f, max: %.0f\n", Mean(restore_times_ns), *std::max_element(restore_times_ns.begin(), restore_times_ns.end()));
+
+    return true;
+}
+
+// Prints the average time of each zone over the events still in the profiler's buffer, which covers the last few thousand ticks.
+static bool PrintProfileZoneStats() {
+    std::vector<s_profile_event> events(i_profile_event_buf_len);
+    const int event_cnt = LoadRecentProfileEvents(events.data(), i_profile_event_buf_len);
+
+    zf4::s_static_array<double, eks_profile_zone_cnt> zone_total_ns = {};
+    zf4::s_static_array<int, eks_profile_zone_cnt> zone_event_cnts = {};
+
+    for (int i = 0; i < event_cnt; ++i) {
+        zone_total_ns[events[i].zone] += events[i].end_ns - events[i].begin_ns;
+        ++zone_event_cnts[events[i].zone];
+    }
+
+    if (zone_event_cnts[ek_profile_zone_tick] == 0) {
+        return false;
+    }
+
+    std::printf("zone ns avg per tick (last %d ticks):\n", zone_event_cnts[ek_profile_zone_tick]);
+
+    for (int i = 0; i < eks_profile_zone_cnt; ++i) {
+        if (zone_event_cnts[i] > 0) {
+            std::printf("  %s: %.0f\n", i_profile_zone_names[i], zone_total_ns[i] / zone_event_cnts[ek_profile_zone_tick]);
+        }
+    }
+
+    return true;
+}
+
+static void PrintUsage(const char* const exe_name) {
+    std::fprintf(stderr, "Usage: %s [--ticks <cnt>] [--stress-enemies <cnt>] [--stress-projectiles <cnt>] [--workers <cnt>] [--seed <seed>] [--record <path>] [--replay <path>] [--trace <path>] [--bench-snapshots] [--bench-tile-queries] [--check-steady-allocs] [--map <path>] [--gen-map <path> <width> <height>]\n", exe_name);
+}
+
+int main(const int arg_cnt, const char* const* const args) {
+    int tick_cnt = i_default_tick_cnt;
+    int stress_enemy_cnt = 0;
+    int stress_projectile_cnt = 0;
+    int worker_cnt = 0;
+    uint64_t seed = i_default_seed;
+    const char* record_file_path = nullptr;
+    const char* replay_file_path = nullptr;
+    const char* trace_file_path = nullptr;
+    bool bench_snapshots = false;
+    bool bench_tile_queries = false;
+    bool check_steady_allocs = false;
+    const char* map_file_path = nullptr;
+
+    for (int i = 1; i < arg_cnt; ++i) {
+        if (std::strcmp(args[i], "--ticks") == 0 && i + 1 < arg_cnt) {
+            tick_cnt = std::atoi(args[++i]);
+
+            if (tick_cnt <= 0) {
+                PrintUsage(args[0]);
+                return EXIT_FAILURE;
+            }
+        } else if (std::strcmp(args[i], "--stress-enemies") == 0 && i + 1 < arg_cnt) {
+            stress_enemy_cnt = std::atoi(args[++i]);
+        } else if (std::strcmp(args[i], "--stress-projectiles") == 0 && i + 1 < arg_cnt) {
+            stress_projectile_cnt = std::atoi(args[++i]);
+        } else if (std::strcmp(args[i], "--workers") == 0 && i + 1 < arg_cnt) {
+            worker_cnt = std::atoi(args[++i]);
+
+            if (worker_cnt < 0) {
+                PrintUsage(args[0]);
+                return EXIT_FAILURE;
+            }
+        } else if (std::strcmp(args[i], "--seed") == 0 && i + 1 < arg_cnt) {
+            seed = std::strtoull(args[++i], nullptr, 10);
+        } else if (std::strcmp(args[i], "--record") == 0 && i + 1 < arg_cnt) {
+            record_file_path = args[++i];
+        } else if (std::strcmp(args[i], "--replay") == 0 && i + 1 < arg_cnt) {
+            replay_file_path = args[++i];
+        } else if (std::strcmp(args[i], "--trace") == 0 && i + 1 < arg_cnt) {
+            trace_file_path = args[++i];
+        } else if (std::strcmp(args[i], "--bench-snapshots") == 0) {
+            bench_snapshots = true;
+        } else if (std::strcmp(args[i], "--bench-tile-queries") == 0) {
+            bench_tile_queries = true;
+        } else if (std::strcmp(args[i], "--check-steady-allocs") == 0) {
+            check_steady_allocs = true;
+        } else if (std::strcmp(args[i], "--map") == 0 && i + 1 < arg_cnt) {
+            map_file_path = args[++i];
+        } else if (std::strcmp(args[i], "--gen-map") == 0 && i + 3 < arg_cnt) {
+            // Writes the map and exits, without running the simulation.
+            const char* const gen_map_file_path = args[++i];
+            zf4::s_vec_2d_i size = {std::atoi(args[i + 1]), std::atoi(args[i + 2])};
+            i += 2;
+
+            if (size.x <= i_gen_map_open_radius * 2 || size.y <= i_gen_map_open_radius * 2) {
+                PrintUsage(args[0]);
+                return EXIT_FAILURE;
+            }
+
+            if (!WriteTilemapFile(gen_map_file_path, size, IsGenMapTileActive, &size)) {
+                return EXIT_FAILURE;
+            }
+
+            std::printf("map written to \"%s\" (%dx%d tiles)\n", gen_map_file_path, size.x, size.y);
+            return EXIT_SUCCESS;
+        } else {
+            PrintUsage(args[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    // When replaying, the seed and tick count come from the recording. Stress entities are not recorded, so they would make the final state differ. The map is not recorded either, so a replay has to be given the map it was recorded on.
+    s_input_replay replay = {};
+
+    if (replay_file_path) {
+        if (record_file_path || stress_enemy_cnt > 0 || stress_projectile_cnt > 0) {
+            PrintUsage(args[0]);
+            return EXIT_FAILURE;
+        }
+
+        if (!LoadInputReplay(replay, replay_file_path)) {
+            return EXIT_FAILURE;
+        }
+
+        if (replay.tick_cnt == 0) {
+            std::fprintf(stderr, "Replay \"%s\" has no ticks!\n", replay_file_path);
+            CleanInputReplay(replay);
+            return EXIT_FAILURE;
+        }
+
+        seed = replay.seed;
+        tick_cnt = replay.tick_cnt;
+    }
+
+    const auto game = static_cast<s_game*>(std::calloc(1, sizeof(s_game)));
+
+    if (!game) {
+        std::fprintf(stderr, "Failed to allocate game state!\n");
+        CleanInputReplay(replay);
+        return EXIT_FAILURE;
+    }
+
+    if (!InitGameState(*game, seed, map_file_path)) {
+        CleanInputReplay(replay);
+        std::free(game);
+        return EXIT_FAILURE;
+    }
+
+    if (bench_tile_queries) {
+        const bool success = RunTileQueryBenchmark(game->tilemap);
+        CleanInputReplay(replay);
+        CleanGameState(*game);
+        std::free(game);
+        return success ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    if (!SpawnStressEntities(*game, stress_enemy_cnt, stress_projectile_cnt)) {
+        std::fprintf(stderr, "Failed to spawn stress entities!\n");
+        CleanInputReplay(replay);
+        CleanGameState(*game);
+        std::free(game);
+        return EXIT_FAILURE;
+    }
+
+    s_job_system job_system;
+
+    if (!InitJobSystem(job_system, worker_cnt)) {
+        std::fprintf(stderr, "Failed to initialise the job system!\n");
+        CleanInputReplay(replay);
+        CleanGameState(*game);
+        std::free(game);
+        return EXIT_FAILURE;
+    }
+
+    s_input_recorder recorder = {};
+
+    if (record_file_path && !BeginInputRecording(recorder, record_file_path, seed, i_headless_window_size)) {
+        CleanJobSystem(job_system);
+        CleanInputReplay(replay);
+        CleanGameState(*game);
+        std::free(game);
+        return EXIT_FAILURE;
+    }
+
+    s_snapshot_history* snapshot_history = nullptr;
+    std::vector<uint64_t> snapshot_state_hashes;
+    std::vector<double> snapshot_capture_times_ns;
+
+    if (bench_snapshots) {
+        snapshot_history = static_cast<s_snapshot_history*>(std::calloc(1, sizeof(s_snapshot_history)));
+
+        if (!snapshot_history) {
+            std::fprintf(stderr, "Failed to allocate snapshot history!\n");
+            CleanJobSystem(job_system);
+            CleanInputReplay(replay);
+            CleanGameState(*game);
+            std::free(game);
+            return EXIT_FAILURE;
+        }
+
+        InitSnapshotHistory(*snapshot_history);
+
+        snapshot_state_hashes.resize(tick_cnt);
+        snapshot_capture_times_ns.resize(tick_cnt);
+    }
+
+    std::vector<double> tick_times_ns(tick_cnt);
+
+    int peak_streamed_page_cnt = 0;
+
+    // Heap allocations made during ticks, overall and over the second half of the run, by which point pools and scratch should have grown to fit.
+    int tick_heap_alloc_cnt = 0;
+    int steady_tick_heap_alloc_cnt = 0;
+
+    const auto run_begin = std::chrono::steady_clock::now();
+
+    bool run_failed = false;
+
+    for (int i = 0; i < tick_cnt; ++i) {
+        const s_tick_input input = replay_file_path ? replay.inputs[i] : LoadScriptedTickInput(i);
+
+        if (record_file_path && !RecordTickInput(recorder, input)) {
+            std::fprintf(stderr, "Failed to record input for tick %d!\n", i);
+            run_failed = true;
+            break;
+        }
+
+        const int heap_alloc_cnt_before = g_heap_alloc_cnt.load(std::memory_order_relaxed);
+
+        const auto tick_begin = std::chrono::steady_clock::now();
+
+        if (!TickGame(*game, input, &job_system)) {
+            std::fprintf(stderr, "Tick %d failed!\n", i);
+            run_failed = true;
+            break;
+        }
+
+        const auto tick_end = std::chrono::steady_clock::now();
+
+        const int tick_heap_alloc_cnt_delta = g_heap_alloc_cnt.load(std::memory_order_relaxed) - heap_alloc_cnt_before;
+
+        tick_heap_alloc_cnt += tick_heap_alloc_cnt_delta;
+
+        if (i >= tick_cnt / 2) {
+            steady_tick_heap_alloc_cnt += tick_heap_alloc_cnt_delta;
+        }
+
+        tick_times_ns[i] = std::chrono::duration<double, std::nano>(tick_end - tick_begin).count();
+
+        if (game->tilemap.file_data) {
+            peak_streamed_page_cnt = std::max(peak_streamed_page_cnt, CountWantedTilemapPages(game->tilemap));
+        }
+
+        if (snapshot_history) {
+            if (!CaptureSnapshot(*snapshot_history, *game)) {
+                std::fprintf(stderr, "Failed to capture snapshot for tick %d!\n", i);
+                run_failed = true;
+                break;
+            }
+
+            snapshot_capture_times_ns[i] = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - tick_end).count();
+            snapshot_state_hashes[i] = HashGameState(*game);
+        }
+    }
+
+    const double run_secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - run_begin).count();
+
+    if (run_failed) {
+        if (record_file_path) {
+            EndInputRecording(recorder, 0);
+        }
+
+        if (snapshot_history) {
+            CleanSnapshotHistory(*snapshot_history);
+            std::free(snapshot_history);
+        }
+
+        CleanJobSystem(job_system);
+        CleanInputReplay(replay);
+        CleanGameState(*game);
+        std::free(game);
+        return EXIT_FAILURE;
+    }
+
+    const uint64_t final_state_hash = HashGameState(*game);
+    bool success = true;
+
+    if (record_file_path && !EndInputRecording(recorder, final_state_hash)) {
+        std::fprintf(stderr, "Failed to finish input recording \"%s\"!\n", record_file_path);
+        success = false;
+    }
+
+    std::sort(tick_times_ns.begin(), tick_times_ns.end());
+
+    std::printf("ticks: %d (%d workers)\n", tick_cnt, worker_cnt);
+    std::printf("ticks/sec: %.1f\n", tick_cnt / run_secs);
+    std::printf("tick ns p50: %.0f\n", Percentile(tick_times_ns, 0.5));
+    std::printf("tick ns p90: %.0f\n", Percentile(tick_times_ns, 0.9));
+    std::printf("tick ns p99: %.0f\n", Percentile(tick_times_ns, 0.99));
+    std::printf("tick ns max: %.0f\n", tick_times_ns.back());
+    int enemy_cap = 0;
+
+    for (int i = 0; i < eks_enemy_type_cnt; ++i) {
+        enemy_cap += game->enemies.archetypes[i].cap;
+    }
+
+    std::printf("final enemies: %d, projectiles: %d\n", CountEnemies(game->enemies), game->projectiles.len);
+    std::printf("pool capacity enemies: %d, projectiles: %d\n", enemy_cap, game->projectiles.cap);
+    std::printf("tick heap allocations: %d (%d in the second half)\n", tick_heap_alloc_cnt, steady_tick_heap_alloc_cnt);
+    std::printf("frame arena capacity: %d bytes\n", game->frame_arena.cap);
+    std::printf("final state hash: %016llx\n", (unsigned long long)final_state_hash);
+
+    // NOTE: This is the check that steady-state ticks make no heap allocations. It fails the run, and so the exit code, rather than only reporting the count, so that it can gate automated runs.
+    if (check_steady_allocs && steady_tick_heap_alloc_cnt > 0) {
+        std::fprintf(stderr, "Ticks were still allocating in the second half of the run! Allocations: %d\n", steady_tick_heap_alloc_cnt);
+        success = false;
+    }
+
+    if (game->tilemap.file_data) {
+        std::printf("map: %dx%d tiles, %d pages, %d chunks edited\n", game->tilemap.size.x, game->tilemap.size.y, game->tilemap.page_cnt, game->tilemap.edited_chunk_cnt);
+        std::printf("map pages streamed in peak: %d, final: %d\n", peak_streamed_page_cnt, CountWantedTilemapPages(game->tilemap));
+    }
+
+    PrintProfileZoneStats();
+
+    if (trace_file_path) {
+        if (WriteChromeTrace(trace_file_path)) {
+            std::printf("trace written to \"%s\"\n", trace_file_path);
+        } else {
+            std::fprintf(stderr, "Failed to write trace \"%s\"!\n", trace_file_path);
+            success = false;
+        }
+    }
+
+    if (replay_file_path) {
+        if (final_state_hash == replay.final_state_hash) {
+            std::printf("replay matches recording\n");
+        } else {
+            std::fprintf(stderr, "Replay diverged! Recorded final state hash: %016llx\n", (unsigned long long)replay.final_state_hash);
+            success = false;
+        }
+    }
+
+    // This is done last since it leaves the game in the state of the oldest snapshot held.
+    if (snapshot_history) {
+        if (!RunSnapshotRestoreBenchmark(*game, *snapshot_history, snapshot_state_hashes, snapshot_capture_times_ns)) {
+            success = false;
+        }
+
+        CleanSnapshotHistory(*snapshot_history);
+        std::free(snapshot_history);
+    }
+
+    CleanJobSystem(job_system);
+    CleanInputReplay(replay);
+    CleanGameState(*game);
+    std::free(game);
+
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,165 @@
+#include "jobs.h"
+#include "profiler.h"
+
+static bool PopJobRange(s_job_queue& queue, const bool steal, s_job_range& range) {
+    std::lock_guard<std::mutex> lock(queue.mutex);
+
+    if (queue.front == queue.back) {
+        return false;
+    }
+
+    if (steal) {
+        range = queue.ranges[queue.front];
+        ++queue.front;
+    } else {
+        --queue.back;
+        range = queue.ranges[queue.back];
+    }
+
+    return true;
+}
+
+// Runs ranges until every queue is empty, starting with the participant's own.
+static void RunJobRanges(s_job_system& js, const int participant_index) {
+    const int queue_cnt = js.worker_cnt + 1;
+
+    s_job_range range;
+
+    while (true) {
+        bool found = PopJobRange(js.queues[participant_index], false, range);
+
+        for (int i = 1; !found && i < queue_cnt; ++i) {
+            found = PopJobRange(js.queues[(participant_index + i) % queue_cnt], true, range);
+        }
+
+        if (!found) {
+            return;
+        }
+
+        {
+            s_profile_scope scope(ek_profile_zone_job_range);
+            js.func(range.begin, range.end, js.func_data);
+        }
+
+        js.remaining_range_cnt.fetch_sub(1, std::memory_order_release);
+    }
+}
+
+static void RunWorker(s_job_system* const js, const int worker_index) {
+    SetProfileThreadIndex(worker_index + 1);
+
+    int seen_batch_id = 0;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(js->wake_mutex);
+            js->wake_cond.wait(lock, [js, seen_batch_id]() { return js->quit || js->batch_id != seen_batch_id; });
+
+            if (js->quit) {
+                return;
+            }
+
+            seen_batch_id = js->batch_id;
+        }
+
+        RunJobRanges(*js, worker_index);
+    }
+}
+
+// Starts the worker threads. A worker count of 0 is valid, in which case everything runs on the calling thread.
+bool InitJobSystem(s_job_system& js, const int worker_cnt) {
+    assert(worker_cnt >= 0);
+
+    js.queues = new s_job_queue[worker_cnt + 1];
+    js.workers = new std::thread[worker_cnt];
+    js.worker_cnt = worker_cnt;
+
+    for (int i = 0; i <= worker_cnt; ++i) {
+        js.queues[i].front = 0;
+        js.queues[i].back = 0;
+    }
+
+    js.batch_id = 0;
+    js.quit = false;
+    js.remaining_range_cnt.store(0);
+
+    for (int i = 0; i < worker_cnt; ++i) {
+        js.workers[i] = std::thread(RunWorker, &js, i);
+    }
+
+    return true;
+}
+
+void CleanJobSystem(s_job_system& js) {
+    {
+        std::lock_guard<std::mutex> lock(js.wake_mutex);
+        js.quit = true;
+    }
+
+    js.wake_cond.notify_all();
+
+    for (int i = 0; i < js.worker_cnt; ++i) {
+        js.workers[i].join();
+    }
+
+    delete[] js.workers;
+    delete[] js.queues;
+
+    js.workers = nullptr;
+    js.queues = nullptr;
+    js.worker_cnt = 0;
+}
+
+// Splits the items into ranges and runs them across the workers and the calling thread, returning once all are done. Runs inline if there is no job system or too few items to be worth splitting.
+void ParallelFor(s_job_system* const js, const int cnt, const int min_range_len, const a_job_func func, void* const data) {
+    assert(cnt >= 0);
+    assert(min_range_len > 0);
+
+    if (!js || js->worker_cnt == 0 || cnt <= min_range_len) {
+        if (cnt > 0) {
+            func(0, cnt, data);
+        }
+
+        return;
+    }
+
+    const int queue_cnt = js->worker_cnt + 1;
+
+    // Aim for several ranges per participant so there is something to steal, without going below the minimum range length or overflowing the queues.
+    int range_len = zf4::Max(min_range_len, cnt / (queue_cnt * 8));
+    range_len = zf4::Max(range_len, (cnt + (queue_cnt * i_job_queue_cap) - 1) / (queue_cnt * i_job_queue_cap));
+
+    const int range_cnt = (cnt + range_len - 1) / range_len;
+
+    js->func = func;
+    js->func_data = data;
+    js->remaining_range_cnt.store(range_cnt, std::memory_order_relaxed);
+
+    for (int i = 0; i < range_cnt; ++i) {
+        s_job_queue& queue = js->queues[i % queue_cnt];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+
+        if (queue.front == queue.back) {
+            queue.front = 0;
+            queue.back = 0;
+        }
+
+        assert(queue.back < i_job_queue_cap);
+
+        queue.ranges[queue.back] = {i * range_len, zf4::Min(cnt, (i + 1) * range_len)};
+        ++queue.back;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(js->wake_mutex);
+        ++js->batch_id;
+    }
+
+    js->wake_cond.notify_all();
+
+    RunJobRanges(*js, js->worker_cnt);
+
+    while (js->remaining_range_cnt.load(std::memory_order_acquire) > 0) {
+        std::this_thread::yield();
+    }
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <zf4.h>
+
+static constexpr int i_job_queue_cap = 256;
+
+// Processes the items from "begin" up to but excluding "end".
+using a_job_func = void (*)(const int begin, const int end, void* const data);
+
+struct s_job_range {
+    int begin;
+    int end;
+};
+
+// NOTE: Each participant pops ranges from the back of its own queue and steals from the front of the others', so that uneven ranges get balanced out.
+struct s_job_queue {
+    std::mutex mutex;
+    s_job_range ranges[i_job_queue_cap];
+    int front;
+    int back;
+};
+
+struct s_job_system {
+    std::thread* workers;
+    int worker_cnt;
+
+    s_job_queue* queues; // One per worker, plus one for the thread calling ParallelFor.
+
+    std::mutex wake_mutex;
+    std::condition_variable wake_cond;
+    int batch_id;
+    bool quit;
+
+    a_job_func func;
+    void* func_data;
+    std::atomic<int> remaining_range_cnt;
+};
+
+bool InitJobSystem(s_job_system& js, const int worker_cnt);
+void CleanJobSystem(s_job_system& js);
+void ParallelFor(s_job_system* const js, const int cnt, const int min_range_len, const a_job_func func, void* const data);
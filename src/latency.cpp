@@ -0,0 +1,67 @@
+#include "latency.h"
+
+void InitLatencyTracker(s_latency_tracker& tracker) {
+    assert(zf4::IsStructZero(tracker));
+    glGenQueries(i_latency_query_cnt, tracker.query_gl_ids.elems_raw);
+}
+
+void CleanLatencyTracker(s_latency_tracker& tracker) {
+    glDeleteQueries(i_latency_query_cnt, tracker.query_gl_ids.elems_raw);
+    zf4::ZeroOutStruct(tracker);
+}
+
+// Marks the input that frames will be drawn from as having been sampled now. Frames drawn before the next sample are measured from this one, since that is the newest input they show.
+void MarkInputSampled(s_latency_tracker& tracker) {
+    GLint64 gpu_ns;
+    glGetInteger64v(GL_TIMESTAMP, &gpu_ns);
+    tracker.input_gpu_ns = gpu_ns;
+}
+
+// Collects the measurements of any earlier frames the GPU has finished, then has the GPU timestamp the end of this frame. Should be called once all of the frame's draw commands have been issued.
+void EndLatencyFrame(s_latency_tracker& tracker) {
+    for (int i = 0; i < i_latency_query_cnt; ++i) {
+        if (tracker.query_input_gpu_ns[i] == 0) {
+            continue;
+        }
+
+        GLuint available;
+        glGetQueryObjectuiv(tracker.query_gl_ids[i], GL_QUERY_RESULT_AVAILABLE, &available);
+
+        if (!available) {
+            continue;
+        }
+
+        GLuint64 frame_end_gpu_ns;
+        glGetQueryObjectui64v(tracker.query_gl_ids[i], GL_QUERY_RESULT, &frame_end_gpu_ns);
+
+        tracker.ms[tracker.next_ms_index] = ((int64_t)frame_end_gpu_ns - tracker.query_input_gpu_ns[i]) / 1000000.0f;
+        tracker.next_ms_index = (tracker.next_ms_index + 1) % i_latency_history_len;
+        tracker.ms_cnt = zf4::Min(tracker.ms_cnt + 1, i_latency_history_len);
+
+        tracker.query_input_gpu_ns[i] = 0;
+    }
+
+    // NOTE: If the GPU is so far behind that the next query is still in use, this frame goes unmeasured.
+    if (tracker.input_gpu_ns != 0 && tracker.query_input_gpu_ns[tracker.next_query_index] == 0) {
+        glQueryCounter(tracker.query_gl_ids[tracker.next_query_index], GL_TIMESTAMP);
+        tracker.query_input_gpu_ns[tracker.next_query_index] = tracker.input_gpu_ns;
+        tracker.next_query_index = (tracker.next_query_index + 1) % i_latency_query_cnt;
+    }
+}
+
+// Returns false if nothing has been measured yet.
+bool CalcMeanLatency(const s_latency_tracker& tracker, float& ms) {
+    if (tracker.ms_cnt == 0) {
+        return false;
+    }
+
+    float sum = 0.0f;
+
+    for (int i = 0; i < tracker.ms_cnt; ++i) {
+        sum += tracker.ms[i];
+    }
+
+    ms = sum / tracker.ms_cnt;
+
+    return true;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+#include <glad/glad.h>
+#include <zf4.h>
+
+static constexpr int i_latency_query_cnt = 4; // How many frames can be awaiting their measurement at once.
+static constexpr int i_latency_history_len = 60;
+
+// Measures the time from the input sample a frame was drawn from to the GPU finishing that frame. Both ends are GPU timestamps, so nothing waits on the GPU; frames are measured a few frames late instead. This covers all of input-to-present except for the swap and scan-out, which GL cannot see.
+struct s_latency_tracker {
+    zf4::s_static_array<GLuint, i_latency_query_cnt> query_gl_ids;
+    zf4::s_static_array<int64_t, i_latency_query_cnt> query_input_gpu_ns; // 0 if the query is not awaiting a result.
+    int next_query_index;
+
+    int64_t input_gpu_ns; // When the newest input was sampled, or 0 if none has been.
+
+    zf4::s_static_array<float, i_latency_history_len> ms; // The last so many measurements, in a ring.
+    int ms_cnt;
+    int next_ms_index;
+};
+
+void InitLatencyTracker(s_latency_tracker& tracker);
+void CleanLatencyTracker(s_latency_tracker& tracker);
+void MarkInputSampled(s_latency_tracker& tracker);
+void EndLatencyFrame(s_latency_tracker& tracker);
+bool CalcMeanLatency(const s_latency_tracker& tracker, float& ms);
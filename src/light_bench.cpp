@@ -0,0 +1,290 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <algorithm>
+#include <vector>
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include "lighting.h"
+
+// NOTE: This measures the lighting pass on its own, in a hidden window, so that it can be run against Mesa's software rasteriser (LIBGL_ALWAYS_SOFTWARE=1) as well as real hardware.
+// The shaders are read straight from the asset directory rather than from the asset pack.
+
+static constexpr zf4::s_vec_2d_i i_window_size = {1280, 720};
+static constexpr zf4::s_rect i_cam_rect = {0.0f, 0.0f, i_window_size.x / 2.0f, i_window_size.y / 2.0f};
+static constexpr float i_darkness = 0.6f;
+static constexpr int i_default_frame_cnt = 20;
+
+static char* LoadFileStr(const char* const file_path) {
+    FILE* const fs = std::fopen(file_path, "rb");
+
+    if (!fs) {
+        return nullptr;
+    }
+
+    std::fseek(fs, 0, SEEK_END);
+    const long size = std::ftell(fs);
+    std::fseek(fs, 0, SEEK_SET);
+
+    const auto str = static_cast<char*>(std::malloc(size + 1));
+
+    if (str) {
+        str[std::fread(str, 1, size, fs)] = '\0';
+    }
+
+    std::fclose(fs);
+
+    return str;
+}
+
+static GLuint CompileShader(const char* const file_path, const GLenum type) {
+    char* const src = LoadFileStr(file_path);
+
+    if (!src) {
+        std::fprintf(stderr, "Failed to read shader \"%s\"!\n", file_path);
+        return 0;
+    }
+
+    const GLuint shader_gl_id = glCreateShader(type);
+    glShaderSource(shader_gl_id, 1, &src, nullptr);
+    glCompileShader(shader_gl_id);
+
+    std::free(src);
+
+    GLint success;
+    glGetShaderiv(shader_gl_id, GL_COMPILE_STATUS, &success);
+
+    if (!success) {
+        char log[1024];
+        glGetShaderInfoLog(shader_gl_id, sizeof(log), nullptr, log);
+        std::fprintf(stderr, "Failed to compile shader \"%s\"!\n%s\n", file_path, log);
+        glDeleteShader(shader_gl_id);
+        return 0;
+    }
+
+    return shader_gl_id;
+}
+
+static GLuint LoadLightingShaderProg(const char* const shader_dir) {
+    char vs_file_path[512];
+    char fs_file_path[512];
+    std::snprintf(vs_file_path, sizeof(vs_file_path), "%s/lighting.vert", shader_dir);
+    std::snprintf(fs_file_path, sizeof(fs_file_path), "%s/lighting.frag", shader_dir);
+
+    const GLuint vs_gl_id = CompileShader(vs_file_path, GL_VERTEX_SHADER);
+    const GLuint fs_gl_id = vs_gl_id ? CompileShader(fs_file_path, GL_FRAGMENT_SHADER) : 0;
+
+    if (!fs_gl_id) {
+        glDeleteShader(vs_gl_id);
+        return 0;
+    }
+
+    const GLuint prog_gl_id = glCreateProgram();
+    glAttachShader(prog_gl_id, vs_gl_id);
+    glAttachShader(prog_gl_id, fs_gl_id);
+    glLinkProgram(prog_gl_id);
+
+    glDeleteShader(vs_gl_id);
+    glDeleteShader(fs_gl_id);
+
+    GLint success;
+    glGetProgramiv(prog_gl_id, GL_LINK_STATUS, &success);
+
+    if (!success) {
+        char log[1024];
+        glGetProgramInfoLog(prog_gl_id, sizeof(log), nullptr, log);
+        std::fprintf(stderr, "Failed to link the lighting shader program!\n%s\n", log);
+        glDeleteProgram(prog_gl_id);
+        return 0;
+    }
+
+    return prog_gl_id;
+}
+
+// Submits one large light at the center of the camera, as for the player, then smaller ones scattered across the view, as for projectiles.
+static void SubmitBenchLights(s_lighting& lighting, const int light_cnt) {
+    if (light_cnt == 0) {
+        return;
+    }
+
+    SubmitLight(lighting, {i_cam_rect.width / 2.0f, i_cam_rect.height / 2.0f}, 160.0f, 1.0f);
+
+    unsigned int seed = 12345;
+
+    const auto next_rand_perc = [&seed]() {
+        seed = (seed * 1664525u) + 1013904223u;
+        return (seed >> 8) / (float)(1 << 24);
+    };
+
+    for (int i = 1; i < light_cnt; ++i) {
+        const zf4::s_vec_2d pos = {next_rand_perc() * i_cam_rect.width, next_rand_perc() * i_cam_rect.height};
+        SubmitLight(lighting, pos, 20.0f, 0.5f);
+    }
+}
+
+// Returns the time taken to light one frame in nanoseconds, waiting for the GPU to finish.
+static double TimeLitFrame(s_lighting& lighting, const GLuint prog_gl_id, const int light_cnt, const float res_scale) {
+    if (!BeginLitLevel(lighting, i_window_size, i_cam_rect, res_scale)) {
+        return -1.0;
+    }
+
+    glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    SubmitBenchLights(lighting, light_cnt);
+
+    glFinish();
+
+    const auto begin = std::chrono::steady_clock::now();
+
+    EndLitLevel(lighting, prog_gl_id, i_darkness);
+    glFinish();
+
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count();
+}
+
+static int ReadPixelRed(const int x, const int y) {
+    unsigned char pixel[4] = {};
+    glReadPixels(x, y, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, pixel);
+    return pixel[0];
+}
+
+// Checks that a single light at the center leaves the center at full brightness and the corners at the darkness level, and that a block drawn into the top left of the level lands in the top left of the screen. The camera is put off the texel grid, so that snapping is covered too.
+static bool VerifyLighting(s_lighting& lighting, const GLuint prog_gl_id, const float res_scale) {
+    const zf4::s_rect cam_rect = {i_cam_rect.x + 0.25f, i_cam_rect.y + 0.75f, i_cam_rect.width, i_cam_rect.height};
+
+    if (!BeginLitLevel(lighting, i_window_size, cam_rect, res_scale)) {
+        return false;
+    }
+
+    glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    // Clear the top left eighth of the level surface to black. Rows of the target count up from the bottom.
+    const zf4::s_vec_2d_i surface_size = lighting.level_surface_size;
+    glScissor(0, surface_size.y - (surface_size.y / 4), surface_size.x / 4, surface_size.y / 4);
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glScissor(0, 0, surface_size.x, surface_size.y);
+
+    SubmitLight(lighting, {cam_rect.x + (cam_rect.width / 2.0f), cam_rect.y + (cam_rect.height / 2.0f)}, 160.0f, 1.0f);
+    EndLitLevel(lighting, prog_gl_id, i_darkness);
+
+    const int dark_red = (int)(255.0f * (1.0f - i_darkness));
+
+    const int center_red = ReadPixelRed(i_window_size.x / 2, i_window_size.y / 2);
+    const int corner_red = ReadPixelRed(i_window_size.x - 1, 0);
+    const int block_red = ReadPixelRed(i_window_size.x / 8, i_window_size.y - (i_window_size.y / 8));
+
+    if (center_red < 250 || std::abs(corner_red - dark_red) > 2 || block_red != 0) {
+        std::fprintf(stderr, "Lighting output is wrong at a resolution of %.2f! Center red: %d (expected 255), corner red: %d (expected %d), block red: %d (expected 0)\n", res_scale, center_red, corner_red, dark_red, block_red);
+        return false;
+    }
+
+    return true;
+}
+
+static void PrintUsage(const char* const exe_name) {
+    std::fprintf(stderr, "Usage: %s [--shader-dir <dir>] [--frames <cnt>]\n", exe_name);
+}
+
+int main(const int arg_cnt, const char* const* const args) {
+    const char* shader_dir = "assets/shaders";
+    int frame_cnt = i_default_frame_cnt;
+
+    for (int i = 1; i < arg_cnt; ++i) {
+        if (std::strcmp(args[i], "--shader-dir") == 0 && i + 1 < arg_cnt) {
+            shader_dir = args[++i];
+        } else if (std::strcmp(args[i], "--frames") == 0 && i + 1 < arg_cnt) {
+            frame_cnt = std::atoi(args[++i]);
+
+            if (frame_cnt <= 0) {
+                PrintUsage(args[0]);
+                return EXIT_FAILURE;
+            }
+        } else {
+            PrintUsage(args[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (!glfwInit()) {
+        std::fprintf(stderr, "Failed to initialise GLFW!\n");
+        return EXIT_FAILURE;
+    }
+
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+    GLFWwindow* const window = glfwCreateWindow(i_window_size.x, i_window_size.y, "Lighting Benchmark", nullptr, nullptr);
+
+    if (!window) {
+        std::fprintf(stderr, "Failed to create a window with an OpenGL 4.3 context!\n");
+        glfwTerminate();
+        return EXIT_FAILURE;
+    }
+
+    glfwMakeContextCurrent(window);
+
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+        std::fprintf(stderr, "Failed to load OpenGL functions!\n");
+        glfwDestroyWindow(window);
+        glfwTerminate();
+        return EXIT_FAILURE;
+    }
+
+    std::printf("renderer: %s\n", (const char*)glGetString(GL_RENDERER));
+
+    const GLuint prog_gl_id = LoadLightingShaderProg(shader_dir);
+
+    const auto lighting = static_cast<s_lighting*>(std::calloc(1, sizeof(s_lighting)));
+
+    bool success = prog_gl_id != 0 && lighting;
+
+    if (success) {
+        InitLighting(*lighting);
+
+        success = VerifyLighting(*lighting, prog_gl_id, 1.0f) && VerifyLighting(*lighting, prog_gl_id, 0.5f);
+    }
+
+    if (success) {
+        static constexpr int i_light_cnts[] = {0, 1, 8, 64, 256, 1024};
+
+        const double pixel_cnt = (double)i_window_size.x * i_window_size.y;
+
+        std::vector<double> frame_times_ns(frame_cnt);
+
+        for (const int light_cnt : i_light_cnts) {
+            for (int i = 0; i < frame_cnt && success; ++i) {
+                frame_times_ns[i] = TimeLitFrame(*lighting, prog_gl_id, light_cnt, 1.0f);
+                success = frame_times_ns[i] >= 0.0;
+            }
+
+            if (!success) {
+                std::fprintf(stderr, "Failed to set up the offscreen target!\n");
+                break;
+            }
+
+            std::sort(frame_times_ns.begin(), frame_times_ns.end());
+
+            const double median_ns = frame_times_ns[frame_cnt / 2];
+            std::printf("lights: %4d, ms: %7.3f, ns/pixel: %.3f\n", light_cnt, median_ns / 1000000.0, median_ns / pixel_cnt);
+        }
+
+        CleanLighting(*lighting);
+    }
+
+    std::free(lighting);
+
+    if (prog_gl_id) {
+        glDeleteProgram(prog_gl_id);
+    }
+
+    glfwDestroyWindow(window);
+    glfwTerminate();
+
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
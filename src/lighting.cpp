@@ -0,0 +1,296 @@
+#include "lighting.h"
+
+struct s_light_tile_grid {
+    float tile_size;
+    zf4::s_vec_2d_i tile_cnts;
+};
+
+struct s_light_tile_range {
+    int x_begin;
+    int x_end;
+    int y_begin;
+    int y_end;
+};
+
+static s_light_tile_grid LoadLightTileGrid(const zf4::s_rect cam_rect) {
+    s_light_tile_grid grid = {i_light_tile_size};
+
+    while (true) {
+        grid.tile_cnts = {
+            zf4::Max((int)ceilf(cam_rect.width / grid.tile_size), 1),
+            zf4::Max((int)ceilf(cam_rect.height / grid.tile_size), 1)
+        };
+
+        if (grid.tile_cnts.x * grid.tile_cnts.y <= i_light_tile_limit) {
+            return grid;
+        }
+
+        grid.tile_size *= 2.0f;
+    }
+}
+
+// Gets the range of tiles overlapped by the light's bounding square.
+static s_light_tile_range LoadLightTileRange(const s_light& light, const s_light_tile_grid& grid, const zf4::s_rect cam_rect) {
+    const float left = light.pos.x - light.radius - cam_rect.x;
+    const float top = light.pos.y - light.radius - cam_rect.y;
+    const float right = light.pos.x + light.radius - cam_rect.x;
+    const float bottom = light.pos.y + light.radius - cam_rect.y;
+
+    return {
+        .x_begin = zf4::Clamp((int)floorf(left / grid.tile_size), 0, grid.tile_cnts.x),
+        .x_end = zf4::Clamp((int)ceilf(right / grid.tile_size), 0, grid.tile_cnts.x),
+        .y_begin = zf4::Clamp((int)floorf(top / grid.tile_size), 0, grid.tile_cnts.y),
+        .y_end = zf4::Clamp((int)ceilf(bottom / grid.tile_size), 0, grid.tile_cnts.y)
+    };
+}
+
+// Builds the list of lights for each tile by counting sort, returning the total number of entries. Once the entry limit is reached further entries are dropped, so lights submitted earlier take priority.
+static int BuildTileLightLists(s_lighting& lighting, const s_light_tile_grid& grid) {
+    const int tile_cnt = grid.tile_cnts.x * grid.tile_cnts.y;
+
+    // Count the entries for each tile, storing each count one tile ahead so that the prefix sum below leaves the begin indexes in place.
+    for (int i = 0; i <= tile_cnt; ++i) {
+        lighting.tile_light_begins[i] = 0;
+    }
+
+    int entry_cnt = 0;
+
+    for (int i = 0; i < lighting.lights.len && entry_cnt < i_light_tile_entry_limit; ++i) {
+        const s_light_tile_range range = LoadLightTileRange(lighting.lights[i], grid, lighting.cam_rect);
+
+        for (int y = range.y_begin; y < range.y_end && entry_cnt < i_light_tile_entry_limit; ++y) {
+            for (int x = range.x_begin; x < range.x_end && entry_cnt < i_light_tile_entry_limit; ++x) {
+                ++lighting.tile_light_begins[(y * grid.tile_cnts.x) + x + 1];
+                ++entry_cnt;
+            }
+        }
+    }
+
+    for (int i = 1; i <= tile_cnt; ++i) {
+        lighting.tile_light_begins[i] += lighting.tile_light_begins[i - 1];
+    }
+
+    // Fill in the entries using each tile's begin index as its write cursor, visiting lights in the same order as when counting so that the same entries are dropped. This leaves every cursor at the begin index of the next tile, so they are shifted back afterwards.
+    int fill_cnt = 0;
+
+    for (int i = 0; i < lighting.lights.len && fill_cnt < entry_cnt; ++i) {
+        const s_light_tile_range range = LoadLightTileRange(lighting.lights[i], grid, lighting.cam_rect);
+
+        for (int y = range.y_begin; y < range.y_end && fill_cnt < entry_cnt; ++y) {
+            for (int x = range.x_begin; x < range.x_end && fill_cnt < entry_cnt; ++x) {
+                int& cursor = lighting.tile_light_begins[(y * grid.tile_cnts.x) + x];
+                lighting.tile_light_indexes[cursor] = i;
+                ++cursor;
+                ++fill_cnt;
+            }
+        }
+    }
+
+    for (int i = tile_cnt; i > 0; --i) {
+        lighting.tile_light_begins[i] = lighting.tile_light_begins[i - 1];
+    }
+
+    lighting.tile_light_begins[0] = 0;
+
+    return entry_cnt;
+}
+
+static GLuint GenStorageBuffer(const int size) {
+    GLuint buf_gl_id;
+    glGenBuffers(1, &buf_gl_id);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, buf_gl_id);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    return buf_gl_id;
+}
+
+void InitLighting(s_lighting& lighting) {
+    assert(zf4::IsStructZero(lighting));
+
+    // The offscreen target is given storage on first use, once the window size is known.
+    glGenFramebuffers(1, &lighting.fb_gl_id);
+    glGenTextures(1, &lighting.fb_tex_gl_id);
+
+    lighting.light_buf_gl_id = GenStorageBuffer(sizeof(lighting.lights.elems_raw));
+    lighting.tile_light_begin_buf_gl_id = GenStorageBuffer(sizeof(lighting.tile_light_begins));
+    lighting.tile_light_index_buf_gl_id = GenStorageBuffer(sizeof(lighting.tile_light_indexes));
+
+    // A quad covering the screen, in clip space.
+    {
+        const float verts[] = {
+            -1.0f, -1.0f, 0.0f, 0.0f,
+            1.0f, -1.0f, 1.0f, 0.0f,
+            1.0f, 1.0f, 1.0f, 1.0f,
+            -1.0f, 1.0f, 0.0f, 1.0f
+        };
+
+        glGenVertexArrays(1, &lighting.vert_array_gl_id);
+        glBindVertexArray(lighting.vert_array_gl_id);
+
+        glGenBuffers(1, &lighting.vert_buf_gl_id);
+        glBindBuffer(GL_ARRAY_BUFFER, lighting.vert_buf_gl_id);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(verts), verts, GL_STATIC_DRAW);
+
+        const int stride = sizeof(float) * 4;
+
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, stride, (const void*)0);
+        glEnableVertexAttribArray(0);
+
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, (const void*)(sizeof(float) * 2));
+        glEnableVertexAttribArray(1);
+
+        glBindVertexArray(0);
+    }
+}
+
+void CleanLighting(s_lighting& lighting) {
+    glDeleteBuffers(1, &lighting.vert_buf_gl_id);
+    glDeleteVertexArrays(1, &lighting.vert_array_gl_id);
+    glDeleteBuffers(1, &lighting.tile_light_index_buf_gl_id);
+    glDeleteBuffers(1, &lighting.tile_light_begin_buf_gl_id);
+    glDeleteBuffers(1, &lighting.light_buf_gl_id);
+    glDeleteTextures(1, &lighting.fb_tex_gl_id);
+    glDeleteFramebuffers(1, &lighting.fb_gl_id);
+    zf4::ZeroOutStruct(lighting);
+}
+
+// Redirects drawing to the offscreen target at the given resolution in texels per level unit, which should be no more than 1, resizing the target first if the camera size has changed. Clears the lights of the last frame. Returns false if the target could not be completed.
+bool BeginLitLevel(s_lighting& lighting, const zf4::s_vec_2d_i window_size, const zf4::s_rect cam_rect, const float res_scale) {
+    assert(res_scale > 0.0f && res_scale <= 1.0f);
+
+    // NOTE: A texel is added on each axis since a snapped region can overhang the camera rect by up to one texel.
+    const zf4::s_vec_2d_i fb_size = {(int)ceilf(cam_rect.width) + 1, (int)ceilf(cam_rect.height) + 1};
+
+    if (lighting.fb_size.x != fb_size.x || lighting.fb_size.y != fb_size.y) {
+        glBindTexture(GL_TEXTURE_2D, lighting.fb_tex_gl_id);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, fb_size.x, fb_size.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, lighting.fb_gl_id);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, lighting.fb_tex_gl_id, 0);
+
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            return false;
+        }
+
+        lighting.fb_size = fb_size;
+    } else {
+        glBindFramebuffer(GL_FRAMEBUFFER, lighting.fb_gl_id);
+    }
+
+    // Snap the region to the texel grid of the level.
+    const int texel_left = (int)floorf(cam_rect.x * res_scale);
+    const int texel_top = (int)floorf(cam_rect.y * res_scale);
+    const int texel_right = (int)ceilf(RectRight(cam_rect) * res_scale);
+    const int texel_bottom = (int)ceilf(RectBottom(cam_rect) * res_scale);
+
+    lighting.level_surface_size = {zf4::Min(texel_right - texel_left, fb_size.x), zf4::Min(texel_bottom - texel_top, fb_size.y)};
+    lighting.level_surface_origin = {texel_left / res_scale, texel_top / res_scale};
+    lighting.res_scale = res_scale;
+
+    // The scissor keeps clears to the region too, so that they shrink with the resolution.
+    glViewport(0, 0, lighting.level_surface_size.x, lighting.level_surface_size.y);
+    glScissor(0, 0, lighting.level_surface_size.x, lighting.level_surface_size.y);
+    glEnable(GL_SCISSOR_TEST);
+
+    lighting.window_size = window_size;
+    lighting.cam_rect = cam_rect;
+    lighting.lights.len = 0;
+
+    return true;
+}
+
+// Adds a light for the current frame if any of it falls within the camera rect. Returns false only if the light limit has been reached.
+bool SubmitLight(s_lighting& lighting, const zf4::s_vec_2d pos, const float radius, const float intensity) {
+    assert(radius > 0.0f);
+
+    // Test the distance to the nearest point of the camera rect against the radius.
+    const zf4::s_rect cam_rect = lighting.cam_rect;
+    const float dist_x = pos.x - zf4::Clamp(pos.x, cam_rect.x, RectRight(cam_rect));
+    const float dist_y = pos.y - zf4::Clamp(pos.y, cam_rect.y, RectBottom(cam_rect));
+
+    if ((dist_x * dist_x) + (dist_y * dist_y) >= radius * radius) {
+        return true;
+    }
+
+    if (lighting.lights.len == i_light_limit) {
+        return false;
+    }
+
+    lighting.lights[lighting.lights.len] = {pos, radius, intensity};
+    ++lighting.lights.len;
+
+    return true;
+}
+
+static void LoadLightingProgUniforms(s_lighting_prog_uniforms& uniforms, const GLuint prog_gl_id) {
+    uniforms.prog_gl_id = prog_gl_id;
+    uniforms.cam_topleft = glGetUniformLocation(prog_gl_id, "u_cam_topleft");
+    uniforms.cam_size = glGetUniformLocation(prog_gl_id, "u_cam_size");
+    uniforms.darkness = glGetUniformLocation(prog_gl_id, "u_darkness");
+    uniforms.light_tile_size = glGetUniformLocation(prog_gl_id, "u_light_tile_size");
+    uniforms.light_tile_cnts = glGetUniformLocation(prog_gl_id, "u_light_tile_cnts");
+    uniforms.level_surface_origin = glGetUniformLocation(prog_gl_id, "u_level_surface_origin");
+    uniforms.level_surface_height = glGetUniformLocation(prog_gl_id, "u_level_surface_height");
+    uniforms.res_scale = glGetUniformLocation(prog_gl_id, "u_res_scale");
+    uniforms.tex = glGetUniformLocation(prog_gl_id, "u_tex");
+}
+
+// Draws the level from the offscreen target to the screen, lit by the lights submitted since the level was begun, and returns the number of lights drawn. Anything batched for the level must be flushed before this.
+int EndLitLevel(s_lighting& lighting, const GLuint prog_gl_id, const float darkness) {
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDisable(GL_SCISSOR_TEST);
+    glViewport(0, 0, lighting.window_size.x, lighting.window_size.y);
+
+    const s_light_tile_grid grid = LoadLightTileGrid(lighting.cam_rect);
+    const int tile_cnt = grid.tile_cnts.x * grid.tile_cnts.y;
+    const int entry_cnt = BuildTileLightLists(lighting, grid);
+
+    if (lighting.lights.len > 0) {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, lighting.light_buf_gl_id);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(s_light) * lighting.lights.len, lighting.lights.elems_raw);
+    }
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, lighting.tile_light_begin_buf_gl_id);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(int) * (tile_cnt + 1), lighting.tile_light_begins.elems_raw);
+
+    if (entry_cnt > 0) {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, lighting.tile_light_index_buf_gl_id);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(int) * entry_cnt, lighting.tile_light_indexes.elems_raw);
+    }
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, lighting.light_buf_gl_id);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, lighting.tile_light_begin_buf_gl_id);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, lighting.tile_light_index_buf_gl_id);
+
+    s_lighting_prog_uniforms& uniforms = lighting.prog_uniforms;
+
+    if (uniforms.prog_gl_id != prog_gl_id) {
+        LoadLightingProgUniforms(uniforms, prog_gl_id);
+    }
+
+    glUseProgram(prog_gl_id);
+    glUniform2f(uniforms.cam_topleft, lighting.cam_rect.x, lighting.cam_rect.y);
+    glUniform2f(uniforms.cam_size, lighting.cam_rect.width, lighting.cam_rect.height);
+    glUniform1f(uniforms.darkness, darkness);
+    glUniform1f(uniforms.light_tile_size, grid.tile_size);
+    glUniform2i(uniforms.light_tile_cnts, grid.tile_cnts.x, grid.tile_cnts.y);
+    glUniform2f(uniforms.level_surface_origin, lighting.level_surface_origin.x, lighting.level_surface_origin.y);
+    glUniform1f(uniforms.level_surface_height, (float)lighting.level_surface_size.y);
+    glUniform1f(uniforms.res_scale, lighting.res_scale);
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, lighting.fb_tex_gl_id);
+    glUniform1i(uniforms.tex, 0);
+
+    glBindVertexArray(lighting.vert_array_gl_id);
+    glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+    glBindVertexArray(0);
+
+    return lighting.lights.len;
+}
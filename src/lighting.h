@@ -0,0 +1,85 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <zf4.h>
+
+static constexpr int i_light_limit = 1024;
+
+static constexpr float i_light_tile_size = 32.0f; // In level units. Doubled as needed to stay within the tile limit on large windows.
+static constexpr int i_light_tile_limit = 4096;
+static constexpr int i_light_tile_entry_limit = i_light_limit * 16;
+
+// NOTE: This is laid out to match the light struct in "lighting.frag" under std430, so that lists of them can be uploaded as they are.
+struct s_light {
+    zf4::s_vec_2d pos;
+    float radius;
+    float intensity;
+};
+
+static_assert(sizeof(s_light) == 16, "s_light must match the std430 layout of the shader's light struct!");
+
+// The uniform locations of the lighting program, so that they are not looked up on every draw.
+struct s_lighting_prog_uniforms {
+    GLuint prog_gl_id; // The program these were looked up in, or 0 if none has been drawn with yet.
+
+    GLint cam_topleft;
+    GLint cam_size;
+    GLint darkness;
+    GLint light_tile_size;
+    GLint light_tile_cnts;
+    GLint level_surface_origin;
+    GLint level_surface_height;
+    GLint res_scale;
+    GLint tex;
+};
+
+// Draws the level into an offscreen target, then draws that to the screen in one pass which darkens everything outside of the lights.
+// The target is drawn into at one texel per level unit or fewer, rather than at window resolution, and is scaled up with nearest-neighbour sampling by the lighting pass. The region drawn into is snapped to whole texels of the level, so the camera can move by less than a texel without the level shimmering.
+// The camera rect is split into tiles, and each tile is given the list of lights that reach it, so a pixel only evaluates the few lights near it however many there are overall.
+struct s_lighting {
+    GLuint fb_gl_id;
+    GLuint fb_tex_gl_id;
+    zf4::s_vec_2d_i fb_size; // Enough for the camera rect at full resolution, so that lowering the resolution never needs reallocating.
+
+    // The region of the target the level is being drawn into, which starts at its bottom left.
+    zf4::s_vec_2d_i level_surface_size;
+    zf4::s_vec_2d level_surface_origin; // The level position at the top left of the region.
+    float res_scale; // Texels per level unit.
+
+    zf4::s_vec_2d_i window_size;
+
+    GLuint light_buf_gl_id;
+    GLuint tile_light_begin_buf_gl_id;
+    GLuint tile_light_index_buf_gl_id;
+
+    GLuint vert_array_gl_id;
+    GLuint vert_buf_gl_id;
+
+    s_lighting_prog_uniforms prog_uniforms;
+
+    zf4::s_rect cam_rect;
+
+    // NOTE: Staging memory for the current frame's lights and tile lists, kept here so that building them does not need to allocate.
+    zf4::s_static_list<s_light, i_light_limit> lights;
+    zf4::s_static_array<int, i_light_tile_limit + 1> tile_light_begins;
+    zf4::s_static_array<int, i_light_tile_entry_limit> tile_light_indexes;
+};
+
+void InitLighting(s_lighting& lighting);
+void CleanLighting(s_lighting& lighting);
+bool BeginLitLevel(s_lighting& lighting, const zf4::s_vec_2d_i window_size, const zf4::s_rect cam_rect, const float res_scale);
+bool SubmitLight(s_lighting& lighting, const zf4::s_vec_2d pos, const float radius, const float intensity);
+int EndLitLevel(s_lighting& lighting, const GLuint prog_gl_id, const float darkness);
+
+// Gives the view matrix to draw the level with between beginning and ending it. Anything drawn should be projected to the level surface size rather than the window size.
+static inline zf4::s_matrix_4x4 LoadLitLevelViewMatrix4x4(const s_lighting& lighting) {
+    zf4::s_matrix_4x4 mat = {};
+
+    mat.elems[0][0] = lighting.res_scale;
+    mat.elems[1][1] = lighting.res_scale;
+    mat.elems[3][3] = 1.0f;
+    mat.elems[3][0] = -lighting.level_surface_origin.x * lighting.res_scale;
+    mat.elems[3][1] = -lighting.level_surface_origin.y * lighting.res_scale;
+
+    return mat;
+}
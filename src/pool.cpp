@@ -0,0 +1,76 @@
+#include "pool.h"
+
+bool ReserveHandleTable(s_handle_table& table, const int cap) {
+    if (cap <= table.cap) {
+        return true;
+    }
+
+    if (!ResizePoolArray(table.slot_indexes, cap)
+        || !ResizePoolArray(table.slot_gens, cap)
+        || !ResizePoolArray(table.index_slots, cap)) {
+        return false;
+    }
+
+    if (table.cap == 0) {
+        table.free_slot = -1;
+    }
+
+    table.cap = cap;
+
+    return true;
+}
+
+void CleanHandleTable(s_handle_table& table) {
+    std::free(table.slot_indexes);
+    std::free(table.slot_gens);
+    std::free(table.index_slots);
+    zf4::ZeroOutStruct(table);
+}
+
+// Registers the entity just added at the given index. The table must already have room for it.
+s_entity_handle AddHandle(s_handle_table& table, const int index) {
+    assert(index >= 0 && index < table.cap);
+
+    int slot;
+
+    if (table.free_slot != -1) {
+        slot = table.free_slot;
+        table.free_slot = table.slot_indexes[slot];
+    } else {
+        assert(table.slot_cnt < table.cap);
+        slot = table.slot_cnt;
+        table.slot_gens[slot] = 0;
+        ++table.slot_cnt;
+    }
+
+    table.slot_indexes[slot] = index;
+    table.index_slots[index] = slot;
+
+    return {slot, table.slot_gens[slot]};
+}
+
+// Frees the slot of the entity at "index", and repoints the slot of the entity at "end_index" which is being swapped into its place.
+void RemoveHandle(s_handle_table& table, const int index, const int end_index) {
+    assert(index >= 0 && index <= end_index && end_index < table.cap);
+
+    const int slot = table.index_slots[index];
+
+    ++table.slot_gens[slot];
+    table.slot_indexes[slot] = table.free_slot;
+    table.free_slot = slot;
+
+    if (index != end_index) {
+        const int end_slot = table.index_slots[end_index];
+        table.slot_indexes[end_slot] = index;
+        table.index_slots[index] = end_slot;
+    }
+}
+
+// Returns the current pool index of the entity, or -1 if the handle is stale.
+int HandleIndex(const s_handle_table& table, const s_entity_handle handle) {
+    if (handle.slot < 0 || handle.slot >= table.slot_cnt || table.slot_gens[handle.slot] != handle.gen) {
+        return -1;
+    }
+
+    return table.slot_indexes[handle.slot];
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <climits>
+#include <cstdlib>
+#include <zf4.h>
+
+// A reference to an entity in a pool. It stays valid while the entity is moved around by swap-removals, and is detected as stale once the entity itself is removed.
+struct s_entity_handle {
+    int slot;
+    int gen;
+};
+
+static constexpr s_entity_handle i_null_entity_handle = {-1, 0};
+
+// Maps handles to the current indexes of entities in a densely packed pool.
+struct s_handle_table {
+    int* slot_indexes; // The pool index for each slot in use, or the next free slot (-1 if none) for each slot not in use.
+    int* slot_gens; // Incremented each time a slot is freed, invalidating its old handles.
+    int* index_slots; // The slot for each pool index.
+
+    int slot_cnt;
+    int cap;
+
+    int free_slot; // -1 if there are no free slots below "slot_cnt".
+};
+
+// Resizes a heap array. On failure the array is left as it was.
+template<typename T>
+static bool ResizePoolArray(T*& arr, const int cap) {
+    assert(cap > 0);
+
+    T* const new_arr = static_cast<T*>(std::realloc(arr, sizeof(T) * cap));
+
+    if (!new_arr) {
+        return false;
+    }
+
+    arr = new_arr;
+    return true;
+}
+
+// Returns the capacity to grow a pool of capacity "cap" to so that at least "min_cap" elements fit. The capacity is at least doubled, so that growing one element at a time copies each element only a constant number of times on average, and is rounded up to whole chunks.
+static inline int CalcPoolCap(const int cap, const int min_cap, const int chunk_size) {
+    assert(cap >= 0 && min_cap >= 0);
+    assert(chunk_size > 0);
+
+    const int64_t target_cap = zf4::Max((int64_t)min_cap, (int64_t)cap * 2);
+    return (int)zf4::Min(((target_cap + chunk_size - 1) / chunk_size) * chunk_size, (int64_t)INT_MAX); // Clamped for pools near the limit of an int, which still leaves room for "min_cap".
+}
+
+bool ReserveHandleTable(s_handle_table& table, const int cap);
+void CleanHandleTable(s_handle_table& table);
+s_entity_handle AddHandle(s_handle_table& table, const int index);
+void RemoveHandle(s_handle_table& table, const int index, const int end_index);
+int HandleIndex(const s_handle_table& table, const s_entity_handle handle);
@@ -0,0 +1,120 @@
+#include "profiler.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <atomic>
+#include <chrono>
+
+// Each slot carries a sequence number, set to 0 while being written and to one more than the event's position in the overall stream once done. A reader copies the event out and keeps it only if the sequence number was the expected one both before and after.
+struct s_profile_event_slot {
+    std::atomic<uint64_t> seq;
+    s_profile_event event;
+};
+
+struct s_profile_event_ring {
+    s_profile_event_slot slots[i_profile_event_buf_len];
+    std::atomic<uint64_t> write_cnt;
+};
+
+static s_profile_event_ring g_profile_event_ring;
+
+static thread_local int g_profile_thread_index;
+
+int64_t ProfileTimestamp() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void SetProfileThreadIndex(const int index) {
+    assert(index >= 0);
+    g_profile_thread_index = index;
+}
+
+void RecordProfileEvent(const e_profile_zone zone, const int64_t begin_ns, const int64_t end_ns) {
+    const uint64_t pos = g_profile_event_ring.write_cnt.fetch_add(1, std::memory_order_relaxed);
+    s_profile_event_slot& slot = g_profile_event_ring.slots[pos & (i_profile_event_buf_len - 1)];
+
+    slot.seq.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    slot.event = {
+        .begin_ns = begin_ns,
+        .end_ns = end_ns,
+        .zone = zone,
+        .thread_index = g_profile_thread_index
+    };
+
+    slot.seq.store(pos + 1, std::memory_order_release);
+}
+
+// Copies up to "cap" of the most recent events, oldest first, and returns how many were copied. Events being written at the time are skipped.
+int LoadRecentProfileEvents(s_profile_event* const events, const int cap) {
+    assert(cap >= 0);
+
+    const uint64_t write_cnt = g_profile_event_ring.write_cnt.load(std::memory_order_acquire);
+    const uint64_t read_cnt = zf4::Min(write_cnt, (uint64_t)zf4::Min(cap, i_profile_event_buf_len));
+
+    int event_cnt = 0;
+
+    for (uint64_t pos = write_cnt - read_cnt; pos < write_cnt; ++pos) {
+        const s_profile_event_slot& slot = g_profile_event_ring.slots[pos & (i_profile_event_buf_len - 1)];
+
+        if (slot.seq.load(std::memory_order_acquire) != pos + 1) {
+            continue;
+        }
+
+        events[event_cnt] = slot.event;
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        if (slot.seq.load(std::memory_order_relaxed) != pos + 1) {
+            continue;
+        }
+
+        ++event_cnt;
+    }
+
+    return event_cnt;
+}
+
+// Writes the recent events in the Chrome trace event format, for loading into chrome://tracing or Perfetto.
+bool WriteChromeTrace(const char* const file_path) {
+    const auto events = static_cast<s_profile_event*>(std::malloc(sizeof(s_profile_event) * i_profile_event_buf_len));
+
+    if (!events) {
+        return false;
+    }
+
+    const int event_cnt = LoadRecentProfileEvents(events, i_profile_event_buf_len);
+
+    FILE* const fs = std::fopen(file_path, "w");
+
+    if (!fs) {
+        std::fprintf(stderr, "Failed to open \"%s\" for writing the trace!\n", file_path);
+        std::free(events);
+        return false;
+    }
+
+    // Events are stored in the order they ended, so the earliest beginning has to be searched for.
+    int64_t base_ns = event_cnt > 0 ? events[0].begin_ns : 0;
+
+    for (int i = 1; i < event_cnt; ++i) {
+        base_ns = zf4::Min(base_ns, events[i].begin_ns);
+    }
+
+    std::fprintf(fs, "{\"traceEvents\":[\n");
+
+    for (int i = 0; i < event_cnt; ++i) {
+        const s_profile_event& event = events[i];
+
+        std::fprintf(fs, "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}%s\n",
+            i_profile_zone_names[event.zone], event.thread_index,
+            (event.begin_ns - base_ns) / 1000.0, (event.end_ns - event.begin_ns) / 1000.0,
+            i < event_cnt - 1 ? "," : "");
+    }
+
+    std::fprintf(fs, "],\"displayTimeUnit\":\"ms\"}\n");
+
+    std::free(events);
+
+    return std::fclose(fs) == 0;
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstdint>
+#include <zf4.h>
+
+// NOTE: Timings are recorded into a single process-wide ring buffer which any thread can write to without locking. Once full, the oldest events are overwritten, so the buffer always holds the most recent stretch of ticks and frames.
+
+enum e_profile_zone {
+    ek_profile_zone_tick,
+    ek_profile_zone_rule_updating,
+    ek_profile_zone_player_movement,
+    ek_profile_zone_enemy_pathfinding,
+    ek_profile_zone_enemy_movement,
+    ek_profile_zone_projectile_movement,
+    ek_profile_zone_player_shooting,
+    ek_profile_zone_enemy_spawning,
+    ek_profile_zone_enemy_type_ticks,
+    ek_profile_zone_collision_processing,
+    ek_profile_zone_player_death,
+    ek_profile_zone_enemy_deaths,
+    ek_profile_zone_camera,
+    ek_profile_zone_tile_streaming,
+
+    ek_profile_zone_job_range,
+
+    ek_profile_zone_draw,
+    ek_profile_zone_draw_level,
+    ek_profile_zone_draw_ui,
+
+    eks_profile_zone_cnt
+};
+
+static constexpr zf4::s_static_array<const char*, eks_profile_zone_cnt> i_profile_zone_names = {
+    "Tick",
+    "Rule Updating",
+    "Player Movement",
+    "Enemy Pathfinding",
+    "Enemy Movement",
+    "Projectile Movement",
+    "Player Shooting",
+    "Enemy Spawning",
+    "Enemy Type Ticks",
+    "Collision Processing",
+    "Player Death",
+    "Enemy Deaths",
+    "Camera",
+    "Tile Streaming",
+    "Job Range",
+    "Draw",
+    "Draw Level",
+    "Draw UI"
+};
+
+constexpr int i_profile_event_buf_len = 1 << 16;
+
+static_assert((i_profile_event_buf_len & (i_profile_event_buf_len - 1)) == 0, "The profile event buffer length must be a power of two!");
+
+struct s_profile_event {
+    int64_t begin_ns;
+    int64_t end_ns;
+    e_profile_zone zone;
+    int thread_index; // 0 for the main thread, and one more than the worker index for job system workers.
+};
+
+int64_t ProfileTimestamp();
+void SetProfileThreadIndex(const int index);
+void RecordProfileEvent(const e_profile_zone zone, const int64_t begin_ns, const int64_t end_ns);
+int LoadRecentProfileEvents(s_profile_event* const events, const int cap);
+bool WriteChromeTrace(const char* const file_path);
+
+// Times from construction to destruction. A single scope can also be moved along a sequence of zones, which suits functions split into consecutive phases.
+struct s_profile_scope {
+    e_profile_zone zone;
+    int64_t begin_ns;
+
+    s_profile_scope(const e_profile_zone zone) : zone(zone), begin_ns(ProfileTimestamp()) {
+    }
+
+    ~s_profile_scope() {
+        RecordProfileEvent(zone, begin_ns, ProfileTimestamp());
+    }
+
+    s_profile_scope(const s_profile_scope&) = delete;
+    s_profile_scope& operator=(const s_profile_scope&) = delete;
+};
+
+// Ends the scope's current zone and begins the given one.
+static inline void SwitchProfileScope(s_profile_scope& scope, const e_profile_zone zone) {
+    const int64_t now_ns = ProfileTimestamp();
+    RecordProfileEvent(scope.zone, scope.begin_ns, now_ns);
+
+    scope.zone = zone;
+    scope.begin_ns = now_ns;
+}
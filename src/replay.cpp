@@ -0,0 +1,187 @@
+#include "replay.h"
+
+#include <cstdlib>
+
+// NOTE: Values are written in host byte order. Replays are for regression testing on the machine or platform that recorded them, not for distribution.
+
+template<typename T>
+static bool WriteVal(FILE* const fs, const T& val) {
+    return std::fwrite(&val, sizeof(val), 1, fs) == 1;
+}
+
+template<typename T>
+static bool ReadVal(FILE* const fs, T& val) {
+    return std::fread(&val, sizeof(val), 1, fs) == 1;
+}
+
+bool BeginInputRecording(s_input_recorder& recorder, const char* const file_path, const uint64_t seed, const zf4::s_vec_2d_i window_size) {
+    assert(zf4::IsStructZero(recorder));
+
+    recorder.fs = std::fopen(file_path, "wb");
+
+    if (!recorder.fs) {
+        std::fprintf(stderr, "Failed to open \"%s\" for input recording!\n", file_path);
+        return false;
+    }
+
+    recorder.window_size = window_size;
+
+    if (!WriteVal(recorder.fs, i_replay_magic)
+        || !WriteVal(recorder.fs, i_replay_version)
+        || !WriteVal(recorder.fs, seed)
+        || !WriteVal(recorder.fs, (int32_t)window_size.x)
+        || !WriteVal(recorder.fs, (int32_t)window_size.y)) {
+        std::fclose(recorder.fs);
+        zf4::ZeroOutStruct(recorder);
+        return false;
+    }
+
+    return true;
+}
+
+bool RecordTickInput(s_input_recorder& recorder, const s_tick_input& input) {
+    assert(recorder.fs);
+    assert((input.flags & ~eks_tick_input_flags_mask) == 0);
+
+    const bool window_size_changed = input.window_size.x != recorder.window_size.x || input.window_size.y != recorder.window_size.y;
+
+    zf4::a_byte flags_byte = (zf4::a_byte)input.flags;
+
+    if (window_size_changed) {
+        flags_byte |= i_replay_window_size_change_bit;
+    }
+
+    if (!WriteVal(recorder.fs, flags_byte)
+        || !WriteVal(recorder.fs, input.mouse_pos.x)
+        || !WriteVal(recorder.fs, input.mouse_pos.y)) {
+        return false;
+    }
+
+    if (window_size_changed) {
+        if (!WriteVal(recorder.fs, (int32_t)input.window_size.x) || !WriteVal(recorder.fs, (int32_t)input.window_size.y)) {
+            return false;
+        }
+
+        recorder.window_size = input.window_size;
+    }
+
+    ++recorder.tick_cnt;
+
+    return true;
+}
+
+bool EndInputRecording(s_input_recorder& recorder, const uint64_t final_state_hash) {
+    assert(recorder.fs);
+
+    const bool success = WriteVal(recorder.fs, i_replay_trailer_byte)
+        && WriteVal(recorder.fs, (uint32_t)recorder.tick_cnt)
+        && WriteVal(recorder.fs, final_state_hash);
+
+    const bool closed = std::fclose(recorder.fs) == 0;
+
+    zf4::ZeroOutStruct(recorder);
+
+    return success && closed;
+}
+
+static bool ReadReplayTicks(s_input_replay& replay, FILE* const fs, zf4::s_vec_2d_i window_size) {
+    int input_cap = 0;
+
+    while (true) {
+        zf4::a_byte flags_byte;
+
+        if (!ReadVal(fs, flags_byte)) {
+            std::fprintf(stderr, "Replay ended without a trailer!\n");
+            return false;
+        }
+
+        if (flags_byte == i_replay_trailer_byte) {
+            break;
+        }
+
+        if (replay.tick_cnt == input_cap) {
+            input_cap = input_cap > 0 ? input_cap * 2 : 1024;
+
+            const auto new_inputs = static_cast<s_tick_input*>(std::realloc(replay.inputs, sizeof(*replay.inputs) * input_cap));
+
+            if (!new_inputs) {
+                return false;
+            }
+
+            replay.inputs = new_inputs;
+        }
+
+        s_tick_input& input = replay.inputs[replay.tick_cnt];
+        input.flags = (e_tick_input_flags)(flags_byte & eks_tick_input_flags_mask);
+
+        if (!ReadVal(fs, input.mouse_pos.x) || !ReadVal(fs, input.mouse_pos.y)) {
+            return false;
+        }
+
+        if (flags_byte & i_replay_window_size_change_bit) {
+            int32_t width, height;
+
+            if (!ReadVal(fs, width) || !ReadVal(fs, height)) {
+                return false;
+            }
+
+            window_size = {width, height};
+        }
+
+        input.window_size = window_size;
+
+        ++replay.tick_cnt;
+    }
+
+    uint32_t tick_cnt;
+
+    if (!ReadVal(fs, tick_cnt) || !ReadVal(fs, replay.final_state_hash)) {
+        return false;
+    }
+
+    if ((int)tick_cnt != replay.tick_cnt) {
+        std::fprintf(stderr, "Replay tick count mismatch! Trailer says %u, but %d were read.\n", tick_cnt, replay.tick_cnt);
+        return false;
+    }
+
+    return true;
+}
+
+bool LoadInputReplay(s_input_replay& replay, const char* const file_path) {
+    assert(zf4::IsStructZero(replay));
+
+    FILE* const fs = std::fopen(file_path, "rb");
+
+    if (!fs) {
+        std::fprintf(stderr, "Failed to open replay \"%s\"!\n", file_path);
+        return false;
+    }
+
+    uint32_t magic, version;
+    int32_t window_width, window_height;
+
+    if (!ReadVal(fs, magic) || magic != i_replay_magic
+        || !ReadVal(fs, version) || version != i_replay_version
+        || !ReadVal(fs, replay.seed)
+        || !ReadVal(fs, window_width) || !ReadVal(fs, window_height)) {
+        std::fprintf(stderr, "\"%s\" is not a valid replay, or was made with a different version!\n", file_path);
+        std::fclose(fs);
+        return false;
+    }
+
+    if (!ReadReplayTicks(replay, fs, {window_width, window_height})) {
+        std::fprintf(stderr, "Failed to read replay \"%s\"!\n", file_path);
+        std::fclose(fs);
+        CleanInputReplay(replay);
+        return false;
+    }
+
+    std::fclose(fs);
+
+    return true;
+}
+
+void CleanInputReplay(s_input_replay& replay) {
+    std::free(replay.inputs);
+    zf4::ZeroOutStruct(replay);
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdio>
+#include "game.h"
+
+// NOTE: A replay file is a header holding the RNG seed and starting window size, one record per tick, then a trailer holding the tick count and the hash of the final game state.
+// Each tick record is a byte of input flags followed by the mouse position. The top flag bit marks that the window size changed and that the new size follows.
+
+constexpr uint32_t i_replay_magic = 0x50524347; // "GCRP" read as little-endian.
+constexpr uint32_t i_replay_version = 1;
+
+constexpr zf4::a_byte i_replay_window_size_change_bit = 1 << 7;
+constexpr zf4::a_byte i_replay_trailer_byte = 0xFF;
+
+static_assert((eks_tick_input_flags_mask & i_replay_window_size_change_bit) == 0, "Tick input flags must leave room for the window size change bit!");
+
+struct s_input_recorder {
+    FILE* fs;
+    int tick_cnt;
+    zf4::s_vec_2d_i window_size;
+};
+
+struct s_input_replay {
+    uint64_t seed;
+    s_tick_input* inputs;
+    int tick_cnt;
+    uint64_t final_state_hash;
+};
+
+bool BeginInputRecording(s_input_recorder& recorder, const char* const file_path, const uint64_t seed, const zf4::s_vec_2d_i window_size);
+bool RecordTickInput(s_input_recorder& recorder, const s_tick_input& input);
+bool EndInputRecording(s_input_recorder& recorder, const uint64_t final_state_hash);
+
+bool LoadInputReplay(s_input_replay& replay, const char* const file_path);
+void CleanInputReplay(s_input_replay& replay);
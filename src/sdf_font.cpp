@@ -0,0 +1,208 @@
+#include "sdf_font.h"
+
+#include <cmath>
+#include <cstdlib>
+
+static constexpr float i_sdf_font_dist_inf = 1e20f;
+
+// Scratch memory for the distance transform of one padded glyph.
+struct s_sdf_font_scratch {
+    float* inside_dists; // Squared distance of each pixel to the nearest inside pixel.
+    float* outside_dists; // Squared distance of each pixel to the nearest outside pixel.
+
+    // For the 1D passes.
+    float* line_vals;
+    int* hull_xs;
+    float* hull_bounds;
+};
+
+// Replaces each value along a row or column with the squared distance to the nearest seed, where seeds hold 0 and everything else infinity. This is the lower envelope method of Felzenszwalb and Huttenlocher, and is linear in the length.
+static void TransformDistsOfLine(float* const vals, const int len, const int stride, s_sdf_font_scratch& scratch) {
+    for (int i = 0; i < len; ++i) {
+        scratch.line_vals[i] = vals[i * stride];
+    }
+
+    int k = 0;
+    scratch.hull_xs[0] = 0;
+    scratch.hull_bounds[0] = -i_sdf_font_dist_inf;
+    scratch.hull_bounds[1] = i_sdf_font_dist_inf;
+
+    for (int q = 1; q < len; ++q) {
+        float s;
+
+        while (true) {
+            const int v = scratch.hull_xs[k];
+            s = ((scratch.line_vals[q] + q * q) - (scratch.line_vals[v] + v * v)) / (2 * q - 2 * v);
+
+            if (s > scratch.hull_bounds[k]) {
+                break;
+            }
+
+            --k;
+        }
+
+        ++k;
+        scratch.hull_xs[k] = q;
+        scratch.hull_bounds[k] = s;
+        scratch.hull_bounds[k + 1] = i_sdf_font_dist_inf;
+    }
+
+    k = 0;
+
+    for (int q = 0; q < len; ++q) {
+        while (scratch.hull_bounds[k + 1] < q) {
+            ++k;
+        }
+
+        const int v = scratch.hull_xs[k];
+        vals[q * stride] = (q - v) * (q - v) + scratch.line_vals[v];
+    }
+}
+
+static void TransformDists(float* const dists, const zf4::s_vec_2d_i size, s_sdf_font_scratch& scratch) {
+    for (int x = 0; x < size.x; ++x) {
+        TransformDistsOfLine(dists + x, size.y, size.x, scratch);
+    }
+
+    for (int y = 0; y < size.y; ++y) {
+        TransformDistsOfLine(dists + (y * size.x), size.x, 1, scratch);
+    }
+}
+
+// Writes the distance field of the glyph in the source atlas rectangle into the destination atlas, with the padding around it.
+static void WriteGlyphDistField(unsigned char* const dest_px_data, const zf4::s_rect_i dest_rect, const unsigned char* const src_px_data, const int src_tex_width, const zf4::s_rect_i src_rect, s_sdf_font_scratch& scratch) {
+    const zf4::s_vec_2d_i size = {dest_rect.width, dest_rect.height};
+
+    for (int y = 0; y < size.y; ++y) {
+        for (int x = 0; x < size.x; ++x) {
+            const int src_x = x - i_sdf_font_spread;
+            const int src_y = y - i_sdf_font_spread;
+
+            bool inside = false;
+
+            if (src_x >= 0 && src_x < src_rect.width && src_y >= 0 && src_y < src_rect.height) {
+                // NOTE: The coverage is taken as the lesser of the red and alpha channels so that this works whether the atlas is white with coverage in alpha or coverage in red with opaque alpha.
+                const unsigned char* const src_px = src_px_data + (((src_rect.y + src_y) * src_tex_width) + src_rect.x + src_x) * 4;
+                inside = zf4::Min(src_px[0], src_px[3]) >= 128;
+            }
+
+            const int i = (y * size.x) + x;
+            scratch.inside_dists[i] = inside ? 0.0f : i_sdf_font_dist_inf;
+            scratch.outside_dists[i] = inside ? i_sdf_font_dist_inf : 0.0f;
+        }
+    }
+
+    TransformDists(scratch.inside_dists, size, scratch);
+    TransformDists(scratch.outside_dists, size, scratch);
+
+    for (int y = 0; y < size.y; ++y) {
+        for (int x = 0; x < size.x; ++x) {
+            const int i = (y * size.x) + x;
+
+            // Distances are between pixel centres, so half a pixel is taken off to get the distance to the edge between inside and outside. Positive is outside.
+            const float dist = scratch.inside_dists[i] > 0.0f ? std::sqrt(scratch.inside_dists[i]) - 0.5f : -(std::sqrt(scratch.outside_dists[i]) - 0.5f);
+
+            const float val = zf4::Clamp(0.5f - (dist / (2.0f * i_sdf_font_spread)), 0.0f, 1.0f);
+            dest_px_data[((dest_rect.y + y) * i_sdf_font_atlas_width) + dest_rect.x + x] = (unsigned char)std::lround(val * 255.0f);
+        }
+    }
+}
+
+// Builds the atlas from the given packed font, which should be rasterised large since the field cannot recover detail lost at the source size.
+bool InitSDFFont(s_sdf_font& font, const zf4::s_fonts& fonts, const int src_font_index, const float src_pt_size) {
+    assert(zf4::IsStructZero(font));
+
+    const zf4::s_font_arrangement_info& src_arrangement_info = fonts.arrangement_infos[src_font_index];
+    const zf4::s_vec_2d_i src_tex_size = fonts.tex_sizes[src_font_index];
+
+    font.src_pt_size = src_pt_size;
+    font.line_height = src_arrangement_info.line_height;
+
+    // Arrange the padded glyphs in rows.
+    zf4::s_vec_2d_i max_glyph_size = {};
+
+    {
+        zf4::s_vec_2d_i pen = {};
+        int row_height = 0;
+
+        for (int i = 0; i < zf4::g_font_chr_range_len; ++i) {
+            const zf4::s_rect_i src_rect = src_arrangement_info.chr_src_rects[i];
+            const zf4::s_vec_2d_i size = {src_rect.width + (i_sdf_font_spread * 2), src_rect.height + (i_sdf_font_spread * 2)};
+
+            assert(size.x <= i_sdf_font_atlas_width);
+
+            if (pen.x + size.x > i_sdf_font_atlas_width) {
+                pen.x = 0;
+                pen.y += row_height;
+                row_height = 0;
+            }
+
+            font.chr_src_rects[i] = {pen.x, pen.y, size.x, size.y};
+            font.chr_hor_offsets[i] = src_arrangement_info.chr_hor_offsets[i] - i_sdf_font_spread;
+            font.chr_ver_offsets[i] = src_arrangement_info.chr_ver_offsets[i] - i_sdf_font_spread;
+            font.chr_hor_advances[i] = src_arrangement_info.chr_hor_advances[i];
+
+            pen.x += size.x;
+            row_height = zf4::Max(row_height, size.y);
+
+            max_glyph_size.x = zf4::Max(max_glyph_size.x, size.x);
+            max_glyph_size.y = zf4::Max(max_glyph_size.y, size.y);
+        }
+
+        font.tex_size = {i_sdf_font_atlas_width, pen.y + row_height};
+    }
+
+    // Read back the source atlas and allocate the rest of what is needed.
+    const int max_glyph_area = max_glyph_size.x * max_glyph_size.y;
+    const int max_line_len = zf4::Max(max_glyph_size.x, max_glyph_size.y);
+
+    const auto src_px_data = static_cast<unsigned char*>(std::malloc(src_tex_size.x * src_tex_size.y * 4));
+    const auto dest_px_data = static_cast<unsigned char*>(std::calloc(font.tex_size.x * font.tex_size.y, 1));
+
+    s_sdf_font_scratch scratch = {
+        .inside_dists = static_cast<float*>(std::malloc(sizeof(float) * max_glyph_area)),
+        .outside_dists = static_cast<float*>(std::malloc(sizeof(float) * max_glyph_area)),
+        .line_vals = static_cast<float*>(std::malloc(sizeof(float) * max_line_len)),
+        .hull_xs = static_cast<int*>(std::malloc(sizeof(int) * max_line_len)),
+        .hull_bounds = static_cast<float*>(std::malloc(sizeof(float) * (max_line_len + 1)))
+    };
+
+    const bool alloc_succeeded = src_px_data && dest_px_data && scratch.inside_dists && scratch.outside_dists && scratch.line_vals && scratch.hull_xs && scratch.hull_bounds;
+
+    if (alloc_succeeded) {
+        glBindTexture(GL_TEXTURE_2D, fonts.tex_gl_ids[src_font_index]);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, src_px_data);
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+
+        for (int i = 0; i < zf4::g_font_chr_range_len; ++i) {
+            WriteGlyphDistField(dest_px_data, font.chr_src_rects[i], src_px_data, src_tex_size.x, src_arrangement_info.chr_src_rects[i], scratch);
+        }
+
+        glGenTextures(1, &font.tex_gl_id);
+        glBindTexture(GL_TEXTURE_2D, font.tex_gl_id);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, font.tex_size.x, font.tex_size.y, 0, GL_RED, GL_UNSIGNED_BYTE, dest_px_data);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    std::free(scratch.hull_bounds);
+    std::free(scratch.hull_xs);
+    std::free(scratch.line_vals);
+    std::free(scratch.outside_dists);
+    std::free(scratch.inside_dists);
+    std::free(dest_px_data);
+    std::free(src_px_data);
+
+    return alloc_succeeded;
+}
+
+void CleanSDFFont(s_sdf_font& font) {
+    glDeleteTextures(1, &font.tex_gl_id);
+    zf4::ZeroOutStruct(font);
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <zf4.h>
+
+static constexpr int i_sdf_font_spread = 8; // How far the distance field reaches either side of a glyph edge, in source pixels. Each glyph is padded by this in the atlas.
+static constexpr int i_sdf_font_atlas_width = 1024;
+
+// A signed distance field atlas built from one large rasterisation of a font, from which the typeface can be drawn sharply at any size. Metrics are in pixels of the source rasterisation, and the offsets and source rectangles include the padding.
+struct s_sdf_font {
+    GLuint tex_gl_id;
+    zf4::s_vec_2d_i tex_size;
+
+    float src_pt_size;
+    int line_height;
+    zf4::s_static_array<int, zf4::g_font_chr_range_len> chr_hor_offsets;
+    zf4::s_static_array<int, zf4::g_font_chr_range_len> chr_ver_offsets;
+    zf4::s_static_array<int, zf4::g_font_chr_range_len> chr_hor_advances;
+    zf4::s_static_array<zf4::s_rect_i, zf4::g_font_chr_range_len> chr_src_rects;
+};
+
+bool InitSDFFont(s_sdf_font& font, const zf4::s_fonts& fonts, const int src_font_index, const float src_pt_size);
+void CleanSDFFont(s_sdf_font& font);
@@ -0,0 +1,249 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <algorithm>
+#include <vector>
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include "shader_cache.h"
+
+// NOTE: This measures how long the game's shader programs take to become usable at startup, in a hidden window, so that it can be run against Mesa's software rasteriser (LIBGL_ALWAYS_SOFTWARE=1) as well as real hardware.
+// Every cold run tags the sources with a comment unique to it, so that neither the program binary cache nor the driver's own shader cache has seen them before. The warm run after it then loads the same sources again.
+
+static constexpr zf4::s_vec_2d_i i_window_size = {320, 180};
+static constexpr int i_default_run_cnt = 5;
+
+// The programs the game compiles itself, as listed in "gc.cpp".
+static constexpr const char* i_shader_prog_names[] = {"lighting", "tile_layer", "text_run", "sprite"};
+static constexpr int i_shader_prog_cnt = sizeof(i_shader_prog_names) / sizeof(i_shader_prog_names[0]);
+
+struct s_load_time {
+    double submit_ms; // Until every program has been loaded from the cache or submitted for compiling.
+    double total_ms; // Until every program is linked and cached.
+    double first_draw_ms; // Until every program has also been drawn with once, which some drivers (llvmpipe included) need to finish compiling.
+    int cache_hit_cnt;
+};
+
+static bool AppendSrcTag(char*& src, const int tag) {
+    char tag_str[32];
+    const int tag_len = std::snprintf(tag_str, sizeof(tag_str), "\n// Run %d\n", tag);
+    const size_t src_len = std::strlen(src);
+
+    const auto new_src = static_cast<char*>(std::realloc(src, src_len + tag_len + 1));
+
+    if (!new_src) {
+        return false;
+    }
+
+    std::memcpy(new_src + src_len, tag_str, tag_len + 1);
+    src = new_src;
+
+    return true;
+}
+
+// Loads every program, either together through one loader as the game does, or one at a time without the cache, waiting on each before starting the next.
+static bool TimeShaderProgLoads(s_load_time& time, const s_shader_prog_src* const srcs, const char* const cache_dir, const bool serial) {
+    zf4::s_static_array<GLuint, i_shader_prog_cnt> prog_gl_ids = {};
+
+    const auto begin = std::chrono::steady_clock::now();
+
+    bool success = true;
+
+    if (serial) {
+        for (int i = 0; i < i_shader_prog_cnt && success; ++i) {
+            s_shader_prog_loader loader = {};
+            BeginLoadingShaderProgs(loader, srcs + i, 1, nullptr);
+            success = EndLoadingShaderProgs(loader, &prog_gl_ids[i]);
+        }
+
+        time.submit_ms = 0.0;
+        time.cache_hit_cnt = 0;
+    } else {
+        s_shader_prog_loader loader = {};
+        BeginLoadingShaderProgs(loader, srcs, i_shader_prog_cnt, cache_dir);
+
+        time.submit_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+        time.cache_hit_cnt = loader.cache_hit_cnt;
+
+        success = EndLoadingShaderProgs(loader, prog_gl_ids.elems_raw);
+    }
+
+    time.total_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+
+    // Nothing is bound beyond an empty vertex array, since only the compiling the draw triggers matters here.
+    if (success) {
+        GLuint vert_array_gl_id;
+        glGenVertexArrays(1, &vert_array_gl_id);
+        glBindVertexArray(vert_array_gl_id);
+
+        for (int i = 0; i < i_shader_prog_cnt; ++i) {
+            glUseProgram(prog_gl_ids[i]);
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+        }
+
+        glFinish();
+
+        glUseProgram(0);
+        glBindVertexArray(0);
+        glDeleteVertexArrays(1, &vert_array_gl_id);
+    }
+
+    time.first_draw_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+
+    for (int i = 0; i < i_shader_prog_cnt; ++i) {
+        glDeleteProgram(prog_gl_ids[i]);
+    }
+
+    return success;
+}
+
+static double Median(std::vector<double> vals) {
+    assert(!vals.empty());
+    std::sort(vals.begin(), vals.end());
+    return vals[vals.size() / 2];
+}
+
+static void PrintUsage(const char* const exe_name) {
+    std::fprintf(stderr, "Usage: %s [--shader-dir <dir>] [--cache-dir <dir>] [--runs <cnt>]\n", exe_name);
+}
+
+int main(const int arg_cnt, const char* const* const args) {
+    const char* shader_dir = "assets/shaders";
+    const char* cache_dir = "shader_bench_cache";
+    int run_cnt = i_default_run_cnt;
+
+    for (int i = 1; i < arg_cnt; ++i) {
+        if (std::strcmp(args[i], "--shader-dir") == 0 && i + 1 < arg_cnt) {
+            shader_dir = args[++i];
+        } else if (std::strcmp(args[i], "--cache-dir") == 0 && i + 1 < arg_cnt) {
+            cache_dir = args[++i];
+        } else if (std::strcmp(args[i], "--runs") == 0 && i + 1 < arg_cnt) {
+            run_cnt = std::atoi(args[++i]);
+
+            if (run_cnt <= 0) {
+                PrintUsage(args[0]);
+                return EXIT_FAILURE;
+            }
+        } else {
+            PrintUsage(args[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (!glfwInit()) {
+        std::fprintf(stderr, "Failed to initialise GLFW!\n");
+        return EXIT_FAILURE;
+    }
+
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+    GLFWwindow* const window = glfwCreateWindow(i_window_size.x, i_window_size.y, "Shader Benchmark", nullptr, nullptr);
+
+    if (!window) {
+        std::fprintf(stderr, "Failed to create a window with an OpenGL 4.3 context!\n");
+        glfwTerminate();
+        return EXIT_FAILURE;
+    }
+
+    glfwMakeContextCurrent(window);
+
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+        std::fprintf(stderr, "Failed to load OpenGL functions!\n");
+        glfwDestroyWindow(window);
+        glfwTerminate();
+        return EXIT_FAILURE;
+    }
+
+    std::printf("renderer: %s\n", (const char*)glGetString(GL_RENDERER));
+
+    zf4::s_static_array<s_shader_prog_src, i_shader_prog_cnt> srcs = {};
+
+    bool success = true;
+
+    for (int i = 0; i < i_shader_prog_cnt && success; ++i) {
+        success = LoadShaderProgSrc(srcs[i], shader_dir, i_shader_prog_names[i]);
+    }
+
+    // Report what the driver offers, through a loader that is not otherwise used.
+    if (success) {
+        s_shader_prog_loader loader = {};
+        BeginLoadingShaderProgs(loader, srcs.elems_raw, 1, cache_dir);
+
+        std::printf("program binaries: %s\n", loader.binary_cacheable ? "supported" : "unsupported");
+        std::printf("parallel compile: %s\n", loader.parallel_compile ? "supported" : "unsupported");
+
+        GLuint prog_gl_id = 0;
+        success = EndLoadingShaderProgs(loader, &prog_gl_id);
+        glDeleteProgram(prog_gl_id);
+    }
+
+    std::vector<double> serial_times_ms;
+    std::vector<double> serial_first_draw_times_ms;
+    std::vector<double> cold_times_ms;
+    std::vector<double> cold_submit_times_ms;
+    std::vector<double> cold_first_draw_times_ms;
+    std::vector<double> warm_times_ms;
+    std::vector<double> warm_first_draw_times_ms;
+    int warm_cache_hit_cnt = i_shader_prog_cnt;
+
+    // NOTE: The tags start from the clock, so that sources from an earlier launch are not found in the driver's disk cache either.
+    const int tag_base = (int)(std::chrono::steady_clock::now().time_since_epoch().count() % 1000000) * 10;
+
+    // The first run is not counted, since the driver does one-off setup on its first compile.
+    for (int run = -1; run < run_cnt && success; ++run) {
+        for (int j = 0; j < 2 && success; ++j) {
+            for (int i = 0; i < i_shader_prog_cnt && success; ++i) {
+                success = AppendSrcTag(srcs[i].vs_src, tag_base + (run * 2) + j + 2) && AppendSrcTag(srcs[i].fs_src, tag_base + (run * 2) + j + 2);
+            }
+
+            if (!success) {
+                std::fprintf(stderr, "Failed to tag shader sources!\n");
+                break;
+            }
+
+            // The serial run gets its own tag, so that the cold run after it is still cold for the driver.
+            s_load_time time;
+            success = TimeShaderProgLoads(time, srcs.elems_raw, cache_dir, j == 0);
+
+            if (success && run >= 0) {
+                if (j == 0) {
+                    serial_times_ms.push_back(time.total_ms);
+                    serial_first_draw_times_ms.push_back(time.first_draw_ms);
+                } else {
+                    cold_times_ms.push_back(time.total_ms);
+                    cold_submit_times_ms.push_back(time.submit_ms);
+                    cold_first_draw_times_ms.push_back(time.first_draw_ms);
+                }
+            }
+        }
+
+        s_load_time time;
+        success = success && TimeShaderProgLoads(time, srcs.elems_raw, cache_dir, false);
+
+        if (success && run >= 0) {
+            warm_times_ms.push_back(time.total_ms);
+            warm_first_draw_times_ms.push_back(time.first_draw_ms);
+            warm_cache_hit_cnt = std::min(warm_cache_hit_cnt, time.cache_hit_cnt);
+        }
+    }
+
+    if (success) {
+        std::printf("programs: %d, runs: %d\n", i_shader_prog_cnt, run_cnt);
+        std::printf("cold, one at a time ms: %.2f, to first draw: %.2f\n", Median(serial_times_ms), Median(serial_first_draw_times_ms));
+        std::printf("cold ms: %.2f (%.2f submitting), to first draw: %.2f\n", Median(cold_times_ms), Median(cold_submit_times_ms), Median(cold_first_draw_times_ms));
+        std::printf("warm ms: %.2f (%d/%d from cache), to first draw: %.2f\n", Median(warm_times_ms), warm_cache_hit_cnt, i_shader_prog_cnt, Median(warm_first_draw_times_ms));
+    }
+
+    for (int i = 0; i < i_shader_prog_cnt; ++i) {
+        CleanShaderProgSrc(srcs[i]);
+    }
+
+    glfwDestroyWindow(window);
+    glfwTerminate();
+
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
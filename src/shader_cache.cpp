@@ -0,0 +1,320 @@
+#include "shader_cache.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <GLFW/glfw3.h>
+
+// NOTE: Parallel shader compilation is not core in any version, so the thread count setter is looked up at runtime rather than relied on through the loader. The KHR and ARB extensions share it under different suffixes.
+using a_gl_max_shader_compiler_threads_func = void (*)(GLuint cnt);
+
+static constexpr GLuint i_gl_max_shader_compiler_threads_all = 0xFFFFFFFF;
+
+static constexpr uint32_t i_shader_cache_file_magic = 0x42534347; // "GCSB" in little-endian.
+
+struct s_shader_cache_file_header {
+    uint32_t magic;
+    uint32_t binary_format;
+    uint64_t key;
+    uint32_t binary_size;
+};
+
+static char* LoadFileStr(const char* const file_path) {
+    FILE* const fs = std::fopen(file_path, "rb");
+
+    if (!fs) {
+        return nullptr;
+    }
+
+    std::fseek(fs, 0, SEEK_END);
+    const long size = std::ftell(fs);
+    std::fseek(fs, 0, SEEK_SET);
+
+    const auto str = static_cast<char*>(std::malloc(size + 1));
+
+    if (str) {
+        str[std::fread(str, 1, size, fs)] = '\0';
+    }
+
+    std::fclose(fs);
+
+    return str;
+}
+
+// Reads the program's vertex and fragment shader sources from "<name>.vert" and "<name>.frag" in the given directory.
+bool LoadShaderProgSrc(s_shader_prog_src& src, const char* const shader_dir, const char* const name) {
+    assert(zf4::IsStructZero(src));
+
+    char vs_file_path[512];
+    char fs_file_path[512];
+    std::snprintf(vs_file_path, sizeof(vs_file_path), "%s/%s.vert", shader_dir, name);
+    std::snprintf(fs_file_path, sizeof(fs_file_path), "%s/%s.frag", shader_dir, name);
+
+    src.name = name;
+    src.vs_src = LoadFileStr(vs_file_path);
+    src.fs_src = LoadFileStr(fs_file_path);
+
+    if (!src.vs_src || !src.fs_src) {
+        std::fprintf(stderr, "Failed to read shader \"%s\"!\n", src.vs_src ? fs_file_path : vs_file_path);
+        CleanShaderProgSrc(src);
+        return false;
+    }
+
+    return true;
+}
+
+void CleanShaderProgSrc(s_shader_prog_src& src) {
+    std::free(src.vs_src);
+    std::free(src.fs_src);
+    zf4::ZeroOutStruct(src);
+}
+
+static bool HasGLExtension(const char* const name) {
+    GLint ext_cnt = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &ext_cnt);
+
+    for (int i = 0; i < ext_cnt; ++i) {
+        if (std::strcmp((const char*)glGetStringi(GL_EXTENSIONS, i), name) == 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void HashStr(uint64_t& hash, const char* const str) {
+    // Include the terminator, so that moving text between consecutive strings changes the hash.
+    for (int i = 0; ; ++i) {
+        hash ^= (unsigned char)str[i];
+        hash *= 0x100000001B3ULL;
+
+        if (str[i] == '\0') {
+            break;
+        }
+    }
+}
+
+// Hashes the sources together with the strings identifying the driver, since a binary is only valid for the driver that produced it.
+static uint64_t CalcShaderProgKey(const s_shader_prog_src& src) {
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    HashStr(hash, (const char*)glGetString(GL_VENDOR));
+    HashStr(hash, (const char*)glGetString(GL_RENDERER));
+    HashStr(hash, (const char*)glGetString(GL_VERSION));
+    HashStr(hash, src.vs_src);
+    HashStr(hash, src.fs_src);
+    return hash;
+}
+
+static void LoadShaderCacheFilePath(char (&file_path)[512], const char* const cache_dir, const char* const name) {
+    std::snprintf(file_path, sizeof(file_path), "%s/%s.bin", cache_dir, name);
+}
+
+// Tries loading the program from its cached binary. Returns false if there is no binary for the current key, or if the driver rejects it.
+static bool LoadCachedShaderProg(const s_shader_prog_load& load, const char* const cache_dir) {
+    char file_path[512];
+    LoadShaderCacheFilePath(file_path, cache_dir, load.name);
+
+    FILE* const fs = std::fopen(file_path, "rb");
+
+    if (!fs) {
+        return false;
+    }
+
+    s_shader_cache_file_header header;
+    void* binary = nullptr;
+
+    const bool read = std::fread(&header, sizeof(header), 1, fs) == 1
+        && header.magic == i_shader_cache_file_magic
+        && header.key == load.key
+        && header.binary_size > 0
+        && (binary = std::malloc(header.binary_size)) != nullptr
+        && std::fread(binary, 1, header.binary_size, fs) == header.binary_size;
+
+    std::fclose(fs);
+
+    GLint linked = GL_FALSE;
+
+    if (read) {
+        glProgramBinary(load.gl_id, header.binary_format, binary, header.binary_size);
+        glGetProgramiv(load.gl_id, GL_LINK_STATUS, &linked);
+    }
+
+    std::free(binary);
+
+    return linked == GL_TRUE;
+}
+
+// Writes the binary of the linked program to the cache. A failure here only costs compiling the program again next launch, so it is reported but not treated as an error.
+static void CacheShaderProg(const s_shader_prog_load& load, const char* const cache_dir) {
+    GLint binary_size = 0;
+    glGetProgramiv(load.gl_id, GL_PROGRAM_BINARY_LENGTH, &binary_size);
+
+    if (binary_size <= 0) {
+        return;
+    }
+
+    void* const binary = std::malloc(binary_size);
+
+    if (!binary) {
+        return;
+    }
+
+    s_shader_cache_file_header header = {
+        .magic = i_shader_cache_file_magic,
+        .key = load.key
+    };
+
+    GLenum binary_format = 0;
+    GLsizei written_size = 0;
+    glGetProgramBinary(load.gl_id, binary_size, &written_size, &binary_format, binary);
+
+    header.binary_format = binary_format;
+    header.binary_size = written_size;
+
+    char file_path[512];
+    LoadShaderCacheFilePath(file_path, cache_dir, load.name);
+
+    FILE* const fs = written_size > 0 ? std::fopen(file_path, "wb") : nullptr;
+
+    bool written = false;
+
+    if (fs) {
+        written = std::fwrite(&header, sizeof(header), 1, fs) == 1 && std::fwrite(binary, 1, written_size, fs) == (size_t)written_size;
+        written = std::fclose(fs) == 0 && written;
+    }
+
+    if (!written) {
+        std::fprintf(stderr, "Failed to write shader cache file \"%s\"!\n", file_path);
+        std::remove(file_path); // So that a partial file is not left to be read next launch.
+    }
+
+    std::free(binary);
+}
+
+static GLuint SubmitShader(const char* const src, const GLenum type) {
+    const GLuint shader_gl_id = glCreateShader(type);
+    glShaderSource(shader_gl_id, 1, &src, nullptr);
+    glCompileShader(shader_gl_id);
+    return shader_gl_id;
+}
+
+// Starts loading each program, either from the cache or by submitting its shaders for compiling and linking. The sources can be freed once this returns.
+void BeginLoadingShaderProgs(s_shader_prog_loader& loader, const s_shader_prog_src* const srcs, const int src_cnt, const char* const cache_dir) {
+    assert(zf4::IsStructZero(loader));
+    assert(src_cnt > 0 && src_cnt <= i_shader_prog_load_limit);
+
+    if (cache_dir) {
+        GLint binary_format_cnt = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &binary_format_cnt);
+        loader.binary_cacheable = binary_format_cnt > 0;
+
+        std::error_code err;
+        std::filesystem::create_directories(cache_dir, err);
+
+        loader.cache_dir = cache_dir;
+    }
+
+    // Ask for as many compiler threads as the driver will give.
+    {
+        const char* const exts[] = {"GL_KHR_parallel_shader_compile", "GL_ARB_parallel_shader_compile"};
+        const char* const func_names[] = {"glMaxShaderCompilerThreadsKHR", "glMaxShaderCompilerThreadsARB"};
+
+        for (int i = 0; i < 2 && !loader.parallel_compile; ++i) {
+            if (!HasGLExtension(exts[i])) {
+                continue;
+            }
+
+            const auto func = reinterpret_cast<a_gl_max_shader_compiler_threads_func>(glfwGetProcAddress(func_names[i]));
+
+            if (func) {
+                func(i_gl_max_shader_compiler_threads_all);
+                loader.parallel_compile = true;
+            }
+        }
+    }
+
+    for (int i = 0; i < src_cnt; ++i) {
+        s_shader_prog_load& load = loader.loads[i];
+        load.name = srcs[i].name;
+        load.key = CalcShaderProgKey(srcs[i]);
+        load.gl_id = glCreateProgram();
+
+        if (loader.binary_cacheable && LoadCachedShaderProg(load, cache_dir)) {
+            ++loader.cache_hit_cnt;
+            continue;
+        }
+
+        load.vs_gl_id = SubmitShader(srcs[i].vs_src, GL_VERTEX_SHADER);
+        load.fs_gl_id = SubmitShader(srcs[i].fs_src, GL_FRAGMENT_SHADER);
+
+        glAttachShader(load.gl_id, load.vs_gl_id);
+        glAttachShader(load.gl_id, load.fs_gl_id);
+
+        if (loader.binary_cacheable) {
+            glProgramParameteri(load.gl_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        }
+
+        glLinkProgram(load.gl_id);
+    }
+
+    loader.load_cnt = src_cnt;
+}
+
+// Waits for the programs still compiling, caches those that linked, and writes out the program IDs in the order the sources were given. On failure every program is deleted.
+bool EndLoadingShaderProgs(s_shader_prog_loader& loader, GLuint* const prog_gl_ids) {
+    bool success = true;
+
+    for (int i = 0; i < loader.load_cnt; ++i) {
+        s_shader_prog_load& load = loader.loads[i];
+
+        if (!load.vs_gl_id) {
+            continue;
+        }
+
+        GLint linked;
+        glGetProgramiv(load.gl_id, GL_LINK_STATUS, &linked);
+
+        if (linked) {
+            if (loader.binary_cacheable) {
+                CacheShaderProg(load, loader.cache_dir);
+            }
+        } else {
+            char log[1024];
+
+            const GLuint shader_gl_ids[] = {load.vs_gl_id, load.fs_gl_id};
+
+            for (const GLuint shader_gl_id : shader_gl_ids) {
+                GLint compiled;
+                glGetShaderiv(shader_gl_id, GL_COMPILE_STATUS, &compiled);
+
+                if (!compiled) {
+                    glGetShaderInfoLog(shader_gl_id, sizeof(log), nullptr, log);
+                    std::fprintf(stderr, "Failed to compile shader \"%s\"!\n%s\n", load.name, log);
+                }
+            }
+
+            glGetProgramInfoLog(load.gl_id, sizeof(log), nullptr, log);
+            std::fprintf(stderr, "Failed to link the shader program \"%s\"!\n%s\n", load.name, log);
+
+            success = false;
+        }
+
+        glDetachShader(load.gl_id, load.vs_gl_id);
+        glDetachShader(load.gl_id, load.fs_gl_id);
+        glDeleteShader(load.vs_gl_id);
+        glDeleteShader(load.fs_gl_id);
+        load.vs_gl_id = 0;
+        load.fs_gl_id = 0;
+    }
+
+    for (int i = 0; i < loader.load_cnt; ++i) {
+        if (success) {
+            prog_gl_ids[i] = loader.loads[i].gl_id;
+        } else {
+            glDeleteProgram(loader.loads[i].gl_id);
+        }
+    }
+
+    return success;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <glad/glad.h>
+#include <zf4.h>
+
+static constexpr int i_shader_prog_load_limit = 16;
+
+struct s_shader_prog_src {
+    const char* name; // Names the program's binary in the cache, so has to be unique among the programs cached in a directory.
+    char* vs_src;
+    char* fs_src;
+};
+
+struct s_shader_prog_load {
+    const char* name;
+    uint64_t key; // Identifies the sources and driver the program is built from, so that a cached binary is only used if both still match.
+    GLuint gl_id;
+
+    // Zero if the program was loaded from the cache.
+    GLuint vs_gl_id;
+    GLuint fs_gl_id;
+};
+
+// Loads shader programs from binaries cached on disk by an earlier launch where it can, and otherwise by compiling their sources and then caching the result.
+// NOTE: Every program that needs compiling is submitted before any is waited on, and nothing is queried in between, so drivers that compile in the background (or across threads with GL_KHR_parallel_shader_compile) can get on with it while the caller loads other things.
+struct s_shader_prog_loader {
+    const char* cache_dir; // Null to neither read nor write the cache.
+    bool binary_cacheable; // Whether the driver offers any program binary formats.
+    bool parallel_compile;
+
+    zf4::s_static_array<s_shader_prog_load, i_shader_prog_load_limit> loads;
+    int load_cnt;
+    int cache_hit_cnt;
+};
+
+bool LoadShaderProgSrc(s_shader_prog_src& src, const char* const shader_dir, const char* const name);
+void CleanShaderProgSrc(s_shader_prog_src& src);
+void BeginLoadingShaderProgs(s_shader_prog_loader& loader, const s_shader_prog_src* const srcs, const int src_cnt, const char* const cache_dir);
+bool EndLoadingShaderProgs(s_shader_prog_loader& loader, GLuint* const prog_gl_ids);
@@ -0,0 +1,511 @@
+#include "snapshot.h"
+
+#include <cstring>
+
+// The fixed-size part of a snapshot, which also gives the sizes of the variable-size sections after it.
+struct s_snapshot_header {
+    s_player player;
+    bool player_active;
+
+    int enemy_spawn_time;
+
+    zf4::s_vec_2d cam_pos;
+
+    e_rule_type rule_type;
+    int rule_change_time;
+
+    s_rng rng;
+
+    int tile_edit_cnt;
+
+    // By enemy type.
+    zf4::s_static_array<int, eks_enemy_type_cnt> enemy_cnts;
+    zf4::s_static_array<int, eks_enemy_type_cnt> enemy_slot_cnts;
+    zf4::s_static_array<int, eks_enemy_type_cnt> enemy_free_slots;
+
+    int projectile_cnt;
+    int projectile_slot_cnt;
+    int projectile_free_slot;
+};
+
+// The sections each enemy archetype has, relative to its first.
+enum e_enemy_archetype_section {
+    ek_enemy_archetype_section_enemies,
+    ek_enemy_archetype_section_type_data,
+    ek_enemy_archetype_section_slot_indexes,
+    ek_enemy_archetype_section_slot_gens,
+    ek_enemy_archetype_section_index_slots,
+
+    eks_enemy_archetype_section_cnt
+};
+
+enum e_snapshot_section {
+    ek_snapshot_section_header,
+    ek_snapshot_section_tile_edit_chunk_indexes,
+    ek_snapshot_section_tile_edit_chunks,
+
+    // Each enemy archetype has a run of sections, in type order.
+    ek_snapshot_section_enemy_archetypes,
+    ek_snapshot_section_enemy_archetypes_last = ek_snapshot_section_enemy_archetypes + ((int)eks_enemy_type_cnt * (int)eks_enemy_archetype_section_cnt) - 1,
+
+    ek_snapshot_section_projectile_pos_xs,
+    ek_snapshot_section_projectile_pos_ys,
+    ek_snapshot_section_projectile_vel_xs,
+    ek_snapshot_section_projectile_vel_ys,
+    ek_snapshot_section_projectile_dir_xs,
+    ek_snapshot_section_projectile_dir_ys,
+    ek_snapshot_section_projectile_spds,
+    ek_snapshot_section_projectile_enemy_flags,
+    ek_snapshot_section_projectile_slot_indexes,
+    ek_snapshot_section_projectile_slot_gens,
+    ek_snapshot_section_projectile_index_slots,
+
+    eks_snapshot_section_cnt
+};
+
+// Gives the first of the archetype's sections.
+static inline int EnemyArchetypeSnapshotSection(const int type) {
+    return ek_snapshot_section_enemy_archetypes + (type * eks_enemy_archetype_section_cnt);
+}
+
+using a_snapshot_section_sizes = zf4::s_static_array<int, eks_snapshot_section_cnt>;
+using a_snapshot_section_ptrs = zf4::s_static_array<zf4::a_byte*, eks_snapshot_section_cnt>;
+
+// The most a delta can take up relative to its raw frame. Every run is at least one literal byte or four unchanged bytes, and costs at most two varints.
+static constexpr int CalcDeltaSizeLimit(const int frame_size) {
+    return (frame_size * 3) + (eks_snapshot_section_cnt * 32);
+}
+
+static void LoadSnapshotSectionSizes(a_snapshot_section_sizes& sizes, const s_snapshot_header& header) {
+    sizes[ek_snapshot_section_header] = sizeof(s_snapshot_header);
+    sizes[ek_snapshot_section_tile_edit_chunk_indexes] = sizeof(int) * header.tile_edit_cnt;
+    sizes[ek_snapshot_section_tile_edit_chunks] = sizeof(s_tile_chunk) * header.tile_edit_cnt;
+
+    for (int i = 0; i < eks_enemy_type_cnt; ++i) {
+        const int section = EnemyArchetypeSnapshotSection(i);
+        sizes[section + ek_enemy_archetype_section_enemies] = sizeof(s_enemy) * header.enemy_cnts[i];
+        sizes[section + ek_enemy_archetype_section_type_data] = i_enemy_type_data_sizes[i] * header.enemy_cnts[i];
+        sizes[section + ek_enemy_archetype_section_slot_indexes] = sizeof(int) * header.enemy_slot_cnts[i];
+        sizes[section + ek_enemy_archetype_section_slot_gens] = sizeof(int) * header.enemy_slot_cnts[i];
+        sizes[section + ek_enemy_archetype_section_index_slots] = sizeof(int) * header.enemy_cnts[i];
+    }
+
+    sizes[ek_snapshot_section_projectile_pos_xs] = sizeof(float) * header.projectile_cnt;
+    sizes[ek_snapshot_section_projectile_pos_ys] = sizeof(float) * header.projectile_cnt;
+    sizes[ek_snapshot_section_projectile_vel_xs] = sizeof(float) * header.projectile_cnt;
+    sizes[ek_snapshot_section_projectile_vel_ys] = sizeof(float) * header.projectile_cnt;
+    sizes[ek_snapshot_section_projectile_dir_xs] = sizeof(float) * header.projectile_cnt;
+    sizes[ek_snapshot_section_projectile_dir_ys] = sizeof(float) * header.projectile_cnt;
+    sizes[ek_snapshot_section_projectile_spds] = sizeof(float) * header.projectile_cnt;
+    sizes[ek_snapshot_section_projectile_enemy_flags] = sizeof(bool) * header.projectile_cnt;
+    sizes[ek_snapshot_section_projectile_slot_indexes] = sizeof(int) * header.projectile_slot_cnt;
+    sizes[ek_snapshot_section_projectile_slot_gens] = sizeof(int) * header.projectile_slot_cnt;
+    sizes[ek_snapshot_section_projectile_index_slots] = sizeof(int) * header.projectile_cnt;
+}
+
+// Points each section at where its data lives in the game state. The header section is not part of the game state, so it is pointed at the header given.
+static void LoadSnapshotSectionPtrs(a_snapshot_section_ptrs& ptrs, s_game& game, s_snapshot_header& header) {
+    const auto bytes = [](auto* const data) {
+        return reinterpret_cast<zf4::a_byte*>(data);
+    };
+
+    ptrs[ek_snapshot_section_header] = bytes(&header);
+    ptrs[ek_snapshot_section_tile_edit_chunk_indexes] = bytes(game.tilemap.edited_chunk_indexes);
+    ptrs[ek_snapshot_section_tile_edit_chunks] = bytes(game.tilemap.edited_chunks);
+
+    for (int i = 0; i < eks_enemy_type_cnt; ++i) {
+        s_enemy_archetype& archetype = game.enemies.archetypes[i];
+        const int section = EnemyArchetypeSnapshotSection(i);
+        ptrs[section + ek_enemy_archetype_section_enemies] = bytes(archetype.buf);
+        ptrs[section + ek_enemy_archetype_section_type_data] = archetype.type_data_buf;
+        ptrs[section + ek_enemy_archetype_section_slot_indexes] = bytes(archetype.handles.slot_indexes);
+        ptrs[section + ek_enemy_archetype_section_slot_gens] = bytes(archetype.handles.slot_gens);
+        ptrs[section + ek_enemy_archetype_section_index_slots] = bytes(archetype.handles.index_slots);
+    }
+
+    s_projectiles& projs = game.projectiles;
+    ptrs[ek_snapshot_section_projectile_pos_xs] = bytes(projs.pos_xs);
+    ptrs[ek_snapshot_section_projectile_pos_ys] = bytes(projs.pos_ys);
+    ptrs[ek_snapshot_section_projectile_vel_xs] = bytes(projs.vel_xs);
+    ptrs[ek_snapshot_section_projectile_vel_ys] = bytes(projs.vel_ys);
+    ptrs[ek_snapshot_section_projectile_dir_xs] = bytes(projs.dir_xs);
+    ptrs[ek_snapshot_section_projectile_dir_ys] = bytes(projs.dir_ys);
+    ptrs[ek_snapshot_section_projectile_spds] = bytes(projs.spds);
+    ptrs[ek_snapshot_section_projectile_enemy_flags] = bytes(projs.enemy_flags);
+    ptrs[ek_snapshot_section_projectile_slot_indexes] = bytes(projs.handles.slot_indexes);
+    ptrs[ek_snapshot_section_projectile_slot_gens] = bytes(projs.handles.slot_gens);
+    ptrs[ek_snapshot_section_projectile_index_slots] = bytes(projs.handles.index_slots);
+}
+
+static int CalcFrameSize(const a_snapshot_section_sizes& sizes) {
+    int size = 0;
+
+    for (int i = 0; i < sizes.len; ++i) {
+        size += sizes[i];
+    }
+
+    return size;
+}
+
+static s_snapshot_header LoadSnapshotHeader(const s_game& game) {
+    s_snapshot_header header;
+    zf4::ZeroOutStruct(header); // Padding is zeroed too, so that it never shows up in deltas.
+
+    header.player = game.player;
+    header.player_active = game.player_active;
+    header.enemy_spawn_time = game.enemy_spawn_time;
+    header.cam_pos = game.cam_pos;
+    header.rule_type = game.rule_type;
+    header.rule_change_time = game.rule_change_time;
+    header.rng = game.rng;
+
+    header.tile_edit_cnt = game.tilemap.edited_chunk_cnt;
+
+    for (int i = 0; i < eks_enemy_type_cnt; ++i) {
+        const s_enemy_archetype& archetype = game.enemies.archetypes[i];
+        header.enemy_cnts[i] = archetype.len;
+        header.enemy_slot_cnts[i] = archetype.handles.slot_cnt;
+        header.enemy_free_slots[i] = archetype.handles.free_slot;
+    }
+
+    header.projectile_cnt = game.projectiles.len;
+    header.projectile_slot_cnt = game.projectiles.handles.slot_cnt;
+    header.projectile_free_slot = game.projectiles.handles.free_slot;
+
+    return header;
+}
+
+static bool ReserveBytes(zf4::a_byte*& bytes, int& cap, const int min_cap) {
+    if (min_cap <= cap) {
+        return true;
+    }
+
+    if (!ResizePoolArray(bytes, min_cap)) {
+        return false;
+    }
+
+    cap = min_cap;
+
+    return true;
+}
+
+static int WriteVarint(zf4::a_byte* const out, unsigned int val) {
+    int len = 0;
+
+    while (val >= 0x80) {
+        out[len] = (zf4::a_byte)(val | 0x80);
+        val >>= 7;
+        ++len;
+    }
+
+    out[len] = (zf4::a_byte)val;
+
+    return len + 1;
+}
+
+static int ReadVarint(const zf4::a_byte* const in, int& pos) {
+    unsigned int val = 0;
+
+    for (int shift = 0; ; shift += 7) {
+        const zf4::a_byte byte = in[pos];
+        ++pos;
+
+        val |= (unsigned int)(byte & 0x7F) << shift;
+
+        if (!(byte & 0x80)) {
+            break;
+        }
+    }
+
+    return (int)val;
+}
+
+// Writes the section as a series of runs, each being a count of bytes unchanged from the keyframe followed by a count of bytes XORed with the keyframe. Bytes past the end of the keyframe's section are written as they are.
+static int EncodeSectionDelta(zf4::a_byte* const out, const zf4::a_byte* const cur, const int cur_size, const zf4::a_byte* const key, const int key_size) {
+    const int overlap_size = zf4::Min(cur_size, key_size);
+
+    int out_size = 0;
+    int i = 0;
+
+    while (i < cur_size) {
+        const int unchanged_begin = i;
+
+        while (i + (int)sizeof(uint64_t) <= overlap_size) {
+            uint64_t cur_word, key_word;
+            std::memcpy(&cur_word, cur + i, sizeof(cur_word));
+            std::memcpy(&key_word, key + i, sizeof(key_word));
+
+            if (cur_word != key_word) {
+                break;
+            }
+
+            i += sizeof(uint64_t);
+        }
+
+        while (i < overlap_size && cur[i] == key[i]) {
+            ++i;
+        }
+
+        // Only end a literal run for four or more unchanged bytes, as fewer would cost more to encode as a new run than to keep.
+        const int changed_begin = i;
+
+        while (i < cur_size && !(i + 4 <= overlap_size && std::memcmp(cur + i, key + i, 4) == 0)) {
+            ++i;
+        }
+
+        out_size += WriteVarint(out + out_size, changed_begin - unchanged_begin);
+        out_size += WriteVarint(out + out_size, i - changed_begin);
+
+        for (int j = changed_begin; j < i; ++j) {
+            out[out_size] = j < overlap_size ? cur[j] ^ key[j] : cur[j];
+            ++out_size;
+        }
+    }
+
+    return out_size;
+}
+
+static void DecodeSectionDelta(zf4::a_byte* const dest, const int dest_size, const zf4::a_byte* const key, const int key_size, const zf4::a_byte* const in, int& in_pos) {
+    const int overlap_size = zf4::Min(dest_size, key_size);
+
+    int i = 0;
+
+    while (i < dest_size) {
+        const int unchanged_cnt = ReadVarint(in, in_pos);
+        assert(i + unchanged_cnt <= overlap_size);
+
+        std::memcpy(dest + i, key + i, unchanged_cnt);
+        i += unchanged_cnt;
+
+        const int changed_cnt = ReadVarint(in, in_pos);
+        assert(i + changed_cnt <= dest_size);
+
+        for (const int end = i + changed_cnt; i < end; ++i) {
+            dest[i] = i < overlap_size ? in[in_pos] ^ key[i] : in[in_pos];
+            ++in_pos;
+        }
+    }
+}
+
+static bool LoadGameFromFrame(s_game& game, const zf4::a_byte* const frame) {
+    s_snapshot_header header;
+    std::memcpy(&header, frame, sizeof(header));
+
+    for (int i = 0; i < eks_enemy_type_cnt; ++i) {
+        if (!ReserveEnemies(game.enemies, (e_enemy_type)i, zf4::Max(header.enemy_cnts[i], header.enemy_slot_cnts[i]))) {
+            return false;
+        }
+    }
+
+    if (!ReserveProjectiles(game.projectiles, zf4::Max(header.projectile_cnt, header.projectile_slot_cnt))
+        || !ReserveTileChunkEdits(game.tilemap, header.tile_edit_cnt)) {
+        return false;
+    }
+
+    game.player = header.player;
+    game.player_active = header.player_active;
+    game.enemy_spawn_time = header.enemy_spawn_time;
+    game.cam_pos = header.cam_pos;
+    game.rule_type = header.rule_type;
+    game.rule_change_time = header.rule_change_time;
+    game.rng = header.rng;
+
+    UnlinkTileChunkEdits(game.tilemap);
+    game.tilemap.edited_chunk_cnt = header.tile_edit_cnt;
+
+    for (int i = 0; i < eks_enemy_type_cnt; ++i) {
+        s_enemy_archetype& archetype = game.enemies.archetypes[i];
+        archetype.len = header.enemy_cnts[i];
+        archetype.handles.slot_cnt = header.enemy_slot_cnts[i];
+        archetype.handles.free_slot = header.enemy_free_slots[i];
+    }
+
+    game.projectiles.len = header.projectile_cnt;
+    game.projectiles.handles.slot_cnt = header.projectile_slot_cnt;
+    game.projectiles.handles.free_slot = header.projectile_free_slot;
+
+    a_snapshot_section_sizes sizes;
+    LoadSnapshotSectionSizes(sizes, header);
+
+    a_snapshot_section_ptrs ptrs;
+    LoadSnapshotSectionPtrs(ptrs, game, header);
+
+    int offs = sizes[ek_snapshot_section_header];
+
+    for (int i = ek_snapshot_section_header + 1; i < eks_snapshot_section_cnt; ++i) {
+        if (sizes[i] > 0) {
+            std::memcpy(ptrs[i], frame + offs, sizes[i]);
+        }
+
+        offs += sizes[i];
+    }
+
+    LinkTileChunkEdits(game.tilemap);
+
+    // The tile activity may have changed under anything caching it, so the version is moved on rather than restored.
+    ++game.tilemap.version;
+
+    return true;
+}
+
+void InitSnapshotHistory(s_snapshot_history& history) {
+    assert(zf4::IsStructZero(history));
+
+    for (int i = 0; i < history.snapshots.len; ++i) {
+        history.snapshots[i].index = -1;
+    }
+}
+
+void CleanSnapshotHistory(s_snapshot_history& history) {
+    for (int i = 0; i < history.snapshots.len; ++i) {
+        std::free(history.snapshots[i].bytes);
+    }
+
+    std::free(history.frame_buf);
+
+    zf4::ZeroOutStruct(history);
+}
+
+bool CaptureSnapshot(s_snapshot_history& history, const s_game& game) {
+    const int index = history.snapshot_cnt;
+    s_snapshot& snapshot = history.snapshots[index % i_snapshot_history_len];
+
+    s_snapshot_header header = LoadSnapshotHeader(game);
+
+    a_snapshot_section_sizes sizes;
+    LoadSnapshotSectionSizes(sizes, header);
+
+    // NOTE: The game state is only read through these.
+    a_snapshot_section_ptrs ptrs;
+    LoadSnapshotSectionPtrs(ptrs, const_cast<s_game&>(game), header);
+
+    const int frame_size = CalcFrameSize(sizes);
+
+    if (index % i_snapshot_keyframe_interval == 0) {
+        if (!ReserveBytes(snapshot.bytes, snapshot.cap, frame_size)) {
+            return false;
+        }
+
+        int offs = 0;
+
+        for (int i = 0; i < eks_snapshot_section_cnt; ++i) {
+            if (sizes[i] > 0) {
+                std::memcpy(snapshot.bytes + offs, ptrs[i], sizes[i]);
+            }
+
+            offs += sizes[i];
+        }
+
+        snapshot.size = frame_size;
+    } else {
+        const int keyframe_index = index - (index % i_snapshot_keyframe_interval);
+        const s_snapshot& keyframe = history.snapshots[keyframe_index % i_snapshot_history_len];
+        assert(keyframe.index == keyframe_index);
+
+        s_snapshot_header keyframe_header;
+        std::memcpy(&keyframe_header, keyframe.bytes, sizeof(keyframe_header));
+
+        a_snapshot_section_sizes keyframe_sizes;
+        LoadSnapshotSectionSizes(keyframe_sizes, keyframe_header);
+
+        // Encode into the scratch buffer, since the worst case is far larger than the usual one, then copy out only what was used.
+        if (!ReserveBytes(history.frame_buf, history.frame_buf_cap, CalcDeltaSizeLimit(frame_size))) {
+            return false;
+        }
+
+        int delta_size = 0;
+        int keyframe_offs = 0;
+
+        for (int i = 0; i < eks_snapshot_section_cnt; ++i) {
+            delta_size += EncodeSectionDelta(history.frame_buf + delta_size, ptrs[i], sizes[i], keyframe.bytes + keyframe_offs, keyframe_sizes[i]);
+            keyframe_offs += keyframe_sizes[i];
+        }
+
+        if (!ReserveBytes(snapshot.bytes, snapshot.cap, delta_size)) {
+            return false;
+        }
+
+        std::memcpy(snapshot.bytes, history.frame_buf, delta_size);
+        snapshot.size = delta_size;
+    }
+
+    snapshot.index = index;
+    ++history.snapshot_cnt;
+
+    return true;
+}
+
+bool CanRestoreSnapshot(const s_snapshot_history& history, const int index) {
+    if (index < 0 || index >= history.snapshot_cnt || history.snapshots[index % i_snapshot_history_len].index != index) {
+        return false;
+    }
+
+    const int keyframe_index = index - (index % i_snapshot_keyframe_interval);
+    return history.snapshots[keyframe_index % i_snapshot_history_len].index == keyframe_index;
+}
+
+// Puts the game back in the state it was in when the snapshot was captured. Snapshots after it are dropped, so that the next capture follows on from it.
+bool RestoreSnapshot(s_game& game, s_snapshot_history& history, const int index) {
+    assert(CanRestoreSnapshot(history, index));
+
+    const s_snapshot& snapshot = history.snapshots[index % i_snapshot_history_len];
+
+    if (index % i_snapshot_keyframe_interval == 0) {
+        if (!LoadGameFromFrame(game, snapshot.bytes)) {
+            return false;
+        }
+    } else {
+        const int keyframe_index = index - (index % i_snapshot_keyframe_interval);
+        const s_snapshot& keyframe = history.snapshots[keyframe_index % i_snapshot_history_len];
+
+        s_snapshot_header keyframe_header;
+        std::memcpy(&keyframe_header, keyframe.bytes, sizeof(keyframe_header));
+
+        a_snapshot_section_sizes keyframe_sizes;
+        LoadSnapshotSectionSizes(keyframe_sizes, keyframe_header);
+
+        // The header has to be decoded first, since it gives the sizes of the other sections.
+        s_snapshot_header header;
+        int delta_pos = 0;
+        DecodeSectionDelta(reinterpret_cast<zf4::a_byte*>(&header), sizeof(header), keyframe.bytes, sizeof(keyframe_header), snapshot.bytes, delta_pos);
+
+        a_snapshot_section_sizes sizes;
+        LoadSnapshotSectionSizes(sizes, header);
+
+        if (!ReserveBytes(history.frame_buf, history.frame_buf_cap, CalcFrameSize(sizes))) {
+            return false;
+        }
+
+        std::memcpy(history.frame_buf, &header, sizeof(header));
+
+        int offs = sizes[ek_snapshot_section_header];
+        int keyframe_offs = keyframe_sizes[ek_snapshot_section_header];
+
+        for (int i = ek_snapshot_section_header + 1; i < eks_snapshot_section_cnt; ++i) {
+            DecodeSectionDelta(history.frame_buf + offs, sizes[i], keyframe.bytes + keyframe_offs, keyframe_sizes[i], snapshot.bytes, delta_pos);
+            offs += sizes[i];
+            keyframe_offs += keyframe_sizes[i];
+        }
+
+        assert(delta_pos == snapshot.size);
+
+        if (!LoadGameFromFrame(game, history.frame_buf)) {
+            return false;
+        }
+    }
+
+    history.snapshot_cnt = index + 1;
+
+    return true;
+}
+
+// Returns the number of bytes held by the history, including capacity not currently in use.
+int CalcSnapshotHistorySize(const s_snapshot_history& history) {
+    int size = history.frame_buf_cap;
+
+    for (int i = 0; i < history.snapshots.len; ++i) {
+        size += history.snapshots[i].cap;
+    }
+
+    return size;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "game.h"
+
+// NOTE: Snapshots hold only the state that carries over between ticks, with entity pools cut down to their live ranges. Of the tilemap, only the edited chunks are held, since the map file never changes. Every keyframe interval a full snapshot is stored, and the snapshots in between are stored as run-length encoded XOR deltas against it, so restoring any snapshot takes at most one decode.
+
+constexpr int i_snapshot_keyframe_interval = 60;
+constexpr int i_snapshot_history_len = i_snapshot_keyframe_interval * 10;
+
+static_assert(i_snapshot_history_len % i_snapshot_keyframe_interval == 0, "The history length must be a whole number of keyframe intervals!");
+
+struct s_snapshot {
+    zf4::a_byte* bytes; // The raw frame for a keyframe, or the encoded delta otherwise.
+    int size;
+    int cap;
+
+    int index; // -1 if the snapshot has never been captured into.
+};
+
+// A ring buffer of snapshots, indexed by capture count.
+struct s_snapshot_history {
+    zf4::s_static_array<s_snapshot, i_snapshot_history_len> snapshots;
+    int snapshot_cnt;
+
+    zf4::a_byte* frame_buf; // Scratch space for laying out or decoding a raw frame.
+    int frame_buf_cap;
+};
+
+void InitSnapshotHistory(s_snapshot_history& history);
+void CleanSnapshotHistory(s_snapshot_history& history);
+bool CaptureSnapshot(s_snapshot_history& history, const s_game& game);
+bool CanRestoreSnapshot(const s_snapshot_history& history, const int index);
+bool RestoreSnapshot(s_game& game, s_snapshot_history& history, const int index);
+int CalcSnapshotHistorySize(const s_snapshot_history& history);
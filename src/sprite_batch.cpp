@@ -0,0 +1,250 @@
+#include "sprite_batch.h"
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <GLFW/glfw3.h>
+#include "game.h"
+#include "pool.h"
+
+// NOTE: Buffer storage is core only from OpenGL 4.4, above the 4.3 context asked for, so it is looked up at runtime rather than relied on through the loader.
+static constexpr GLbitfield i_gl_map_persistent_bit = 0x0040;
+static constexpr GLbitfield i_gl_map_coherent_bit = 0x0080;
+
+using a_gl_buffer_storage_func = void (*)(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags);
+
+static constexpr int i_sprite_batch_ring_cap = i_sprite_batch_segment_cap * i_sprite_batch_segment_cnt;
+
+static constexpr GLuint64 i_sprite_batch_fence_timeout_ns = 1000000000;
+
+static constexpr int i_sprite_cmd_stream_cmd_chunk_size = 64;
+
+bool InitSpriteBatch(s_sprite_batch& batch, const bool recording) {
+    assert(zf4::IsStructZero(batch));
+
+    const GLsizeiptr buf_size = sizeof(s_sprite_instance) * i_sprite_batch_ring_cap;
+
+    if (recording) {
+        batch.insts = static_cast<s_sprite_instance*>(std::malloc(buf_size));
+
+        if (!batch.insts) {
+            return false;
+        }
+
+        batch.recording = true;
+
+        return true;
+    }
+
+    glGenVertexArrays(1, &batch.vert_array_gl_id);
+    glBindVertexArray(batch.vert_array_gl_id);
+
+    glGenBuffers(1, &batch.inst_buf_gl_id);
+    glBindBuffer(GL_ARRAY_BUFFER, batch.inst_buf_gl_id);
+
+    const auto buffer_storage_func = reinterpret_cast<a_gl_buffer_storage_func>(glfwGetProcAddress("glBufferStorage"));
+
+    if (buffer_storage_func) {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | i_gl_map_persistent_bit | i_gl_map_coherent_bit;
+        buffer_storage_func(GL_ARRAY_BUFFER, buf_size, nullptr, flags);
+        batch.insts = static_cast<s_sprite_instance*>(glMapBufferRange(GL_ARRAY_BUFFER, 0, buf_size, flags));
+        batch.persistent = batch.insts != nullptr;
+    }
+
+    if (!batch.persistent) {
+        // The buffer has to be replaced, since storage allocated for mapping cannot be reallocated.
+        if (buffer_storage_func) {
+            glDeleteBuffers(1, &batch.inst_buf_gl_id);
+            glGenBuffers(1, &batch.inst_buf_gl_id);
+            glBindBuffer(GL_ARRAY_BUFFER, batch.inst_buf_gl_id);
+        }
+
+        glBufferData(GL_ARRAY_BUFFER, buf_size, nullptr, GL_STREAM_DRAW);
+
+        batch.insts = static_cast<s_sprite_instance*>(std::malloc(buf_size));
+
+        if (!batch.insts) {
+            glBindVertexArray(0);
+            CleanSpriteBatch(batch);
+            return false;
+        }
+    }
+
+    const int stride = sizeof(s_sprite_instance);
+
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, stride, (const void*)offsetof(s_sprite_instance, pos));
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, (const void*)offsetof(s_sprite_instance, scale));
+    glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, stride, (const void*)offsetof(s_sprite_instance, rot));
+    glVertexAttribPointer(3, 4, GL_UNSIGNED_SHORT, GL_FALSE, stride, (const void*)offsetof(s_sprite_instance, src_rect));
+    glVertexAttribPointer(4, 2, GL_UNSIGNED_SHORT, GL_TRUE, stride, (const void*)offsetof(s_sprite_instance, origin));
+    glVertexAttribPointer(5, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, (const void*)offsetof(s_sprite_instance, blend));
+
+    for (int i = 0; i <= 5; ++i) {
+        glEnableVertexAttribArray(i);
+        glVertexAttribDivisor(i, 1);
+    }
+
+    glBindVertexArray(0);
+
+    return true;
+}
+
+void CleanSpriteBatch(s_sprite_batch& batch) {
+    if (batch.recording) {
+        std::free(batch.insts);
+        std::free(batch.cmd_stream.cmds);
+        std::free(batch.cmd_stream.insts);
+        zf4::ZeroOutStruct(batch);
+        return;
+    }
+
+    for (int i = 0; i < i_sprite_batch_segment_cnt; ++i) {
+        if (batch.segment_fences[i]) {
+            glDeleteSync(batch.segment_fences[i]);
+        }
+    }
+
+    if (batch.persistent) {
+        glBindBuffer(GL_ARRAY_BUFFER, batch.inst_buf_gl_id);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+    } else {
+        std::free(batch.insts);
+    }
+
+    glDeleteBuffers(1, &batch.inst_buf_gl_id);
+    glDeleteVertexArrays(1, &batch.vert_array_gl_id);
+
+    zf4::ZeroOutStruct(batch);
+}
+
+void BeginSpriteBatch(s_sprite_batch& batch, const GLuint prog_gl_id, const GLuint tex_gl_id, const zf4::s_vec_2d_i tex_size, const zf4::s_matrix_4x4& view_mat, const zf4::s_vec_2d_i window_size) {
+    assert(batch.len == batch.flushed_len); // The last batch should have been flushed.
+
+    batch.prog_gl_id = prog_gl_id;
+
+    // NOTE: The uniform locations are looked up here rather than on every flush, and only when the program is not the one they were last looked up in. The program is not known on initialisation, since the shader programs finish loading after the batch is set up.
+    if (!batch.recording && batch.prog_uniforms.prog_gl_id != prog_gl_id) {
+        s_sprite_batch_prog_uniforms& uniforms = batch.prog_uniforms;
+        uniforms.prog_gl_id = prog_gl_id;
+        uniforms.proj = glGetUniformLocation(prog_gl_id, "u_proj");
+        uniforms.view = glGetUniformLocation(prog_gl_id, "u_view");
+        uniforms.tex_size = glGetUniformLocation(prog_gl_id, "u_tex_size");
+        uniforms.tex = glGetUniformLocation(prog_gl_id, "u_tex");
+    }
+
+    batch.tex_gl_id = tex_gl_id;
+    batch.tex_size = tex_size;
+    batch.view_mat = view_mat;
+    batch.window_size = window_size;
+}
+
+// Appends a command for the given instances of the ring to the stream, along with a copy of them.
+static void RecordSpriteDrawCmd(s_sprite_batch& batch, const int inst_begin, const int cnt) {
+    s_sprite_cmd_stream& stream = batch.cmd_stream;
+
+    if (stream.cmd_cnt == stream.cmd_cap) {
+        const int cap = CalcPoolCap(stream.cmd_cap, stream.cmd_cnt + 1, i_sprite_cmd_stream_cmd_chunk_size);
+
+        if (!ResizePoolArray(stream.cmds, cap)) {
+            stream.overflowed = true;
+            return;
+        }
+
+        stream.cmd_cap = cap;
+    }
+
+    if (stream.inst_cnt + cnt > stream.inst_cap) {
+        const int cap = CalcPoolCap(stream.inst_cap, stream.inst_cnt + cnt, i_sprite_batch_segment_cap);
+
+        if (!ResizePoolArray(stream.insts, cap)) {
+            stream.overflowed = true;
+            return;
+        }
+
+        stream.inst_cap = cap;
+    }
+
+    stream.cmds[stream.cmd_cnt] = {
+        .inst_begin = stream.inst_cnt,
+        .inst_cnt = cnt,
+        .prog_gl_id = batch.prog_gl_id,
+        .tex_gl_id = batch.tex_gl_id
+    };
+
+    ++stream.cmd_cnt;
+
+    std::memcpy(stream.insts + stream.inst_cnt, batch.insts + inst_begin, sizeof(s_sprite_instance) * cnt);
+    stream.inst_cnt += cnt;
+}
+
+void FlushSpriteBatch(s_sprite_batch& batch) {
+    const int cnt = batch.len - batch.flushed_len;
+
+    if (cnt == 0) {
+        return;
+    }
+
+    const int inst_begin = (batch.segment * i_sprite_batch_segment_cap) + batch.flushed_len;
+
+    if (batch.recording) {
+        RecordSpriteDrawCmd(batch, inst_begin, cnt);
+        batch.flushed_len = batch.len;
+        return;
+    }
+
+    if (!batch.persistent) {
+        glBindBuffer(GL_ARRAY_BUFFER, batch.inst_buf_gl_id);
+        glBufferSubData(GL_ARRAY_BUFFER, sizeof(s_sprite_instance) * inst_begin, sizeof(s_sprite_instance) * cnt, batch.insts + inst_begin);
+    }
+
+    const zf4::s_matrix_4x4 proj_mat = LoadPixelProjMatrix4x4(batch.window_size);
+    const s_sprite_batch_prog_uniforms& uniforms = batch.prog_uniforms;
+
+    glUseProgram(batch.prog_gl_id);
+    glUniformMatrix4fv(uniforms.proj, 1, GL_FALSE, &proj_mat.elems[0][0]);
+    glUniformMatrix4fv(uniforms.view, 1, GL_FALSE, &batch.view_mat.elems[0][0]);
+    glUniform2f(uniforms.tex_size, (float)batch.tex_size.x, (float)batch.tex_size.y);
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, batch.tex_gl_id);
+    glUniform1i(uniforms.tex, 0);
+
+    glBindVertexArray(batch.vert_array_gl_id);
+    glDrawArraysInstancedBaseInstance(GL_TRIANGLE_STRIP, 0, 4, cnt, inst_begin);
+    glBindVertexArray(0);
+
+    batch.flushed_len = batch.len;
+}
+
+// Draws what is left of the current segment and moves into the next, first waiting for the GPU to finish with it if it was last drawn from.
+void CycleSpriteBatchSegment(s_sprite_batch& batch) {
+    FlushSpriteBatch(batch);
+
+    if (batch.persistent) {
+        batch.segment_fences[batch.segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+
+    batch.segment = (batch.segment + 1) % i_sprite_batch_segment_cnt;
+    batch.len = 0;
+    batch.flushed_len = 0;
+
+    GLsync& fence = batch.segment_fences[batch.segment];
+
+    if (fence) {
+        while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, i_sprite_batch_fence_timeout_ns) == GL_TIMEOUT_EXPIRED) {
+        }
+
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+}
+
+// Empties the command stream of a recording batch, keeping its memory for the next frame.
+void ClearSpriteCmdStream(s_sprite_batch& batch) {
+    assert(batch.recording);
+
+    s_sprite_cmd_stream& stream = batch.cmd_stream;
+    stream.cmd_cnt = 0;
+    stream.inst_cnt = 0;
+    stream.overflowed = false;
+}
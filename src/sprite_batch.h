@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstdint>
+#include <glad/glad.h>
+#include <zf4.h>
+
+static constexpr int i_sprite_batch_segment_cap = 16384; // In sprites.
+static constexpr int i_sprite_batch_segment_cnt = 3; // Enough that the GPU is never still reading the segment being moved into, short of it falling two segments behind.
+
+// NOTE: This is laid out to match the per-instance attributes of "sprite.vert". The quad corners, texture coordinates and rotation are worked out in the vertex shader, so a sprite costs one of these rather than four full vertices.
+struct s_sprite_instance {
+    zf4::s_vec_2d pos;
+    zf4::s_vec_2d scale;
+    float rot;
+    uint16_t src_rect[4]; // Position and size in texels.
+    uint16_t origin[2]; // Normalised, as a fraction of the size.
+    uint8_t blend[4]; // Normalised.
+};
+
+static_assert(sizeof(s_sprite_instance) == 36, "s_sprite_instance must match the instance attribute layout of the sprite shader!");
+
+// A flush recorded in place of a draw call, when the batch is recording.
+struct s_sprite_draw_cmd {
+    int inst_begin; // Into the stream's own copy of the instances, which outlives the ring.
+    int inst_cnt;
+    GLuint prog_gl_id;
+    GLuint tex_gl_id;
+};
+
+// Every flush made while recording, with the instances it would have drawn. Kept until cleared, so that a whole frame can be checked or measured after it is built.
+struct s_sprite_cmd_stream {
+    s_sprite_draw_cmd* cmds;
+    int cmd_cnt;
+    int cmd_cap;
+
+    s_sprite_instance* insts;
+    int inst_cnt;
+    int inst_cap;
+
+    bool overflowed; // Set if the stream could not grow to hold a flush, which is then left out.
+};
+
+// The uniform locations of the program a batch is drawn with, so that they are not looked up on every flush.
+struct s_sprite_batch_prog_uniforms {
+    GLuint prog_gl_id; // The program these were looked up in, or 0 if none yet.
+
+    GLint proj;
+    GLint view;
+    GLint tex_size;
+    GLint tex;
+};
+
+// Draws sprites as instanced quads. Instances are written straight into a persistently mapped ring of buffer segments, and when one segment fills the next is moved into once the GPU is done reading it, as marked by a fence.
+// If the driver does not offer buffer storage, instances are instead staged in client memory and copied into the buffer on flushing.
+// A recording batch makes no GL calls at all. Its flushes are appended to a command stream instead, so that building batches can be measured on machines without a GPU.
+struct s_sprite_batch {
+    GLuint vert_array_gl_id;
+    GLuint inst_buf_gl_id;
+
+    s_sprite_instance* insts; // The whole ring, either mapped or staged.
+    bool persistent;
+    bool recording;
+    zf4::s_static_array<GLsync, i_sprite_batch_segment_cnt> segment_fences; // Null for a segment with no draws pending.
+
+    int segment;
+    int len; // Within the current segment.
+    int flushed_len; // How much of the current segment has been drawn.
+
+    // What the sprites since the batch was begun are drawn with.
+    GLuint prog_gl_id;
+    GLuint tex_gl_id;
+    zf4::s_vec_2d_i tex_size;
+    zf4::s_matrix_4x4 view_mat;
+    zf4::s_vec_2d_i window_size;
+
+    s_sprite_batch_prog_uniforms prog_uniforms; // Not used when recording.
+
+    s_sprite_cmd_stream cmd_stream; // Only used when recording.
+};
+
+bool InitSpriteBatch(s_sprite_batch& batch, const bool recording = false);
+void CleanSpriteBatch(s_sprite_batch& batch);
+void BeginSpriteBatch(s_sprite_batch& batch, const GLuint prog_gl_id, const GLuint tex_gl_id, const zf4::s_vec_2d_i tex_size, const zf4::s_matrix_4x4& view_mat, const zf4::s_vec_2d_i window_size);
+void FlushSpriteBatch(s_sprite_batch& batch);
+void CycleSpriteBatchSegment(s_sprite_batch& batch);
+void ClearSpriteCmdStream(s_sprite_batch& batch);
+
+// Takes the same arguments as submitting a texture to the render batch.
+static inline void SubmitSprite(s_sprite_batch& batch, const zf4::s_rect_i src_rect, const zf4::s_vec_2d pos, const zf4::s_vec_2d origin = {0.5f, 0.5f}, const zf4::s_vec_2d scale = {1.0f, 1.0f}, const float rot = 0.0f, const zf4::s_vec_4d blend = zf4::colors::g_white) {
+    assert(batch.prog_gl_id);
+    assert(origin.x >= 0.0f && origin.y >= 0.0f && origin.x <= 1.0f && origin.y <= 1.0f);
+    assert(blend.x >= 0.0f && blend.y >= 0.0f && blend.z >= 0.0f && blend.w >= 0.0f && blend.x <= 1.0f && blend.y <= 1.0f && blend.z <= 1.0f && blend.w <= 1.0f);
+
+    if (batch.len == i_sprite_batch_segment_cap) {
+        CycleSpriteBatchSegment(batch);
+    }
+
+    // NOTE: The instance is built locally and then copied over whole, since mapped memory is likely write-combined and should only be written to in order.
+    const s_sprite_instance inst = {
+        .pos = pos,
+        .scale = scale,
+        .rot = rot,
+        .src_rect = {(uint16_t)src_rect.x, (uint16_t)src_rect.y, (uint16_t)src_rect.width, (uint16_t)src_rect.height},
+        .origin = {(uint16_t)((origin.x * 65535.0f) + 0.5f), (uint16_t)((origin.y * 65535.0f) + 0.5f)},
+        .blend = {(uint8_t)((blend.x * 255.0f) + 0.5f), (uint8_t)((blend.y * 255.0f) + 0.5f), (uint8_t)((blend.z * 255.0f) + 0.5f), (uint8_t)((blend.w * 255.0f) + 0.5f)}
+    };
+
+    batch.insts[(batch.segment * i_sprite_batch_segment_cap) + batch.len] = inst;
+    ++batch.len;
+}
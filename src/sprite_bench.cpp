@@ -0,0 +1,563 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <chrono>
+#include <algorithm>
+#include <vector>
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include "game.h"
+#include "sprite_batch.h"
+
+// NOTE: This compares the instanced sprite batch against a copy of the texture render batch's vertex path, in a hidden window, so that it can be run against Mesa's software rasteriser (LIBGL_ALWAYS_SOFTWARE=1) as well as real hardware.
+// The render batch cannot be driven on its own outside of the game loop, so its vertex layout, shader and upload are reproduced here as they are in the framework.
+
+static constexpr zf4::s_vec_2d_i i_window_size = {1280, 720};
+static constexpr zf4::s_vec_2d_i i_tex_size = {64, 64};
+static constexpr int i_default_frame_cnt = 20;
+
+static constexpr zf4::s_static_array<zf4::s_rect_i, 3> i_bench_src_rects = {
+    .elems_raw = {
+        {0, 0, 24, 24},
+        {24, 0, 16, 16},
+        {40, 0, 4, 4}
+    }
+};
+
+//
+// Reference Batch
+//
+static constexpr int i_ref_batch_slot_cnt = 4096; // Quads per flush.
+static constexpr int i_ref_batch_slot_vert_cnt = 4;
+static constexpr int i_ref_batch_slot_elem_cnt = 6;
+static constexpr int i_ref_batch_vert_comp_cnt = 13; // Corner, position, size, rotation, texture coordinate and blend.
+
+static const char* const i_ref_batch_vs_src = R"(#version 430 core
+
+layout (location = 0) in vec2 a_vert;
+layout (location = 1) in vec2 a_pos;
+layout (location = 2) in vec2 a_size;
+layout (location = 3) in float a_rot;
+layout (location = 4) in vec2 a_tex_coord;
+layout (location = 5) in vec4 a_blend;
+
+out vec2 v_tex_coord;
+out vec4 v_blend;
+
+uniform mat4 u_proj;
+uniform mat4 u_view;
+
+void main() {
+    float rot_cos = cos(a_rot);
+    float rot_sin = -sin(a_rot);
+
+    mat4 model = mat4(
+        vec4(a_size.x * rot_cos, a_size.x * rot_sin, 0.0f, 0.0f),
+        vec4(a_size.y * -rot_sin, a_size.y * rot_cos, 0.0f, 0.0f),
+        vec4(0.0f, 0.0f, 1.0f, 0.0f),
+        vec4(a_pos.x, a_pos.y, 0.0f, 1.0f)
+    );
+
+    gl_Position = u_proj * u_view * model * vec4(a_vert, 0.0f, 1.0f);
+    v_tex_coord = a_tex_coord;
+    v_blend = a_blend;
+}
+)";
+
+static const char* const i_ref_batch_fs_src = R"(#version 430 core
+
+in vec2 v_tex_coord;
+in vec4 v_blend;
+out vec4 o_frag_color;
+
+uniform sampler2D u_tex;
+
+void main() {
+    o_frag_color = texture(u_tex, v_tex_coord) * v_blend;
+}
+)";
+
+struct s_ref_batch {
+    GLuint vert_array_gl_id;
+    GLuint vert_buf_gl_id;
+    GLuint elem_buf_gl_id;
+
+    int slots_used_cnt;
+    zf4::s_static_array<float, i_ref_batch_slot_cnt * i_ref_batch_slot_vert_cnt * i_ref_batch_vert_comp_cnt> verts;
+};
+
+static void InitRefBatch(s_ref_batch& batch) {
+    glGenVertexArrays(1, &batch.vert_array_gl_id);
+    glBindVertexArray(batch.vert_array_gl_id);
+
+    glGenBuffers(1, &batch.vert_buf_gl_id);
+    glBindBuffer(GL_ARRAY_BUFFER, batch.vert_buf_gl_id);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(batch.verts), nullptr, GL_DYNAMIC_DRAW);
+
+    static zf4::s_static_array<unsigned short, i_ref_batch_slot_cnt * i_ref_batch_slot_elem_cnt> elems;
+
+    for (int i = 0; i < i_ref_batch_slot_cnt; ++i) {
+        elems[(i * 6) + 0] = (unsigned short)((i * 4) + 0);
+        elems[(i * 6) + 1] = (unsigned short)((i * 4) + 1);
+        elems[(i * 6) + 2] = (unsigned short)((i * 4) + 2);
+        elems[(i * 6) + 3] = (unsigned short)((i * 4) + 2);
+        elems[(i * 6) + 4] = (unsigned short)((i * 4) + 3);
+        elems[(i * 6) + 5] = (unsigned short)((i * 4) + 0);
+    }
+
+    glGenBuffers(1, &batch.elem_buf_gl_id);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, batch.elem_buf_gl_id);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(elems), elems.elems_raw, GL_STATIC_DRAW);
+
+    const int stride = sizeof(float) * i_ref_batch_vert_comp_cnt;
+    static constexpr int i_comp_cnts[] = {2, 2, 2, 1, 2, 4};
+
+    for (int i = 0, offs = 0; i < 6; offs += i_comp_cnts[i], ++i) {
+        glVertexAttribPointer(i, i_comp_cnts[i], GL_FLOAT, GL_FALSE, stride, (const void*)(sizeof(float) * offs));
+        glEnableVertexAttribArray(i);
+    }
+
+    glBindVertexArray(0);
+}
+
+static void CleanRefBatch(s_ref_batch& batch) {
+    glDeleteBuffers(1, &batch.elem_buf_gl_id);
+    glDeleteBuffers(1, &batch.vert_buf_gl_id);
+    glDeleteVertexArrays(1, &batch.vert_array_gl_id);
+}
+
+static void FlushRefBatch(s_ref_batch& batch, const GLuint prog_gl_id, const GLuint tex_gl_id, const zf4::s_matrix_4x4& proj_mat, const zf4::s_matrix_4x4& view_mat) {
+    if (batch.slots_used_cnt == 0) {
+        return;
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, batch.vert_buf_gl_id);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(float) * batch.slots_used_cnt * i_ref_batch_slot_vert_cnt * i_ref_batch_vert_comp_cnt, batch.verts.elems_raw);
+
+    glUseProgram(prog_gl_id);
+    glUniformMatrix4fv(glGetUniformLocation(prog_gl_id, "u_proj"), 1, GL_FALSE, &proj_mat.elems[0][0]);
+    glUniformMatrix4fv(glGetUniformLocation(prog_gl_id, "u_view"), 1, GL_FALSE, &view_mat.elems[0][0]);
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, tex_gl_id);
+    glUniform1i(glGetUniformLocation(prog_gl_id, "u_tex"), 0);
+
+    glBindVertexArray(batch.vert_array_gl_id);
+    glDrawElements(GL_TRIANGLES, i_ref_batch_slot_elem_cnt * batch.slots_used_cnt, GL_UNSIGNED_SHORT, nullptr);
+    glBindVertexArray(0);
+
+    batch.slots_used_cnt = 0;
+}
+
+static void SubmitToRefBatch(s_ref_batch& batch, const zf4::s_rect_i src_rect, const zf4::s_vec_2d pos, const zf4::s_vec_2d origin, const zf4::s_vec_2d scale, const float rot, const zf4::s_vec_4d blend, const GLuint prog_gl_id, const GLuint tex_gl_id, const zf4::s_matrix_4x4& proj_mat, const zf4::s_matrix_4x4& view_mat) {
+    if (batch.slots_used_cnt == i_ref_batch_slot_cnt) {
+        FlushRefBatch(batch, prog_gl_id, tex_gl_id, proj_mat, view_mat);
+    }
+
+    const float u_left = (float)src_rect.x / i_tex_size.x;
+    const float v_top = (float)src_rect.y / i_tex_size.y;
+    const float u_right = (float)(src_rect.x + src_rect.width) / i_tex_size.x;
+    const float v_bottom = (float)(src_rect.y + src_rect.height) / i_tex_size.y;
+
+    const float size_x = src_rect.width * scale.x;
+    const float size_y = src_rect.height * scale.y;
+
+    const float slot_verts[i_ref_batch_slot_vert_cnt * i_ref_batch_vert_comp_cnt] = {
+        0.0f - origin.x, 0.0f - origin.y, pos.x, pos.y, size_x, size_y, rot, u_left, v_top, blend.x, blend.y, blend.z, blend.w,
+        1.0f - origin.x, 0.0f - origin.y, pos.x, pos.y, size_x, size_y, rot, u_right, v_top, blend.x, blend.y, blend.z, blend.w,
+        1.0f - origin.x, 1.0f - origin.y, pos.x, pos.y, size_x, size_y, rot, u_right, v_bottom, blend.x, blend.y, blend.z, blend.w,
+        0.0f - origin.x, 1.0f - origin.y, pos.x, pos.y, size_x, size_y, rot, u_left, v_bottom, blend.x, blend.y, blend.z, blend.w
+    };
+
+    std::memcpy(batch.verts.elems_raw + (batch.slots_used_cnt * i_ref_batch_slot_vert_cnt * i_ref_batch_vert_comp_cnt), slot_verts, sizeof(slot_verts));
+    ++batch.slots_used_cnt;
+}
+
+//
+// Benchmark
+//
+static char* LoadFileStr(const char* const file_path) {
+    FILE* const fs = std::fopen(file_path, "rb");
+
+    if (!fs) {
+        return nullptr;
+    }
+
+    std::fseek(fs, 0, SEEK_END);
+    const long size = std::ftell(fs);
+    std::fseek(fs, 0, SEEK_SET);
+
+    const auto str = static_cast<char*>(std::malloc(size + 1));
+
+    if (str) {
+        str[std::fread(str, 1, size, fs)] = '\0';
+    }
+
+    std::fclose(fs);
+
+    return str;
+}
+
+static GLuint CompileShader(const char* const src, const GLenum type, const char* const name) {
+    const GLuint shader_gl_id = glCreateShader(type);
+    glShaderSource(shader_gl_id, 1, &src, nullptr);
+    glCompileShader(shader_gl_id);
+
+    GLint success;
+    glGetShaderiv(shader_gl_id, GL_COMPILE_STATUS, &success);
+
+    if (!success) {
+        char log[1024];
+        glGetShaderInfoLog(shader_gl_id, sizeof(log), nullptr, log);
+        std::fprintf(stderr, "Failed to compile shader \"%s\"!\n%s\n", name, log);
+        glDeleteShader(shader_gl_id);
+        return 0;
+    }
+
+    return shader_gl_id;
+}
+
+static GLuint LinkShaderProg(const char* const vs_src, const char* const fs_src, const char* const name) {
+    const GLuint vs_gl_id = CompileShader(vs_src, GL_VERTEX_SHADER, name);
+    const GLuint fs_gl_id = vs_gl_id ? CompileShader(fs_src, GL_FRAGMENT_SHADER, name) : 0;
+
+    if (!fs_gl_id) {
+        glDeleteShader(vs_gl_id);
+        return 0;
+    }
+
+    const GLuint prog_gl_id = glCreateProgram();
+    glAttachShader(prog_gl_id, vs_gl_id);
+    glAttachShader(prog_gl_id, fs_gl_id);
+    glLinkProgram(prog_gl_id);
+
+    glDeleteShader(vs_gl_id);
+    glDeleteShader(fs_gl_id);
+
+    GLint success;
+    glGetProgramiv(prog_gl_id, GL_LINK_STATUS, &success);
+
+    if (!success) {
+        char log[1024];
+        glGetProgramInfoLog(prog_gl_id, sizeof(log), nullptr, log);
+        std::fprintf(stderr, "Failed to link the shader program \"%s\"!\n%s\n", name, log);
+        glDeleteProgram(prog_gl_id);
+        return 0;
+    }
+
+    return prog_gl_id;
+}
+
+static GLuint LoadSpriteShaderProg(const char* const shader_dir) {
+    char vs_file_path[512];
+    char fs_file_path[512];
+    std::snprintf(vs_file_path, sizeof(vs_file_path), "%s/sprite.vert", shader_dir);
+    std::snprintf(fs_file_path, sizeof(fs_file_path), "%s/sprite.frag", shader_dir);
+
+    char* const vs_src = LoadFileStr(vs_file_path);
+    char* const fs_src = LoadFileStr(fs_file_path);
+
+    GLuint prog_gl_id = 0;
+
+    if (vs_src && fs_src) {
+        prog_gl_id = LinkShaderProg(vs_src, fs_src, "sprite");
+    } else {
+        std::fprintf(stderr, "Failed to read shader \"%s\"!\n", vs_src ? fs_file_path : vs_file_path);
+    }
+
+    std::free(fs_src);
+    std::free(vs_src);
+
+    return prog_gl_id;
+}
+
+// A texture of solid blocks with a gradient in each, so that a wrong texture coordinate shows up in the output.
+static GLuint MakeBenchTexture() {
+    static zf4::s_static_array<unsigned char, i_tex_size.x * i_tex_size.y * 4> px_data;
+
+    for (int y = 0; y < i_tex_size.y; ++y) {
+        for (int x = 0; x < i_tex_size.x; ++x) {
+            unsigned char* const px = &px_data[((y * i_tex_size.x) + x) * 4];
+            px[0] = (unsigned char)(x * 4);
+            px[1] = (unsigned char)(y * 4);
+            px[2] = (unsigned char)(((x / 8) + (y / 8)) % 2 ? 255 : 64);
+            px[3] = 255;
+        }
+    }
+
+    GLuint tex_gl_id;
+    glGenTextures(1, &tex_gl_id);
+    glBindTexture(GL_TEXTURE_2D, tex_gl_id);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, i_tex_size.x, i_tex_size.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, px_data.elems_raw);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    return tex_gl_id;
+}
+
+struct s_bench_sprite {
+    zf4::s_rect_i src_rect;
+    zf4::s_vec_2d pos;
+    zf4::s_vec_2d scale;
+    float rot;
+    zf4::s_vec_4d blend;
+};
+
+// Scatters sprites over the view with the mix of sizes, rotations and blends seen in the level.
+static std::vector<s_bench_sprite> MakeBenchSprites(const int cnt) {
+    std::vector<s_bench_sprite> sprites(cnt);
+
+    unsigned int seed = 12345;
+
+    const auto next_rand_perc = [&seed]() {
+        seed = (seed * 1664525u) + 1013904223u;
+        return (seed >> 8) / (float)(1 << 24);
+    };
+
+    for (s_bench_sprite& sprite : sprites) {
+        sprite.src_rect = i_bench_src_rects[(int)(next_rand_perc() * i_bench_src_rects.len)];
+        sprite.pos = {next_rand_perc() * i_window_size.x, next_rand_perc() * i_window_size.y};
+        sprite.scale = next_rand_perc() < 0.1f ? zf4::s_vec_2d {2.0f, 2.0f} : zf4::s_vec_2d {1.0f, 1.0f};
+        sprite.rot = next_rand_perc() * 6.2831853f;
+        sprite.blend = {1.0f, 1.0f, 1.0f, next_rand_perc() < 0.2f ? 0.5f : 1.0f};
+    }
+
+    return sprites;
+}
+
+struct s_bench_ctx {
+    GLuint ref_prog_gl_id;
+    GLuint sprite_prog_gl_id;
+    GLuint tex_gl_id;
+    zf4::s_matrix_4x4 proj_mat;
+    zf4::s_matrix_4x4 view_mat;
+    s_ref_batch* ref_batch;
+    s_sprite_batch sprite_batch;
+};
+
+struct s_frame_time {
+    double write_ns; // Until every sprite is in the batch, including any flushes forced by it filling.
+    double submit_ns; // Until the last flush returns.
+    double frame_ns; // Until the GPU finishes.
+};
+
+static s_frame_time TimeFrame(s_bench_ctx& ctx, const std::vector<s_bench_sprite>& sprites, const bool instanced) {
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glFinish();
+
+    const auto begin = std::chrono::steady_clock::now();
+
+    if (instanced) {
+        BeginSpriteBatch(ctx.sprite_batch, ctx.sprite_prog_gl_id, ctx.tex_gl_id, i_tex_size, ctx.view_mat, i_window_size);
+
+        for (const s_bench_sprite& sprite : sprites) {
+            SubmitSprite(ctx.sprite_batch, sprite.src_rect, sprite.pos, {0.5f, 0.5f}, sprite.scale, sprite.rot, sprite.blend);
+        }
+    } else {
+        for (const s_bench_sprite& sprite : sprites) {
+            SubmitToRefBatch(*ctx.ref_batch, sprite.src_rect, sprite.pos, {0.5f, 0.5f}, sprite.scale, sprite.rot, sprite.blend, ctx.ref_prog_gl_id, ctx.tex_gl_id, ctx.proj_mat, ctx.view_mat);
+        }
+    }
+
+    const auto write_end = std::chrono::steady_clock::now();
+
+    if (instanced) {
+        FlushSpriteBatch(ctx.sprite_batch);
+    } else {
+        FlushRefBatch(*ctx.ref_batch, ctx.ref_prog_gl_id, ctx.tex_gl_id, ctx.proj_mat, ctx.view_mat);
+    }
+
+    const auto submit_end = std::chrono::steady_clock::now();
+
+    glFinish();
+
+    const auto frame_end = std::chrono::steady_clock::now();
+
+    return {
+        .write_ns = std::chrono::duration<double, std::nano>(write_end - begin).count(),
+        .submit_ns = std::chrono::duration<double, std::nano>(submit_end - begin).count(),
+        .frame_ns = std::chrono::duration<double, std::nano>(frame_end - begin).count()
+    };
+}
+
+// Checks that both paths draw the same image. A few pixels are let through, since the two place quad corners with differently ordered arithmetic.
+static bool VerifySpriteBatch(s_bench_ctx& ctx) {
+    const std::vector<s_bench_sprite> sprites = MakeBenchSprites(2000);
+
+    std::vector<unsigned char> ref_px(i_window_size.x * i_window_size.y * 4);
+    std::vector<unsigned char> inst_px(ref_px.size());
+
+    TimeFrame(ctx, sprites, false);
+    glReadPixels(0, 0, i_window_size.x, i_window_size.y, GL_RGBA, GL_UNSIGNED_BYTE, ref_px.data());
+
+    TimeFrame(ctx, sprites, true);
+    glReadPixels(0, 0, i_window_size.x, i_window_size.y, GL_RGBA, GL_UNSIGNED_BYTE, inst_px.data());
+
+    int diff_cnt = 0;
+    int lit_cnt = 0;
+
+    for (size_t i = 0; i < ref_px.size(); i += 4) {
+        bool diff = false;
+
+        for (int c = 0; c < 3; ++c) {
+            if (std::abs(ref_px[i + c] - inst_px[i + c]) > 2) {
+                diff = true;
+            }
+        }
+
+        diff_cnt += diff;
+        lit_cnt += ref_px[i] || ref_px[i + 1] || ref_px[i + 2];
+    }
+
+    const int pixel_cnt = i_window_size.x * i_window_size.y;
+
+    if (lit_cnt < pixel_cnt / 10 || diff_cnt > pixel_cnt / 1000) {
+        std::fprintf(stderr, "Sprite batch output is wrong! %d of %d pixels differ from the reference batch, with %d drawn to.\n", diff_cnt, pixel_cnt, lit_cnt);
+        return false;
+    }
+
+    return true;
+}
+
+static void PrintUsage(const char* const exe_name) {
+    std::fprintf(stderr, "Usage: %s [--shader-dir <dir>] [--frames <cnt>]\n", exe_name);
+}
+
+int main(const int arg_cnt, const char* const* const args) {
+    const char* shader_dir = "assets/shaders";
+    int frame_cnt = i_default_frame_cnt;
+
+    for (int i = 1; i < arg_cnt; ++i) {
+        if (std::strcmp(args[i], "--shader-dir") == 0 && i + 1 < arg_cnt) {
+            shader_dir = args[++i];
+        } else if (std::strcmp(args[i], "--frames") == 0 && i + 1 < arg_cnt) {
+            frame_cnt = std::atoi(args[++i]);
+
+            if (frame_cnt <= 0) {
+                PrintUsage(args[0]);
+                return EXIT_FAILURE;
+            }
+        } else {
+            PrintUsage(args[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (!glfwInit()) {
+        std::fprintf(stderr, "Failed to initialise GLFW!\n");
+        return EXIT_FAILURE;
+    }
+
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+    GLFWwindow* const window = glfwCreateWindow(i_window_size.x, i_window_size.y, "Sprite Benchmark", nullptr, nullptr);
+
+    if (!window) {
+        std::fprintf(stderr, "Failed to create a window with an OpenGL 4.3 context!\n");
+        glfwTerminate();
+        return EXIT_FAILURE;
+    }
+
+    glfwMakeContextCurrent(window);
+
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+        std::fprintf(stderr, "Failed to load OpenGL functions!\n");
+        glfwDestroyWindow(window);
+        glfwTerminate();
+        return EXIT_FAILURE;
+    }
+
+    std::printf("renderer: %s\n", (const char*)glGetString(GL_RENDERER));
+
+    glViewport(0, 0, i_window_size.x, i_window_size.y);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    s_bench_ctx ctx = {};
+
+    ctx.ref_prog_gl_id = LinkShaderProg(i_ref_batch_vs_src, i_ref_batch_fs_src, "reference batch");
+    ctx.sprite_prog_gl_id = LoadSpriteShaderProg(shader_dir);
+    ctx.tex_gl_id = MakeBenchTexture();
+
+    ctx.proj_mat = LoadPixelProjMatrix4x4(i_window_size);
+
+    zf4::InitIdentityMatrix4x4(ctx.view_mat);
+
+    ctx.ref_batch = static_cast<s_ref_batch*>(std::calloc(1, sizeof(s_ref_batch)));
+
+    bool success = ctx.ref_prog_gl_id && ctx.sprite_prog_gl_id && ctx.ref_batch;
+
+    if (success) {
+        InitRefBatch(*ctx.ref_batch);
+
+        if (!InitSpriteBatch(ctx.sprite_batch)) {
+            std::fprintf(stderr, "Failed to initialise the sprite batch!\n");
+            success = false;
+        }
+    }
+
+    if (success) {
+        std::printf("instance upload: %s\n", ctx.sprite_batch.persistent ? "persistent mapping" : "buffer sub-data");
+
+        success = VerifySpriteBatch(ctx);
+    }
+
+    if (success) {
+        // NOTE: Up to 4096 sprites fit in one flush of either batch, so at those counts the write time is the CPU cost of filling the batch alone. Beyond that it also takes in the draws of the flushes forced along the way, which on a software rasteriser include vertex processing.
+        static constexpr int i_sprite_cnts[] = {1000, 4000, 16000, 64000};
+
+        std::printf("bytes/sprite: %d batched, %d instanced\n", (int)(sizeof(float) * i_ref_batch_slot_vert_cnt * i_ref_batch_vert_comp_cnt), (int)sizeof(s_sprite_instance));
+
+        std::vector<double> write_times_ns(frame_cnt);
+        std::vector<double> submit_times_ns(frame_cnt);
+        std::vector<double> frame_times_ns(frame_cnt);
+
+        for (const int sprite_cnt : i_sprite_cnts) {
+            const std::vector<s_bench_sprite> sprites = MakeBenchSprites(sprite_cnt);
+
+            for (int pass = 0; pass < 2; ++pass) {
+                const bool instanced = pass == 1;
+
+                for (int i = 0; i < frame_cnt; ++i) {
+                    const s_frame_time time = TimeFrame(ctx, sprites, instanced);
+                    write_times_ns[i] = time.write_ns;
+                    submit_times_ns[i] = time.submit_ns;
+                    frame_times_ns[i] = time.frame_ns;
+                }
+
+                std::sort(write_times_ns.begin(), write_times_ns.end());
+                std::sort(submit_times_ns.begin(), submit_times_ns.end());
+                std::sort(frame_times_ns.begin(), frame_times_ns.end());
+
+                const double write_ms = write_times_ns[frame_cnt / 2] / 1000000.0;
+                const double submit_ms = submit_times_ns[frame_cnt / 2] / 1000000.0;
+                const double frame_ms = frame_times_ns[frame_cnt / 2] / 1000000.0;
+
+                std::printf("sprites: %5d, %-9s sprites/ms written: %9.1f, submitted: %8.1f, drawn: %7.1f\n", sprite_cnt, instanced ? "instanced" : "batched", sprite_cnt / write_ms, sprite_cnt / submit_ms, sprite_cnt / frame_ms);
+            }
+        }
+    }
+
+    if (ctx.sprite_batch.vert_array_gl_id) {
+        CleanSpriteBatch(ctx.sprite_batch);
+    }
+
+    if (ctx.ref_batch) {
+        CleanRefBatch(*ctx.ref_batch);
+        std::free(ctx.ref_batch);
+    }
+
+    glDeleteTextures(1, &ctx.tex_gl_id);
+    glDeleteProgram(ctx.sprite_prog_gl_id);
+    glDeleteProgram(ctx.ref_prog_gl_id);
+
+    glfwDestroyWindow(window);
+    glfwTerminate();
+
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,289 @@
+#include "text_run.h"
+
+#include <cstring>
+#include "game.h"
+
+static constexpr int i_text_run_vert_limit = i_text_run_str_len_limit * i_text_run_verts_per_glyph;
+
+static uint64_t HashTextRunKey(const char* const str, const GLuint font_tex_gl_id, const zf4::e_str_hor_align hor_align, const zf4::e_str_ver_align ver_align) {
+    uint64_t hash = 0xCBF29CE484222325ULL;
+
+    const auto hash_byte = [&hash](const unsigned char byte) {
+        hash ^= byte;
+        hash *= 0x100000001B3ULL;
+    };
+
+    hash_byte((unsigned char)font_tex_gl_id);
+    hash_byte((unsigned char)((hor_align << 4) | ver_align));
+
+    for (int i = 0; str[i]; ++i) {
+        hash_byte((unsigned char)str[i]);
+    }
+
+    return hash | 1; // Keep 0 free to mark unused runs.
+}
+
+static bool DoesTextRunMatch(const s_text_run& run, const uint64_t hash, const char* const str, const GLuint font_tex_gl_id, const zf4::e_str_hor_align hor_align, const zf4::e_str_ver_align ver_align) {
+    return run.hash == hash && run.font_tex_gl_id == font_tex_gl_id && run.hor_align == hor_align && run.ver_align == ver_align && std::strcmp(run.str, str) == 0;
+}
+
+// Writes the glyph quads of the string into the staging memory, relative to the alignment point, and returns the glyph count. Follows the same layout rules as the texture batch's string submission, without kerning.
+static int LayOutTextRun(s_text_run_cache& cache, const char* const str, const zf4::e_str_hor_align hor_align, const zf4::e_str_ver_align ver_align, const s_sdf_font& font) {
+    // Find the width of each line, and the line count.
+    zf4::s_static_array<int, i_text_run_str_len_limit + 1> line_widths = {};
+    int line_cnt = 1;
+
+    for (int i = 0; str[i]; ++i) {
+        if (str[i] == '\n') {
+            ++line_cnt;
+            continue;
+        }
+
+        const int chr_index = str[i] - zf4::g_font_chr_range_begin;
+
+        if (chr_index >= 0 && chr_index < zf4::g_font_chr_range_len) {
+            line_widths[line_cnt - 1] += font.chr_hor_advances[chr_index];
+        }
+    }
+
+    const int height = line_cnt * font.line_height;
+
+    const float top = ver_align == zf4::ek_str_ver_align_top ? 0.0f : (ver_align == zf4::ek_str_ver_align_center ? -height / 2.0f : (float)-height);
+
+    // Write the quads.
+    int glyph_cnt = 0;
+    int line_index = 0;
+    zf4::s_vec_2d pen = {};
+
+    const auto load_line_left = [hor_align, &line_widths](const int line_index) {
+        const int width = line_widths[line_index];
+        return hor_align == zf4::ek_str_hor_align_left ? 0.0f : (hor_align == zf4::ek_str_hor_align_center ? -width / 2.0f : (float)-width);
+    };
+
+    pen.x = load_line_left(0);
+    pen.y = top;
+
+    for (int i = 0; str[i]; ++i) {
+        if (str[i] == '\n') {
+            ++line_index;
+            pen.x = load_line_left(line_index);
+            pen.y += font.line_height;
+            continue;
+        }
+
+        const int chr_index = str[i] - zf4::g_font_chr_range_begin;
+
+        if (chr_index < 0 || chr_index >= zf4::g_font_chr_range_len) {
+            continue;
+        }
+
+        const zf4::s_rect_i src_rect = font.chr_src_rects[chr_index];
+
+        if (str[i] != ' ') {
+            const float x = pen.x + font.chr_hor_offsets[chr_index];
+            const float y = pen.y + font.chr_ver_offsets[chr_index];
+
+            const float u_left = (float)src_rect.x / font.tex_size.x;
+            const float v_top = (float)src_rect.y / font.tex_size.y;
+            const float u_right = (float)(src_rect.x + src_rect.width) / font.tex_size.x;
+            const float v_bottom = (float)(src_rect.y + src_rect.height) / font.tex_size.y;
+
+            const float quad_verts[i_text_run_verts_per_glyph * i_text_run_vert_comp_cnt] = {
+                x, y, u_left, v_top,
+                x + src_rect.width, y, u_right, v_top,
+                x + src_rect.width, y + src_rect.height, u_right, v_bottom,
+                x, y + src_rect.height, u_left, v_bottom
+            };
+
+            const int vert_begin = glyph_cnt * i_text_run_verts_per_glyph * i_text_run_vert_comp_cnt;
+
+            for (int j = 0; j < i_text_run_verts_per_glyph * i_text_run_vert_comp_cnt; ++j) {
+                cache.verts[vert_begin + j] = quad_verts[j];
+            }
+
+            ++glyph_cnt;
+        }
+
+        pen.x += font.chr_hor_advances[chr_index];
+    }
+
+    return glyph_cnt;
+}
+
+void InitTextRunCache(s_text_run_cache& cache, const bool recording) {
+    assert(zf4::IsStructZero(cache));
+
+    if (recording) {
+        cache.recording = true;
+        return;
+    }
+
+    glGenVertexArrays(1, &cache.vert_array_gl_id);
+    glBindVertexArray(cache.vert_array_gl_id);
+
+    glGenBuffers(1, &cache.vert_buf_gl_id);
+    glBindBuffer(GL_ARRAY_BUFFER, cache.vert_buf_gl_id);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(cache.verts) * i_text_run_cache_cap, nullptr, GL_DYNAMIC_DRAW);
+
+    // Every run's slice of the vertex buffer is laid out the same way, so one set of elements serves them all through a base vertex.
+    {
+        zf4::s_static_array<unsigned short, i_text_run_str_len_limit * i_text_run_elems_per_glyph> elems;
+        static_assert(i_text_run_vert_limit <= 0xFFFF);
+
+        for (int i = 0; i < i_text_run_str_len_limit; ++i) {
+            const int vert_index = i * i_text_run_verts_per_glyph;
+            const int elem_index = i * i_text_run_elems_per_glyph;
+
+            elems[elem_index + 0] = (unsigned short)(vert_index + 0);
+            elems[elem_index + 1] = (unsigned short)(vert_index + 1);
+            elems[elem_index + 2] = (unsigned short)(vert_index + 2);
+            elems[elem_index + 3] = (unsigned short)(vert_index + 2);
+            elems[elem_index + 4] = (unsigned short)(vert_index + 3);
+            elems[elem_index + 5] = (unsigned short)(vert_index + 0);
+        }
+
+        glGenBuffers(1, &cache.elem_buf_gl_id);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, cache.elem_buf_gl_id);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(elems), elems.elems_raw, GL_STATIC_DRAW);
+    }
+
+    const int stride = sizeof(float) * i_text_run_vert_comp_cnt;
+
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, stride, (const void*)0);
+    glEnableVertexAttribArray(0);
+
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, (const void*)(sizeof(float) * 2));
+    glEnableVertexAttribArray(1);
+
+    glBindVertexArray(0);
+}
+
+void CleanTextRunCache(s_text_run_cache& cache) {
+    if (cache.recording) {
+        zf4::ZeroOutStruct(cache);
+        return;
+    }
+
+    glDeleteBuffers(1, &cache.elem_buf_gl_id);
+    glDeleteBuffers(1, &cache.vert_buf_gl_id);
+    glDeleteVertexArrays(1, &cache.vert_array_gl_id);
+    zf4::ZeroOutStruct(cache);
+}
+
+void BeginTextRunFrame(s_text_run_cache& cache) {
+    ++cache.frame;
+    cache.layout_cnt = 0;
+    cache.draw_cnt = 0;
+    cache.drawn_glyph_cnt = 0;
+}
+
+// Gives the width of the string's widest line at the given point size, by the same rules as its layout. Nothing is laid out, so this is cheap enough to call every frame.
+float MeasureTextRunWidth(const char* const str, const s_sdf_font& font, const float pt_size) {
+    int width = 0;
+    int line_width = 0;
+
+    for (int i = 0; str[i] && i < i_text_run_str_len_limit; ++i) {
+        if (str[i] == '\n') {
+            line_width = 0;
+            continue;
+        }
+
+        const int chr_index = str[i] - zf4::g_font_chr_range_begin;
+
+        if (chr_index >= 0 && chr_index < zf4::g_font_chr_range_len) {
+            line_width += font.chr_hor_advances[chr_index];
+            width = zf4::Max(width, line_width);
+        }
+    }
+
+    return width * (pt_size / font.src_pt_size);
+}
+
+// Draws the string at the given point size aligned to the given position, laying it out only if it is not already cached. Strings over the length limit are cut short. Anything batched that should appear beneath the string must be flushed before this.
+void DrawTextRun(s_text_run_cache& cache, const char* const str, const s_sdf_font& font, const float pt_size, const zf4::s_vec_2d pos, const zf4::s_vec_4d color, const zf4::e_str_hor_align hor_align, const zf4::e_str_ver_align ver_align, const zf4::s_matrix_4x4& view_mat, const zf4::s_vec_2d_i window_size, const GLuint prog_gl_id) {
+    char key_str[i_text_run_str_len_limit + 1];
+    std::strncpy(key_str, str, i_text_run_str_len_limit);
+    key_str[i_text_run_str_len_limit] = '\0';
+
+    const uint64_t hash = HashTextRunKey(key_str, font.tex_gl_id, hor_align, ver_align);
+
+    // Look for the run, noting the least recently used one as we go in case it is not found.
+    int run_index = -1;
+    int lru_run_index = 0;
+
+    for (int i = 0; i < i_text_run_cache_cap; ++i) {
+        const s_text_run& run = cache.runs[i];
+
+        if (DoesTextRunMatch(run, hash, key_str, font.tex_gl_id, hor_align, ver_align)) {
+            run_index = i;
+            break;
+        }
+
+        if (run.last_used_frame < cache.runs[lru_run_index].last_used_frame) {
+            lru_run_index = i;
+        }
+    }
+
+    if (run_index == -1) {
+        run_index = lru_run_index;
+
+        s_text_run& run = cache.runs[run_index];
+        run.hash = hash;
+        run.font_tex_gl_id = font.tex_gl_id;
+        run.hor_align = hor_align;
+        run.ver_align = ver_align;
+        std::strcpy(run.str, key_str);
+        run.glyph_cnt = LayOutTextRun(cache, key_str, hor_align, ver_align, font);
+
+        if (run.glyph_cnt > 0 && !cache.recording) {
+            glBindBuffer(GL_ARRAY_BUFFER, cache.vert_buf_gl_id);
+            glBufferSubData(GL_ARRAY_BUFFER, sizeof(cache.verts) * run_index, sizeof(float) * run.glyph_cnt * i_text_run_verts_per_glyph * i_text_run_vert_comp_cnt, cache.verts.elems_raw);
+        }
+
+        ++cache.layout_cnt;
+    }
+
+    s_text_run& run = cache.runs[run_index];
+    run.last_used_frame = cache.frame;
+
+    if (run.glyph_cnt == 0) {
+        return;
+    }
+
+    ++cache.draw_cnt;
+    cache.drawn_glyph_cnt += run.glyph_cnt;
+
+    if (cache.recording) {
+        return;
+    }
+
+    s_text_run_prog_uniforms& uniforms = cache.prog_uniforms;
+
+    // NOTE: The program is not known on initialisation, since the shader programs finish loading after the cache is set up, so the uniform locations are looked up on the first draw with each program instead.
+    if (uniforms.prog_gl_id != prog_gl_id) {
+        uniforms.prog_gl_id = prog_gl_id;
+        uniforms.proj = glGetUniformLocation(prog_gl_id, "u_proj");
+        uniforms.view = glGetUniformLocation(prog_gl_id, "u_view");
+        uniforms.pos = glGetUniformLocation(prog_gl_id, "u_pos");
+        uniforms.scale = glGetUniformLocation(prog_gl_id, "u_scale");
+        uniforms.color = glGetUniformLocation(prog_gl_id, "u_color");
+        uniforms.tex = glGetUniformLocation(prog_gl_id, "u_tex");
+    }
+
+    const zf4::s_matrix_4x4 proj_mat = LoadPixelProjMatrix4x4(window_size);
+
+    glUseProgram(prog_gl_id);
+    glUniformMatrix4fv(uniforms.proj, 1, GL_FALSE, &proj_mat.elems[0][0]);
+    glUniformMatrix4fv(uniforms.view, 1, GL_FALSE, &view_mat.elems[0][0]);
+    glUniform2f(uniforms.pos, pos.x, pos.y);
+    glUniform1f(uniforms.scale, pt_size / font.src_pt_size);
+    glUniform4f(uniforms.color, color.x, color.y, color.z, color.w);
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, font.tex_gl_id);
+    glUniform1i(uniforms.tex, 0);
+
+    glBindVertexArray(cache.vert_array_gl_id);
+    glDrawElementsBaseVertex(GL_TRIANGLES, run.glyph_cnt * i_text_run_elems_per_glyph, GL_UNSIGNED_SHORT, nullptr, run_index * i_text_run_vert_limit);
+    glBindVertexArray(0);
+}
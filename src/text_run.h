@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <glad/glad.h>
+#include <zf4.h>
+#include "sdf_font.h"
+
+static constexpr int i_text_run_cache_cap = 256;
+static constexpr int i_text_run_str_len_limit = 63; // Excluding the terminator.
+static constexpr int i_text_run_verts_per_glyph = 4;
+static constexpr int i_text_run_elems_per_glyph = 6;
+static constexpr int i_text_run_vert_comp_cnt = 4; // Position and texture coordinate.
+
+// A string laid out in a given font and alignment, with its glyph quads held in this run's own slice of the cache's vertex buffer. Quad positions are in source pixels of the font, relative to the point the string is aligned to, so one run serves the string at any size.
+struct s_text_run {
+    uint64_t hash; // 0 if the run is unused.
+    GLuint font_tex_gl_id;
+    zf4::e_str_hor_align hor_align;
+    zf4::e_str_ver_align ver_align;
+    char str[i_text_run_str_len_limit + 1];
+
+    int glyph_cnt;
+    int last_used_frame;
+};
+
+// The uniform locations of the program runs are drawn with, so that they are not looked up on every draw.
+struct s_text_run_prog_uniforms {
+    GLuint prog_gl_id; // The program these were looked up in, or 0 if none yet.
+
+    GLint proj;
+    GLint view;
+    GLint pos;
+    GLint scale;
+    GLint color;
+    GLint tex;
+};
+
+// Keeps the layouts of recently drawn strings on the GPU, so that a string drawn again is not laid out again. The least recently used run is replaced when a new string needs laying out.
+// A recording cache looks up and lays out runs as usual but makes no GL calls, only counting what it would have drawn, so that text can be measured on machines without a GPU.
+struct s_text_run_cache {
+    GLuint vert_array_gl_id;
+    GLuint vert_buf_gl_id;
+    GLuint elem_buf_gl_id;
+    bool recording;
+
+    s_text_run_prog_uniforms prog_uniforms; // Not used when recording.
+
+    zf4::s_static_array<s_text_run, i_text_run_cache_cap> runs;
+    int frame;
+
+    // Since the last frame began, for profiling.
+    int layout_cnt;
+    int draw_cnt;
+    int drawn_glyph_cnt;
+
+    // NOTE: Staging memory for the run being laid out, kept here so that layouts do not need to allocate.
+    zf4::s_static_array<float, i_text_run_str_len_limit * i_text_run_verts_per_glyph * i_text_run_vert_comp_cnt> verts;
+};
+
+void InitTextRunCache(s_text_run_cache& cache, const bool recording = false);
+void CleanTextRunCache(s_text_run_cache& cache);
+void BeginTextRunFrame(s_text_run_cache& cache);
+float MeasureTextRunWidth(const char* const str, const s_sdf_font& font, const float pt_size);
+void DrawTextRun(s_text_run_cache& cache, const char* const str, const s_sdf_font& font, const float pt_size, const zf4::s_vec_2d pos, const zf4::s_vec_4d color, const zf4::e_str_hor_align hor_align, const zf4::e_str_ver_align ver_align, const zf4::s_matrix_4x4& view_mat, const zf4::s_vec_2d_i window_size, const GLuint prog_gl_id);
@@ -0,0 +1,152 @@
+#include "tile_layer.h"
+
+void InitTileLayer(s_tile_layer& layer) {
+    assert(zf4::IsStructZero(layer));
+
+    glGenVertexArrays(1, &layer.vert_array_gl_id);
+    glBindVertexArray(layer.vert_array_gl_id);
+
+    glGenBuffers(1, &layer.vert_buf_gl_id);
+    glBindBuffer(GL_ARRAY_BUFFER, layer.vert_buf_gl_id);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(layer.verts), nullptr, GL_STATIC_DRAW);
+
+    // The element buffer never changes, since every tile is a quad.
+    {
+        // NOTE: A full window has more vertices than 16-bit elements can index.
+        static zf4::s_static_array<GLuint, i_tile_layer_window_tile_cnt * i_tile_layer_elems_per_tile> elems;
+
+        for (int i = 0; i < i_tile_layer_window_tile_cnt; ++i) {
+            const int vert_index = i * i_tile_layer_verts_per_tile;
+            const int elem_index = i * i_tile_layer_elems_per_tile;
+
+            elems[elem_index + 0] = (GLuint)(vert_index + 0);
+            elems[elem_index + 1] = (GLuint)(vert_index + 1);
+            elems[elem_index + 2] = (GLuint)(vert_index + 2);
+            elems[elem_index + 3] = (GLuint)(vert_index + 2);
+            elems[elem_index + 4] = (GLuint)(vert_index + 3);
+            elems[elem_index + 5] = (GLuint)(vert_index + 0);
+        }
+
+        glGenBuffers(1, &layer.elem_buf_gl_id);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, layer.elem_buf_gl_id);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(elems), elems.elems_raw, GL_STATIC_DRAW);
+    }
+
+    const int stride = sizeof(float) * i_tile_layer_vert_comp_cnt;
+
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, stride, (const void*)0);
+    glEnableVertexAttribArray(0);
+
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, (const void*)(sizeof(float) * 2));
+    glEnableVertexAttribArray(1);
+
+    glBindVertexArray(0);
+
+    layer.tilemap_version = -1;
+}
+
+void CleanTileLayer(s_tile_layer& layer) {
+    glDeleteBuffers(1, &layer.elem_buf_gl_id);
+    glDeleteBuffers(1, &layer.vert_buf_gl_id);
+    glDeleteVertexArrays(1, &layer.vert_array_gl_id);
+    zf4::ZeroOutStruct(layer);
+}
+
+void RefreshTileLayer(s_tile_layer& layer, const s_tilemap& tilemap, const zf4::s_vec_2d cam_pos, const zf4::s_vec_2d_i tex_size) {
+    // Centre the window on the chunk the camera is in, shifting it back inside the tilemap where it would cross an edge.
+    const zf4::s_vec_2d_i window_chunk_cnts = {zf4::Min(i_tile_layer_window_chunk_cnts.x, tilemap.chunk_cnts.x), zf4::Min(i_tile_layer_window_chunk_cnts.y, tilemap.chunk_cnts.y)};
+
+    const zf4::s_vec_2d_i window_chunk_pos = {
+        zf4::Clamp((int)floorf(cam_pos.x / (i_tile_chunk_size * i_tile_size)) - (window_chunk_cnts.x / 2), 0, tilemap.chunk_cnts.x - window_chunk_cnts.x),
+        zf4::Clamp((int)floorf(cam_pos.y / (i_tile_chunk_size * i_tile_size)) - (window_chunk_cnts.y / 2), 0, tilemap.chunk_cnts.y - window_chunk_cnts.y)
+    };
+
+    const zf4::s_vec_2d_i window_pos = window_chunk_pos * i_tile_chunk_size;
+
+    if (layer.tilemap_version == tilemap.version && layer.window_pos.x == window_pos.x && layer.window_pos.y == window_pos.y) {
+        return;
+    }
+
+    layer.window_pos = window_pos;
+    layer.window_size = {
+        zf4::Min(window_chunk_cnts.x * i_tile_chunk_size, tilemap.size.x - window_pos.x),
+        zf4::Min(window_chunk_cnts.y * i_tile_chunk_size, tilemap.size.y - window_pos.y)
+    };
+
+    const zf4::s_rect_i src_rect = i_sprite_src_rects[ek_sprite_index_tile];
+
+    const float u_left = (float)src_rect.x / tex_size.x;
+    const float v_top = (float)src_rect.y / tex_size.y;
+    const float u_right = (float)(src_rect.x + src_rect.width) / tex_size.x;
+    const float v_bottom = (float)(src_rect.y + src_rect.height) / tex_size.y;
+
+    layer.tile_cnt = 0;
+
+    for (int y = 0; y < layer.window_size.y; ++y) {
+        layer.row_tile_begins[y] = layer.tile_cnt;
+
+        const int ty = layer.window_pos.y + y;
+
+        for (int tx = layer.window_pos.x; tx < layer.window_pos.x + layer.window_size.x; ++tx) {
+            if (!IsTileActive(tx, ty, tilemap)) {
+                continue;
+            }
+
+            const zf4::s_vec_2d pos = TileToLevelPos(tx, ty);
+
+            const float quad_verts[i_tile_layer_verts_per_tile * i_tile_layer_vert_comp_cnt] = {
+                pos.x, pos.y, u_left, v_top,
+                pos.x + src_rect.width, pos.y, u_right, v_top,
+                pos.x + src_rect.width, pos.y + src_rect.height, u_right, v_bottom,
+                pos.x, pos.y + src_rect.height, u_left, v_bottom
+            };
+
+            const int vert_begin = layer.tile_cnt * i_tile_layer_verts_per_tile * i_tile_layer_vert_comp_cnt;
+
+            for (int i = 0; i < i_tile_layer_verts_per_tile * i_tile_layer_vert_comp_cnt; ++i) {
+                layer.verts[vert_begin + i] = quad_verts[i];
+            }
+
+            ++layer.tile_cnt;
+        }
+    }
+
+    layer.row_tile_begins[layer.window_size.y] = layer.tile_cnt;
+
+    glBindBuffer(GL_ARRAY_BUFFER, layer.vert_buf_gl_id);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(float) * layer.tile_cnt * i_tile_layer_verts_per_tile * i_tile_layer_vert_comp_cnt, layer.verts.elems_raw);
+
+    layer.tilemap_version = tilemap.version;
+}
+
+// Draws the tiles in the level rows from "row_begin" up to but excluding "row_end" which lie within the window, and returns how many were drawn.
+int DrawTileLayer(const s_tile_layer& layer, const int row_begin, const int row_end, const GLuint prog_gl_id, const GLuint tex_gl_id, const zf4::s_matrix_4x4& view_mat, const zf4::s_vec_2d_i window_size) {
+    assert(layer.tilemap_version != -1);
+    assert(row_begin <= row_end);
+
+    const int window_row_begin = zf4::Clamp(row_begin - layer.window_pos.y, 0, layer.window_size.y);
+    const int window_row_end = zf4::Clamp(row_end - layer.window_pos.y, window_row_begin, layer.window_size.y);
+
+    const int tile_begin = layer.row_tile_begins[window_row_begin];
+    const int tile_cnt = layer.row_tile_begins[window_row_end] - tile_begin;
+
+    if (tile_cnt == 0) {
+        return 0;
+    }
+
+    const zf4::s_matrix_4x4 proj_mat = LoadPixelProjMatrix4x4(window_size);
+
+    glUseProgram(prog_gl_id);
+    glUniformMatrix4fv(glGetUniformLocation(prog_gl_id, "u_proj"), 1, GL_FALSE, &proj_mat.elems[0][0]);
+    glUniformMatrix4fv(glGetUniformLocation(prog_gl_id, "u_view"), 1, GL_FALSE, &view_mat.elems[0][0]);
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, tex_gl_id);
+    glUniform1i(glGetUniformLocation(prog_gl_id, "u_tex"), 0);
+
+    glBindVertexArray(layer.vert_array_gl_id);
+    glDrawElements(GL_TRIANGLES, tile_cnt * i_tile_layer_elems_per_tile, GL_UNSIGNED_INT, (const void*)(sizeof(GLuint) * tile_begin * i_tile_layer_elems_per_tile));
+    glBindVertexArray(0);
+
+    return tile_cnt;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <glad/glad.h>
+#include "game.h"
+
+static constexpr int i_tile_layer_verts_per_tile = 4;
+static constexpr int i_tile_layer_elems_per_tile = 6;
+static constexpr int i_tile_layer_vert_comp_cnt = 4; // Position and texture coordinate.
+
+static constexpr zf4::s_vec_2d_i i_tile_layer_window_chunk_cnts = {5, 5}; // Odd, so the window can be centred on the chunk the camera is in.
+static constexpr zf4::s_vec_2d_i i_tile_layer_window_size = i_tile_layer_window_chunk_cnts * i_tile_chunk_size;
+static constexpr int i_tile_layer_window_tile_cnt = i_tile_layer_window_size.x * i_tile_layer_window_size.y;
+
+// A GPU-resident copy of the tile quads in a window of chunks around the camera. It is rebuilt only when the window moves to another chunk or the tilemap version changes, and drawn with a single call.
+struct s_tile_layer {
+    GLuint vert_array_gl_id;
+    GLuint vert_buf_gl_id;
+    GLuint elem_buf_gl_id;
+
+    zf4::s_vec_2d_i window_pos; // In tiles.
+    zf4::s_vec_2d_i window_size;
+
+    int tile_cnt;
+    zf4::s_static_array<int, i_tile_layer_window_size.y + 1> row_tile_begins; // Tiles are laid out row by row, so a range of rows maps to one contiguous range of quads. Indexed by row within the window.
+    int tilemap_version; // The tilemap version the buffer was last built from, or -1 if it has never been built.
+
+    // NOTE: Staging memory for uploads, kept here so that rebuilds do not need to allocate.
+    zf4::s_static_array<float, i_tile_layer_window_tile_cnt * i_tile_layer_verts_per_tile * i_tile_layer_vert_comp_cnt> verts;
+};
+
+void InitTileLayer(s_tile_layer& layer);
+void CleanTileLayer(s_tile_layer& layer);
+void RefreshTileLayer(s_tile_layer& layer, const s_tilemap& tilemap, const zf4::s_vec_2d cam_pos, const zf4::s_vec_2d_i tex_size);
+int DrawTileLayer(const s_tile_layer& layer, const int row_begin, const int row_end, const GLuint prog_gl_id, const GLuint tex_gl_id, const zf4::s_matrix_4x4& view_mat, const zf4::s_vec_2d_i window_size);
@@ -0,0 +1,603 @@
+#include "tilemap.h"
+
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include "pool.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static constexpr int i_tile_chunk_edit_pool_chunk_size = 16;
+
+static s_tile_chunk MakeFullTileChunk() {
+    s_tile_chunk chunk;
+
+    for (int i = 0; i < i_tile_chunk_size; ++i) {
+        chunk.rows[i] = ~(a_tile_row_word)0;
+    }
+
+    return chunk;
+}
+
+const s_tile_chunk g_empty_tile_chunk = {};
+const s_tile_chunk g_full_tile_chunk = MakeFullTileChunk();
+
+static void HashBytes(uint64_t& hash, const void* const data, const int64_t size) {
+    const auto bytes = static_cast<const zf4::a_byte*>(data);
+
+    for (int64_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 0x100000001B3ULL;
+    }
+}
+
+// Gives where the rows of the chunk live in the map itself, ignoring the edit overlay.
+static const a_tile_row_word* LoadUneditedTileChunkRows(const s_tilemap& tilemap, const int chunk_index) {
+    if (!tilemap.chunk_refs) {
+        return g_empty_tile_chunk.rows.elems_raw;
+    }
+
+    const uint32_t ref = tilemap.chunk_refs[chunk_index];
+
+    if (ref == i_tile_chunk_ref_empty) {
+        return g_empty_tile_chunk.rows.elems_raw;
+    }
+
+    if (ref == i_tile_chunk_ref_full) {
+        return g_full_tile_chunk.rows.elems_raw;
+    }
+
+    return reinterpret_cast<const a_tile_row_word*>(tilemap.file_data + ref);
+}
+
+//
+// Platform
+//
+static bool MapFile(const char* const file_path, const zf4::a_byte*& data, int64_t& size) {
+#ifdef _WIN32
+    const HANDLE file = CreateFileA(file_path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER file_size;
+
+    if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+        CloseHandle(file);
+        return false;
+    }
+
+    // NOTE: The view keeps the mapping alive, so neither handle is needed once it exists.
+    const HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+
+    if (!mapping) {
+        return false;
+    }
+
+    const void* const view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+
+    if (!view) {
+        return false;
+    }
+
+    data = static_cast<const zf4::a_byte*>(view);
+    size = file_size.QuadPart;
+#else
+    const int fd = open(file_path, O_RDONLY);
+
+    if (fd == -1) {
+        return false;
+    }
+
+    struct stat st;
+
+    if (fstat(fd, &st) == -1 || st.st_size == 0) {
+        close(fd);
+        return false;
+    }
+
+    // NOTE: The mapping holds its own reference to the file, so the descriptor can be closed straight away.
+    void* const view = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (view == MAP_FAILED) {
+        return false;
+    }
+
+    data = static_cast<const zf4::a_byte*>(view);
+    size = st.st_size;
+#endif
+
+    return true;
+}
+
+static void UnmapFile(const zf4::a_byte* const data, const int64_t size) {
+#ifdef _WIN32
+    UnmapViewOfFile(data);
+#else
+    munmap(const_cast<zf4::a_byte*>(data), size);
+#endif
+}
+
+static int LoadPageSize() {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwPageSize;
+#else
+    return (int)sysconf(_SC_PAGESIZE);
+#endif
+}
+
+// Hints that the pages are about to be needed, so they can be read ahead, or that they are not, so they can be dropped. The pages are file-backed and never written, so dropping one loses nothing; it is just read again if touched.
+static void AdviseTilemapPages(const s_tilemap& tilemap, const int page_begin, const int page_end, const bool wanted) {
+    zf4::a_byte* const begin = const_cast<zf4::a_byte*>(tilemap.file_data) + ((int64_t)page_begin * tilemap.page_size);
+    const size_t size = (size_t)(page_end - page_begin) * tilemap.page_size;
+
+#ifdef _WIN32
+    if (wanted) {
+        WIN32_MEMORY_RANGE_ENTRY range = {begin, size};
+        PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+    } else {
+        // NOTE: Unlocking pages that were never locked removes them from the working set, which is the nearest Windows has to dropping them.
+        VirtualUnlock(begin, size);
+    }
+#else
+    madvise(begin, size, wanted ? MADV_WILLNEED : MADV_DONTNEED);
+#endif
+}
+
+//
+// Setup
+//
+// Starts an empty map of the given size, held entirely in memory.
+bool InitTilemap(s_tilemap& tilemap, const zf4::s_vec_2d_i size) {
+    assert(zf4::IsStructZero(tilemap));
+    assert(size.x > 0 && size.y > 0);
+
+    tilemap.size = size;
+    tilemap.chunk_cnts = {(size.x + i_tile_chunk_size - 1) / i_tile_chunk_size, (size.y + i_tile_chunk_size - 1) / i_tile_chunk_size};
+
+    const int chunk_cnt = tilemap.chunk_cnts.x * tilemap.chunk_cnts.y;
+
+    tilemap.chunk_rows = static_cast<const a_tile_row_word**>(std::malloc(sizeof(*tilemap.chunk_rows) * chunk_cnt));
+
+    if (!tilemap.chunk_rows) {
+        zf4::ZeroOutStruct(tilemap);
+        return false;
+    }
+
+    for (int i = 0; i < chunk_cnt; ++i) {
+        tilemap.chunk_rows[i] = g_empty_tile_chunk.rows.elems_raw;
+    }
+
+    return true;
+}
+
+// Maps the map file for reading in place. Beyond the header, only the directory is read here, to check that every payload it refers to lies within the file.
+bool OpenTilemapFile(s_tilemap& tilemap, const char* const file_path) {
+    assert(zf4::IsStructZero(tilemap));
+
+    const zf4::a_byte* data;
+    int64_t size;
+
+    if (!MapFile(file_path, data, size)) {
+        std::fprintf(stderr, "Failed to map tilemap file \"%s\"!\n", file_path);
+        return false;
+    }
+
+    s_tilemap_file_header header;
+
+    if (size >= (int64_t)sizeof(header)) {
+        std::memcpy(&header, data, sizeof(header));
+    }
+
+    // NOTE: The size is limited so that neither it in level units nor the chunk indexes can overflow, and the chunk counts are rounded in 64 bits for the same reason.
+    const bool size_valid = size >= (int64_t)sizeof(header) && header.width > 0 && header.height > 0 && header.width <= INT_MAX / i_tile_size && header.height <= INT_MAX / i_tile_size;
+
+    const int64_t chunk_cnt = size_valid
+        ? (((int64_t)header.width + i_tile_chunk_size - 1) / i_tile_chunk_size) * (((int64_t)header.height + i_tile_chunk_size - 1) / i_tile_chunk_size)
+        : 0;
+
+    const int64_t dir_end = (int64_t)sizeof(header) + (chunk_cnt * (int64_t)sizeof(uint32_t));
+
+    bool valid = chunk_cnt > 0 && chunk_cnt <= INT_MAX && header.magic == i_tilemap_file_magic && header.version == i_tilemap_file_version && size >= dir_end;
+
+    // Check that every payload lies past the directory, aligned as written, and wholly within the file, since they are read in place without any further checks.
+    if (valid) {
+        const auto chunk_refs = reinterpret_cast<const uint32_t*>(data + sizeof(header));
+
+        for (int64_t i = 0; i < chunk_cnt; ++i) {
+            const uint32_t ref = chunk_refs[i];
+
+            if (ref == i_tile_chunk_ref_empty || ref == i_tile_chunk_ref_full) {
+                continue;
+            }
+
+            if (ref < dir_end || ref % sizeof(s_tile_chunk) != 0 || (int64_t)ref + (int64_t)sizeof(s_tile_chunk) > size) {
+                valid = false;
+                break;
+            }
+        }
+    }
+
+    if (!valid) {
+        std::fprintf(stderr, "Tilemap file \"%s\" is invalid!\n", file_path);
+        UnmapFile(data, size);
+        return false;
+    }
+
+    if (!InitTilemap(tilemap, {header.width, header.height})) {
+        UnmapFile(data, size);
+        return false;
+    }
+
+    tilemap.file_data = data;
+    tilemap.file_size = size;
+    tilemap.chunk_refs = reinterpret_cast<const uint32_t*>(data + sizeof(header));
+    tilemap.file_content_hash = header.content_hash;
+
+    for (int i = 0; i < chunk_cnt; ++i) {
+        tilemap.chunk_rows[i] = LoadUneditedTileChunkRows(tilemap, i);
+    }
+
+    tilemap.page_size = LoadPageSize();
+    tilemap.page_cnt = (int)((size + tilemap.page_size - 1) / tilemap.page_size);
+
+    const int page_word_cnt = (tilemap.page_cnt + 63) / 64;
+    tilemap.wanted_page_bits = static_cast<uint64_t*>(std::calloc(page_word_cnt, sizeof(uint64_t)));
+    tilemap.prev_wanted_page_bits = static_cast<uint64_t*>(std::calloc(page_word_cnt, sizeof(uint64_t)));
+
+    if (!tilemap.wanted_page_bits || !tilemap.prev_wanted_page_bits) {
+        CleanTilemap(tilemap);
+        return false;
+    }
+
+    return true;
+}
+
+void CleanTilemap(s_tilemap& tilemap) {
+    if (tilemap.file_data) {
+        UnmapFile(tilemap.file_data, tilemap.file_size);
+    }
+
+    std::free(tilemap.wanted_page_bits);
+    std::free(tilemap.prev_wanted_page_bits);
+
+    std::free(tilemap.edited_chunks);
+    std::free(tilemap.edited_chunk_indexes);
+    std::free(tilemap.chunk_rows);
+
+    zf4::ZeroOutStruct(tilemap);
+}
+
+// Writes a map file with the tile activity given by the function, which is called once for every tile. Only the chunk directory is held in memory, so maps far larger than memory can be written.
+bool WriteTilemapFile(const char* const file_path, const zf4::s_vec_2d_i size, bool (* const is_tile_active_func)(const int x, const int y, void* const data), void* const data) {
+    assert(size.x > 0 && size.y > 0);
+
+    const zf4::s_vec_2d_i chunk_cnts = {(size.x + i_tile_chunk_size - 1) / i_tile_chunk_size, (size.y + i_tile_chunk_size - 1) / i_tile_chunk_size};
+    const int chunk_cnt = chunk_cnts.x * chunk_cnts.y;
+
+    const auto chunk_refs = static_cast<uint32_t*>(std::calloc(chunk_cnt, sizeof(uint32_t)));
+
+    if (!chunk_refs) {
+        return false;
+    }
+
+    FILE* const fs = std::fopen(file_path, "wb");
+
+    if (!fs) {
+        std::fprintf(stderr, "Failed to open \"%s\" for writing the tilemap!\n", file_path);
+        std::free(chunk_refs);
+        return false;
+    }
+
+    // Leave room for the header and directory, which are only known once the payloads are written. Payloads are aligned to their size so that none straddles a page.
+    const int64_t payloads_begin = ((sizeof(s_tilemap_file_header) + (sizeof(uint32_t) * chunk_cnt) + sizeof(s_tile_chunk) - 1) / sizeof(s_tile_chunk)) * sizeof(s_tile_chunk);
+
+    bool success = true;
+
+    for (int64_t i = 0; i < payloads_begin && success; ++i) {
+        success = std::fputc(0, fs) != EOF;
+    }
+
+    uint64_t content_hash = 0xCBF29CE484222325ULL;
+    int64_t offs = payloads_begin;
+
+    int morton_side = 1;
+
+    while (morton_side < chunk_cnts.x || morton_side < chunk_cnts.y) {
+        morton_side *= 2;
+    }
+
+    for (int64_t code = 0; code < (int64_t)morton_side * morton_side && success; ++code) {
+        // De-interleave the code into the chunk position.
+        int cx = 0;
+        int cy = 0;
+
+        for (int b = 0; b < 16; ++b) {
+            cx |= (int)((code >> (b * 2)) & 1) << b;
+            cy |= (int)((code >> ((b * 2) + 1)) & 1) << b;
+        }
+
+        if (cx >= chunk_cnts.x || cy >= chunk_cnts.y) {
+            continue;
+        }
+
+        s_tile_chunk chunk = {};
+
+        for (int y = 0; y < i_tile_chunk_size; ++y) {
+            for (int x = 0; x < i_tile_chunk_size; ++x) {
+                const int tx = (cx * i_tile_chunk_size) + x;
+                const int ty = (cy * i_tile_chunk_size) + y;
+
+                if (tx < size.x && ty < size.y && is_tile_active_func(tx, ty, data)) {
+                    chunk.rows[y] |= TileRowWordBit(x);
+                }
+            }
+        }
+
+        uint32_t& ref = chunk_refs[(cy * chunk_cnts.x) + cx];
+
+        if (std::memcmp(&chunk, &g_empty_tile_chunk, sizeof(chunk)) == 0) {
+            ref = i_tile_chunk_ref_empty;
+        } else if (std::memcmp(&chunk, &g_full_tile_chunk, sizeof(chunk)) == 0) {
+            ref = i_tile_chunk_ref_full;
+        } else {
+            if (offs > UINT32_MAX - (int64_t)sizeof(chunk)) {
+                success = false;
+                break;
+            }
+
+            ref = (uint32_t)offs;
+            success = std::fwrite(&chunk, sizeof(chunk), 1, fs) == 1;
+            HashBytes(content_hash, &chunk, sizeof(chunk));
+            offs += sizeof(chunk);
+        }
+    }
+
+    HashBytes(content_hash, chunk_refs, sizeof(uint32_t) * chunk_cnt);
+
+    const s_tilemap_file_header header = {
+        .magic = i_tilemap_file_magic,
+        .version = i_tilemap_file_version,
+        .width = size.x,
+        .height = size.y,
+        .content_hash = content_hash
+    };
+
+    success = success
+        && std::fseek(fs, 0, SEEK_SET) == 0
+        && std::fwrite(&header, sizeof(header), 1, fs) == 1
+        && std::fwrite(chunk_refs, sizeof(uint32_t), chunk_cnt, fs) == (size_t)chunk_cnt;
+
+    success = std::fclose(fs) == 0 && success;
+
+    std::free(chunk_refs);
+
+    if (!success) {
+        std::fprintf(stderr, "Failed to write tilemap file \"%s\"!\n", file_path);
+    }
+
+    return success;
+}
+
+//
+// Editing
+//
+bool ReserveTileChunkEdits(s_tilemap& tilemap, const int min_cap) {
+    if (min_cap <= tilemap.edited_chunk_cap) {
+        return true;
+    }
+
+    const int cap = CalcPoolCap(tilemap.edited_chunk_cap, min_cap, i_tile_chunk_edit_pool_chunk_size);
+
+    const bool chunks_resized = ResizePoolArray(tilemap.edited_chunks, cap);
+
+    // The edited chunks may have moved, so the lookup has to follow them even if what comes after fails.
+    LinkTileChunkEdits(tilemap);
+
+    if (!chunks_resized || !ResizePoolArray(tilemap.edited_chunk_indexes, cap)) {
+        return false;
+    }
+
+    tilemap.edited_chunk_cap = cap;
+
+    return true;
+}
+
+// Points the row lookup of every edited chunk at its copy. Needed whenever the list of edited chunks is changed or moved other than through the edit functions, such as by restoring a snapshot.
+void LinkTileChunkEdits(s_tilemap& tilemap) {
+    for (int i = 0; i < tilemap.edited_chunk_cnt; ++i) {
+        tilemap.chunk_rows[tilemap.edited_chunk_indexes[i]] = tilemap.edited_chunks[i].rows.elems_raw;
+    }
+}
+
+// Points the row lookup of every edited chunk back at the map itself. Needed before the list of edited chunks is replaced, so that chunks missing from the new list are not left pointing into it.
+void UnlinkTileChunkEdits(s_tilemap& tilemap) {
+    for (int i = 0; i < tilemap.edited_chunk_cnt; ++i) {
+        const int chunk_index = tilemap.edited_chunk_indexes[i];
+        tilemap.chunk_rows[chunk_index] = LoadUneditedTileChunkRows(tilemap, chunk_index);
+    }
+}
+
+// Gives the rows of the chunk's copy in the edit overlay, making it if needed. Returns null if the overlay could not grow.
+static a_tile_row_word* EditTileChunk(s_tilemap& tilemap, const int chunk_index) {
+    const a_tile_row_word* const rows = tilemap.chunk_rows[chunk_index];
+
+    // NOTE: The rows of an edited chunk are never where those of the map itself are, and they live in the overlay, which is writable.
+    if (rows != LoadUneditedTileChunkRows(tilemap, chunk_index)) {
+        return const_cast<a_tile_row_word*>(rows);
+    }
+
+    if (!ReserveTileChunkEdits(tilemap, tilemap.edited_chunk_cnt + 1)) {
+        return nullptr;
+    }
+
+    const int edit_index = tilemap.edited_chunk_cnt;
+    a_tile_row_word* const edit_rows = tilemap.edited_chunks[edit_index].rows.elems_raw;
+
+    std::memcpy(edit_rows, rows, sizeof(s_tile_chunk));
+    tilemap.edited_chunk_indexes[edit_index] = chunk_index;
+    ++tilemap.edited_chunk_cnt;
+
+    tilemap.chunk_rows[chunk_index] = edit_rows;
+
+    return edit_rows;
+}
+
+// Returns false if the chunk could not be copied into the edit overlay, in which case the tile is left unchanged.
+bool ActivateTile(const int x, const int y, s_tilemap& tilemap) {
+    assert(IsTilePosWithinBounds(x, y, tilemap));
+
+    a_tile_row_word* const rows = EditTileChunk(tilemap, TileChunkIndex(x / i_tile_chunk_size, y / i_tile_chunk_size, tilemap));
+
+    if (!rows) {
+        return false;
+    }
+
+    rows[y % i_tile_chunk_size] |= TileRowWordBit(x);
+    ++tilemap.version;
+
+    return true;
+}
+
+bool DeactivateTile(const int x, const int y, s_tilemap& tilemap) {
+    assert(IsTilePosWithinBounds(x, y, tilemap));
+
+    a_tile_row_word* const rows = EditTileChunk(tilemap, TileChunkIndex(x / i_tile_chunk_size, y / i_tile_chunk_size, tilemap));
+
+    if (!rows) {
+        return false;
+    }
+
+    rows[y % i_tile_chunk_size] &= ~TileRowWordBit(x);
+    ++tilemap.version;
+
+    return true;
+}
+
+//
+// Streaming
+//
+// A streaming pass is made up of a call to begin it, calls marking each region of the level that something is in, and a call to end it. Ending the pass reads ahead the pages of any newly marked chunks and drops those of chunks no longer marked. Maps held in memory have nothing to stream, so passes over them do nothing.
+void BeginTilemapStreaming(s_tilemap& tilemap) {
+    if (!tilemap.file_data) {
+        return;
+    }
+
+    uint64_t* const prev = tilemap.prev_wanted_page_bits;
+    tilemap.prev_wanted_page_bits = tilemap.wanted_page_bits;
+    tilemap.wanted_page_bits = prev;
+
+    std::memset(tilemap.wanted_page_bits, 0, sizeof(uint64_t) * ((tilemap.page_cnt + 63) / 64));
+}
+
+void WantTilemapRegion(s_tilemap& tilemap, const zf4::s_rect rect) {
+    if (!tilemap.file_data) {
+        return;
+    }
+
+    static constexpr float i_chunk_level_size = i_tile_chunk_size * i_tile_size;
+
+    const int cx_begin = zf4::Clamp((int)floorf((rect.x - i_tilemap_stream_margin) / i_chunk_level_size), 0, tilemap.chunk_cnts.x);
+    const int cy_begin = zf4::Clamp((int)floorf((rect.y - i_tilemap_stream_margin) / i_chunk_level_size), 0, tilemap.chunk_cnts.y);
+    const int cx_end = zf4::Clamp((int)ceilf((rect.x + rect.width + i_tilemap_stream_margin) / i_chunk_level_size), cx_begin, tilemap.chunk_cnts.x);
+    const int cy_end = zf4::Clamp((int)ceilf((rect.y + rect.height + i_tilemap_stream_margin) / i_chunk_level_size), cy_begin, tilemap.chunk_cnts.y);
+
+    const auto want_page_at = [&tilemap](const int64_t offs) {
+        const int page = (int)(offs / tilemap.page_size);
+        tilemap.wanted_page_bits[page / 64] |= (uint64_t)1 << (page % 64);
+    };
+
+    for (int cy = cy_begin; cy < cy_end; ++cy) {
+        // The directory entries of a row of chunks are contiguous, so only the pages at either end need marking.
+        const int64_t row_refs_begin = sizeof(s_tilemap_file_header) + (sizeof(uint32_t) * TileChunkIndex(cx_begin, cy, tilemap));
+        const int64_t row_refs_end = row_refs_begin + (sizeof(uint32_t) * (cx_end - cx_begin));
+
+        if (row_refs_end > row_refs_begin) {
+            want_page_at(row_refs_begin);
+            want_page_at(row_refs_end - 1);
+        }
+
+        for (int cx = cx_begin; cx < cx_end; ++cx) {
+            const uint32_t ref = tilemap.chunk_refs[TileChunkIndex(cx, cy, tilemap)];
+
+            if (ref != i_tile_chunk_ref_empty && ref != i_tile_chunk_ref_full) {
+                want_page_at(ref);
+            }
+        }
+    }
+}
+
+// Returns how many pages were advised on.
+int EndTilemapStreaming(s_tilemap& tilemap) {
+    if (!tilemap.file_data) {
+        return 0;
+    }
+
+    int advised_page_cnt = 0;
+
+    // Advise on runs of pages at once, to keep the number of calls down. Words that neither begin nor end a run are skipped whole.
+    const int page_word_cnt = (tilemap.page_cnt + 63) / 64;
+
+    for (int pass = 0; pass < 2; ++pass) {
+        const bool wanted = pass == 0;
+
+        int run_begin = -1;
+
+        for (int w = 0; w < page_word_cnt; ++w) {
+            const uint64_t now = tilemap.wanted_page_bits[w];
+            const uint64_t before = tilemap.prev_wanted_page_bits[w];
+            const uint64_t run_bits = wanted ? now & ~before : before & ~now;
+
+            if (run_bits == (run_begin == -1 ? 0 : ~(uint64_t)0)) {
+                continue;
+            }
+
+            for (int b = 0; b < 64; ++b) {
+                const int page = (w * 64) + b;
+                const bool in_run = (run_bits >> b) & 1;
+
+                if (in_run && run_begin == -1) {
+                    run_begin = page;
+                } else if (!in_run && run_begin != -1) {
+                    AdviseTilemapPages(tilemap, run_begin, page, wanted);
+                    advised_page_cnt += page - run_begin;
+                    run_begin = -1;
+                }
+            }
+        }
+
+        if (run_begin != -1) {
+            AdviseTilemapPages(tilemap, run_begin, tilemap.page_cnt, wanted);
+            advised_page_cnt += tilemap.page_cnt - run_begin;
+        }
+    }
+
+    return advised_page_cnt;
+}
+
+int CountWantedTilemapPages(const s_tilemap& tilemap) {
+    int cnt = 0;
+
+    for (int i = 0; i < (tilemap.page_cnt + 63) / 64; ++i) {
+        for (uint64_t bits = tilemap.wanted_page_bits[i]; bits; bits &= bits - 1) {
+            ++cnt;
+        }
+    }
+
+    return cnt;
+}
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <cstdint>
+#include <zf4.h>
+
+static constexpr int i_tile_size = 16;
+
+static constexpr zf4::s_vec_2d_i i_default_tilemap_size = {40, 40}; // The size of the walled arena used when no map file is given.
+
+using a_tile_row_word = uint32_t;
+
+// NOTE: A chunk is as wide as a row word, so each of its rows is exactly one word and a horizontal run of tiles within it can be tested with one mask.
+static constexpr int i_tile_chunk_size = sizeof(a_tile_row_word) * 8;
+
+struct s_tile_chunk {
+    zf4::s_static_array<a_tile_row_word, i_tile_chunk_size> rows;
+};
+
+//
+// Map File Format
+//
+// A header, then a directory with an entry for every chunk in row-major order, then the payloads of the chunks which are neither fully empty nor fully active. Payloads are written in Morton order of their chunk positions, so that chunks near each other in the level tend to share pages.
+//
+// The file is memory-mapped and read in place, so nothing is decoded up front and only the pages that are touched are ever loaded.
+//
+static constexpr uint32_t i_tilemap_file_magic = 0x4D544347; // "GCTM"
+static constexpr uint32_t i_tilemap_file_version = 1;
+
+struct s_tilemap_file_header {
+    uint32_t magic;
+    uint32_t version;
+    int32_t width; // In tiles.
+    int32_t height;
+    uint64_t content_hash; // Of the directory and payloads, so that a map can be identified without reading all of it.
+};
+
+static constexpr uint32_t i_tile_chunk_ref_empty = 0;
+static constexpr uint32_t i_tile_chunk_ref_full = 1;
+// Any other directory entry is the byte offset of the chunk's payload in the file.
+
+static constexpr int i_tilemap_stream_interval = 30; // In ticks.
+static constexpr int i_tilemap_stream_margin = i_tile_chunk_size * i_tile_size; // How far beyond what needs it a region is kept resident, in level units.
+
+// NOTE: The map itself is never written to. Chunks that are changed are copied into an edit overlay, which is what snapshots capture and what the rows of those chunks are read from.
+struct s_tilemap {
+    zf4::s_vec_2d_i size; // In tiles.
+    zf4::s_vec_2d_i chunk_cnts;
+
+    // The mapped map file, or null if the map was started empty.
+    const zf4::a_byte* file_data;
+    int64_t file_size;
+    const uint32_t* chunk_refs; // The directory, within the file data.
+    uint64_t file_content_hash;
+
+    // Chunks which have been changed, and the chunk index of each.
+    s_tile_chunk* edited_chunks;
+    int* edited_chunk_indexes;
+    int edited_chunk_cnt;
+    int edited_chunk_cap;
+
+    // Where the rows of each chunk currently live: in its copy in the edit overlay, in its payload in the file, or in the shared empty or full chunk. Kept up to date on every change, so that finding them takes one lookup.
+    const a_tile_row_word** chunk_rows;
+
+    // Which pages of the file should be resident, as of the last and the current streaming pass.
+    uint64_t* wanted_page_bits;
+    uint64_t* prev_wanted_page_bits;
+    int page_cnt;
+    int page_size;
+
+    int stream_time; // Ticks until the next streaming pass.
+
+    int version; // Incremented whenever a tile changes, so that anything built from the tilemap knows when to rebuild.
+};
+
+bool InitTilemap(s_tilemap& tilemap, const zf4::s_vec_2d_i size);
+bool OpenTilemapFile(s_tilemap& tilemap, const char* const file_path);
+void CleanTilemap(s_tilemap& tilemap);
+bool WriteTilemapFile(const char* const file_path, const zf4::s_vec_2d_i size, bool (* const is_tile_active_func)(const int x, const int y, void* const data), void* const data);
+
+bool ReserveTileChunkEdits(s_tilemap& tilemap, const int min_cap);
+void LinkTileChunkEdits(s_tilemap& tilemap);
+void UnlinkTileChunkEdits(s_tilemap& tilemap);
+
+bool ActivateTile(const int x, const int y, s_tilemap& tilemap);
+bool DeactivateTile(const int x, const int y, s_tilemap& tilemap);
+
+void BeginTilemapStreaming(s_tilemap& tilemap);
+void WantTilemapRegion(s_tilemap& tilemap, const zf4::s_rect rect);
+int EndTilemapStreaming(s_tilemap& tilemap);
+int CountWantedTilemapPages(const s_tilemap& tilemap);
+
+extern const s_tile_chunk g_empty_tile_chunk;
+extern const s_tile_chunk g_full_tile_chunk;
+
+static inline zf4::s_vec_2d_i LevelSize(const s_tilemap& tilemap) {
+    return tilemap.size * i_tile_size;
+}
+
+static inline bool IsTilePosWithinBounds(const int x, const int y, const s_tilemap& tilemap) {
+    return x >= 0 && y >= 0 && x < tilemap.size.x && y < tilemap.size.y;
+}
+
+static inline zf4::s_vec_2d TileToLevelPos(const int tx, const int ty) {
+    return {(float)(tx * i_tile_size), (float)(ty * i_tile_size)};
+}
+
+static inline int TileChunkIndex(const int cx, const int cy, const s_tilemap& tilemap) {
+    return (cy * tilemap.chunk_cnts.x) + cx;
+}
+
+// Gives the rows of the chunk, wherever they currently live.
+static inline const a_tile_row_word* TileChunkRows(const s_tilemap& tilemap, const int chunk_index) {
+    return tilemap.chunk_rows[chunk_index];
+}
+
+static inline a_tile_row_word TileRowWordBit(const int x) {
+    return (a_tile_row_word)1 << (x % i_tile_chunk_size);
+}
+
+static inline bool IsTileActive(const int x, const int y, const s_tilemap& tilemap) {
+    assert(IsTilePosWithinBounds(x, y, tilemap));
+    const a_tile_row_word* const rows = TileChunkRows(tilemap, TileChunkIndex(x / i_tile_chunk_size, y / i_tile_chunk_size, tilemap));
+    return rows[y % i_tile_chunk_size] & TileRowWordBit(x);
+}
+
+// Checks whether any tile in the row from "x_begin" up to but excluding "x_end" is active. Each chunk the span crosses is tested with one mask.
+static inline bool IsTileSpanActive(const int x_begin, const int x_end, const int y, const s_tilemap& tilemap) {
+    assert(x_begin >= 0 && x_begin <= x_end && x_end <= tilemap.size.x);
+    assert(y >= 0 && y < tilemap.size.y);
+
+    if (x_begin == x_end) {
+        return false;
+    }
+
+    const int cy = y / i_tile_chunk_size;
+    const int chunk_row = y % i_tile_chunk_size;
+
+    const int cx_begin = x_begin / i_tile_chunk_size;
+    const int cx_last = (x_end - 1) / i_tile_chunk_size;
+
+    for (int cx = cx_begin; cx <= cx_last; ++cx) {
+        const int bit_begin = cx == cx_begin ? x_begin % i_tile_chunk_size : 0;
+        const int bit_end = cx == cx_last ? ((x_end - 1) % i_tile_chunk_size) + 1 : i_tile_chunk_size;
+
+        const a_tile_row_word high_mask = bit_end == i_tile_chunk_size ? ~(a_tile_row_word)0 : ((a_tile_row_word)1 << bit_end) - 1;
+        const a_tile_row_word mask = high_mask & ~(((a_tile_row_word)1 << bit_begin) - 1);
+
+        if (TileChunkRows(tilemap, TileChunkIndex(cx, cy, tilemap))[chunk_row] & mask) {
+            return true;
+        }
+    }
+
+    return false;
+}